@@ -0,0 +1,356 @@
+// Microbenchmarks for the procfs/sysfs read passes of SystemStatsBackend and
+// SystemDetailsBackend. Each pass runs against a fixture tree selected with
+// ORBITAL_PROC_ROOT/ORBITAL_SYS_ROOT and reports wall time and heap
+// allocations per sample.
+//
+//   collector_bench                      checked-in small tree + generated large tree
+//   collector_bench <root>               one tree (expects <root>/proc and <root>/sys)
+//   collector_bench --generate <root>    write a synthetic tree and exit
+//
+// The roots are read once per process, so every tree is benchmarked in a
+// child process of its own.
+
+#include "backend/MetricScheduler.h"
+#include "backend/NetlinkMonitor.h"
+#include "backend/SampleCache.h"
+#include "backend/SystemDetailsBackend.h"
+#include "backend/SystemStatsBackend.h"
+#include "backend/UeventMonitor.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+// Count every heap allocation, including Qt's container storage, which goes
+// straight to malloc rather than through operator new.
+extern "C" {
+void *__libc_malloc(size_t size) noexcept;
+void *__libc_calloc(size_t count, size_t size) noexcept;
+void *__libc_realloc(void *pointer, size_t size) noexcept;
+void __libc_free(void *pointer) noexcept;
+}
+
+namespace {
+
+std::atomic<quint64> g_allocations{0};
+
+} // namespace
+
+extern "C" {
+
+void *malloc(size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer) noexcept
+{
+    __libc_free(pointer);
+}
+
+} // extern "C"
+
+namespace {
+
+constexpr int kDefaultIterations = 200;
+constexpr int kWarmupIterations = 3;
+
+struct TreeShape {
+    int processes = 2000;
+    int cores = 16;
+    int sensors = 20;
+};
+
+bool writeFile(const QString &path, const QByteArray &content)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        std::fprintf(stderr, "cannot write %s\n", qPrintable(path));
+        return false;
+    }
+
+    return file.write(content) == content.size();
+}
+
+QByteArray processName(int pid)
+{
+    // A few names the stat parser has to handle with care.
+    if (pid % 101 == 0) {
+        return QByteArrayLiteral("(sd-pam)");
+    }
+
+    if (pid % 50 == 0) {
+        return QByteArrayLiteral("Web Content");
+    }
+
+    return QByteArrayLiteral("proc-") + QByteArray::number(pid);
+}
+
+// Deterministic, so numbers from different runs are comparable.
+bool generateTree(const QString &root, const TreeShape &shape)
+{
+    const QString proc = root + QStringLiteral("/proc");
+    const QString sys = root + QStringLiteral("/sys");
+
+    QByteArray stat;
+    auto cpuLine = [](const QByteArray &label, quint64 scale) {
+        return label + ' ' + QByteArray::number(4000 * scale) + " 20 " + QByteArray::number(1500 * scale) + ' '
+            + QByteArray::number(90000 * scale) + ' ' + QByteArray::number(300 * scale) + " 0 "
+            + QByteArray::number(40 * scale) + " 0 0 0\n";
+    };
+    stat += cpuLine(QByteArrayLiteral("cpu "), shape.cores);
+    for (int core = 0; core < shape.cores; ++core) {
+        stat += cpuLine(QByteArrayLiteral("cpu") + QByteArray::number(core), 1);
+    }
+    stat += "intr 1000000\nctxt 5000000\nbtime 1700000000\nprocesses "
+        + QByteArray::number(shape.processes) + "\nprocs_running 2\nprocs_blocked 0\n";
+
+    bool ok = writeFile(proc + QStringLiteral("/stat"), stat)
+        && writeFile(proc + QStringLiteral("/meminfo"),
+                     "MemTotal:        7823456 kB\n"
+                     "MemFree:          912344 kB\n"
+                     "MemAvailable:    4123456 kB\n"
+                     "Buffers:          123456 kB\n"
+                     "Cached:          2345678 kB\n"
+                     "SwapCached:         1024 kB\n"
+                     "Active:          3012345 kB\n"
+                     "Inactive:        2012345 kB\n"
+                     "SwapTotal:       2097148 kB\n"
+                     "SwapFree:        1997148 kB\n"
+                     "Dirty:               512 kB\n"
+                     "Shmem:            123456 kB\n"
+                     "Slab:             234567 kB\n"
+                     "SReclaimable:     123456 kB\n"
+                     "SUnreclaim:       111111 kB\n")
+        && writeFile(proc + QStringLiteral("/loadavg"), "0.52 0.41 0.30 2/" + QByteArray::number(shape.processes) + " 4567\n")
+        && writeFile(proc + QStringLiteral("/uptime"), "12345.67 40000.00\n")
+        && writeFile(proc + QStringLiteral("/sys/kernel/hostname"), "bench\n")
+        && writeFile(proc + QStringLiteral("/diskstats"),
+                     " 179       0 mmcblk0 12000 300 960000 4000 8000 900 640000 7000 0 9000 11000 0 0 0 0 100 200\n"
+                     " 179       1 mmcblk0p1 200 0 16000 100 10 0 80 5 0 90 105 0 0 0 0 0 0\n"
+                     " 179       2 mmcblk0p2 11800 300 944000 3900 7990 900 639920 6995 0 8910 10895 0 0 0 0 0 0\n"
+                     "   8       0 sda 5000 100 400000 2000 3000 200 240000 1500 0 3000 3500 0 0 0 0 50 60\n"
+                     "   7       0 loop0 100 0 800 10 0 0 0 0 0 10 10 0 0 0 0 0 0\n");
+
+    for (int pid = 1; ok && pid <= shape.processes; ++pid) {
+        QByteArray line = QByteArray::number(pid) + " (" + processName(pid) + ") S 1 "
+            + QByteArray::number(pid) + ' ' + QByteArray::number(pid) + " 0 -1 4194560 100 0 0 0 "
+            + QByteArray::number((pid * 37) % 5000 + 100) + ' ' + QByteArray::number((pid * 13) % 900)
+            + " 0 0 20 0 1 0 100 " + QByteArray::number(1048576 + pid * 4096) + ' '
+            + QByteArray::number(200 + (pid * 97) % 20000);
+        for (int field = 22; field < 51; ++field) {
+            line += " 0";
+        }
+        line += '\n';
+        ok = writeFile(proc + QStringLiteral("/%1/stat").arg(pid), line);
+    }
+
+    // Two clusters, little then big, each a cpufreq policy with five OPPs.
+    const QString cpu = sys + QStringLiteral("/devices/system/cpu");
+    const QByteArray cpuRange = "0-" + QByteArray::number(shape.cores - 1) + '\n';
+    ok = ok && writeFile(cpu + QStringLiteral("/online"), cpuRange) && writeFile(cpu + QStringLiteral("/present"), cpuRange);
+    for (int cluster = 0; ok && cluster < 2; ++cluster) {
+        const int firstCore = cluster * (shape.cores / 2);
+        const int lastCore = cluster == 0 ? shape.cores / 2 - 1 : shape.cores - 1;
+        const qint64 maxKhz = cluster == 0 ? 1804800 : 2419200;
+        const QString policy = cpu + QStringLiteral("/cpufreq/policy%1").arg(firstCore);
+
+        QByteArray related;
+        for (int core = firstCore; core <= lastCore; ++core) {
+            related += QByteArray::number(core) + (core == lastCore ? '\n' : ' ');
+        }
+
+        QByteArray timeInState;
+        for (int point = 1; point <= 5; ++point) {
+            timeInState += QByteArray::number(maxKhz * point / 5) + ' ' + QByteArray::number(100000 / point) + '\n';
+        }
+
+        ok = writeFile(policy + QStringLiteral("/related_cpus"), related)
+            && writeFile(policy + QStringLiteral("/cpuinfo_max_freq"), QByteArray::number(maxKhz) + '\n')
+            && writeFile(policy + QStringLiteral("/scaling_max_freq"), QByteArray::number(maxKhz) + '\n')
+            && writeFile(policy + QStringLiteral("/scaling_cur_freq"), QByteArray::number(maxKhz / 3) + '\n')
+            && writeFile(policy + QStringLiteral("/stats/time_in_state"), timeInState);
+    }
+
+    // Four sensors per hwmon device, the last one left unlabelled.
+    for (int sensor = 0; ok && sensor < shape.sensors; ++sensor) {
+        const QString hwmon = sys + QStringLiteral("/class/hwmon/hwmon%1").arg(sensor / 4);
+        const int index = sensor % 4 + 1;
+        ok = writeFile(hwmon + QStringLiteral("/name"), "soc_thermal_" + QByteArray::number(sensor / 4) + '\n')
+            && writeFile(hwmon + QStringLiteral("/temp%1_input").arg(index), QByteArray::number(35000 + sensor * 750) + '\n')
+            && (index == 4
+                || writeFile(hwmon + QStringLiteral("/temp%1_label").arg(index), "zone" + QByteArray::number(index) + '\n'));
+    }
+
+    const QString battery = sys + QStringLiteral("/class/power_supply/battery");
+    return ok && writeFile(battery + QStringLiteral("/type"), "Battery\n")
+        && writeFile(battery + QStringLiteral("/uevent"),
+                     "POWER_SUPPLY_NAME=battery\n"
+                     "POWER_SUPPLY_TYPE=Battery\n"
+                     "POWER_SUPPLY_STATUS=Discharging\n"
+                     "POWER_SUPPLY_PRESENT=1\n"
+                     "POWER_SUPPLY_CAPACITY=76\n"
+                     "POWER_SUPPLY_VOLTAGE_NOW=3912000\n"
+                     "POWER_SUPPLY_CURRENT_NOW=-412000\n"
+                     "POWER_SUPPLY_TEMP=312\n"
+                     "POWER_SUPPLY_CHARGE_FULL=3100000\n"
+                     "POWER_SUPPLY_CHARGE_FULL_DESIGN=3300000\n"
+                     "POWER_SUPPLY_CHARGE_NOW=2356000\n");
+}
+
+} // namespace
+
+class CollectorBench
+{
+public:
+    explicit CollectorBench(int iterations)
+        : m_iterations(iterations)
+        , m_cache(&m_netlink)
+        , m_stats(&m_netlink, &m_uevent, &m_cache)
+        , m_details(&m_scheduler, &m_netlink, &m_uevent, &m_cache)
+    {
+    }
+
+    void run()
+    {
+        std::printf("%-40s %14s %16s\n", "pass", "ns/sample", "allocs/sample");
+        measure("SystemStatsBackend::readCpuInfo", [this]() { m_stats.readCpuInfo(); });
+        measure("SystemStatsBackend::readMemInfo", [this]() { m_stats.readMemInfo(); });
+        measure("SystemStatsBackend::readLoadAverage", [this]() { m_stats.readLoadAverage(); });
+        measure("SystemStatsBackend::readBatteryInfo", [this]() { m_stats.readBatteryInfo(); });
+        measure("SystemDetailsBackend::readCpuFrequencies", [this]() { m_details.readCpuFrequencies(); });
+        measure("SystemDetailsBackend::readTopProcesses", [this]() { m_details.readTopProcesses(); });
+        measure("SystemDetailsBackend::readThermalSensors", [this]() { m_details.readThermalSensors(); });
+        measure("SystemDetailsBackend::readMemoryDetails", [this]() { m_details.readMemoryDetails(); });
+        measure("SystemDetailsBackend::readDiskIoSpeeds", [this]() { m_details.readDiskIoSpeeds(); });
+    }
+
+private:
+    template <typename Pass>
+    void measure(const char *name, Pass pass)
+    {
+        for (int index = 0; index < kWarmupIterations; ++index) {
+            pass();
+        }
+
+        const quint64 allocationsBefore = g_allocations.load(std::memory_order_relaxed);
+        QElapsedTimer clock;
+        clock.start();
+        for (int index = 0; index < m_iterations; ++index) {
+            pass();
+        }
+        const qint64 elapsedNs = clock.nsecsElapsed();
+        const quint64 allocations = g_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+        std::printf("%-40s %14.0f %16.1f\n", name,
+                    static_cast<double>(elapsedNs) / m_iterations,
+                    static_cast<double>(allocations) / m_iterations);
+    }
+
+    int m_iterations = kDefaultIterations;
+    // Netlink and uevent sockets are live; none of the measured passes uses them.
+    NetlinkMonitor m_netlink;
+    UeventMonitor m_uevent;
+    MetricScheduler m_scheduler;
+    // Never attached to a tick, so every pass reads its files itself.
+    SampleCache m_cache;
+    SystemStatsBackend m_stats;
+    SystemDetailsBackend m_details;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Benchmarks the Orbital procfs/sysfs collectors."));
+    parser.addHelpOption();
+    const QCommandLineOption iterationsOption(QStringLiteral("iterations"),
+                                              QStringLiteral("Samples per pass."), QStringLiteral("n"),
+                                              QString::number(kDefaultIterations));
+    const QCommandLineOption generateOption(QStringLiteral("generate"),
+                                            QStringLiteral("Write a synthetic tree to <root> and exit."));
+    const QCommandLineOption processesOption(QStringLiteral("processes"), QStringLiteral("Processes in a generated tree."),
+                                             QStringLiteral("n"), QStringLiteral("2000"));
+    const QCommandLineOption coresOption(QStringLiteral("cores"), QStringLiteral("CPUs in a generated tree."),
+                                         QStringLiteral("n"), QStringLiteral("16"));
+    const QCommandLineOption sensorsOption(QStringLiteral("sensors"), QStringLiteral("hwmon sensors in a generated tree."),
+                                           QStringLiteral("n"), QStringLiteral("20"));
+    parser.addOptions({ iterationsOption, generateOption, processesOption, coresOption, sensorsOption });
+    parser.addPositionalArgument(QStringLiteral("root"), QStringLiteral("Fixture root containing proc/ and sys/."));
+    parser.process(app);
+
+    const int iterations = std::max(1, parser.value(iterationsOption).toInt());
+    const QStringList roots = parser.positionalArguments();
+
+    if (parser.isSet(generateOption)) {
+        if (roots.size() != 1) {
+            parser.showHelp(1);
+        }
+
+        TreeShape shape;
+        shape.processes = parser.value(processesOption).toInt();
+        shape.cores = parser.value(coresOption).toInt();
+        shape.sensors = parser.value(sensorsOption).toInt();
+        return generateTree(roots.first(), shape) ? 0 : 1;
+    }
+
+    if (roots.size() == 1) {
+        qputenv("ORBITAL_PROC_ROOT", QFile::encodeName(roots.first() + QStringLiteral("/proc")));
+        qputenv("ORBITAL_SYS_ROOT", QFile::encodeName(roots.first() + QStringLiteral("/sys")));
+        CollectorBench bench(iterations);
+        bench.run();
+        return 0;
+    }
+
+    QTemporaryDir generated;
+    if (!generated.isValid() || !generateTree(generated.path(), TreeShape())) {
+        std::fprintf(stderr, "cannot generate the large fixture tree\n");
+        return 1;
+    }
+
+    const QList<QPair<QString, QString>> trees = {
+        { QStringLiteral("small (checked in)"), QStringLiteral(ORBITAL_BENCH_FIXTURE_DIR "/small") },
+        { QStringLiteral("large (2000 processes, 16 cores, 20 sensors)"), generated.path() },
+    };
+
+    int status = 0;
+    for (const auto &tree : trees) {
+        std::printf("\n== %s\n", qPrintable(tree.first));
+        std::fflush(stdout);
+
+        QProcess child;
+        child.setProcessChannelMode(QProcess::ForwardedChannels);
+        child.start(QCoreApplication::applicationFilePath(),
+                    { QStringLiteral("--iterations"), QString::number(iterations), tree.second });
+        if (!child.waitForFinished(-1) || child.exitCode() != 0) {
+            status = 1;
+        }
+    }
+
+    return status;
+}
@@ -5,12 +5,16 @@ Item {
     id: root
     
     property string chartTitle: "" 
+    // 每项为 { label, color, series } (C++ HistorySeries) 或 { label, color, values } (JS 数组)
     property var datasets: []      
     property double fixedMax: -1   
     property string suffix: ""     
     property bool showLegend: true 
+    // 图表横轴显示的采样点数，与 series 的容量无关
+    property int visibleSamples: 60
 
     property double _currentMaxY: 100 
+    property var _boundSeries: []
 
     Behavior on _currentMaxY {
         NumberAnimation { 
@@ -20,12 +24,57 @@ Item {
     }
 
     onDatasetsChanged: {
+        rebindSeries();
         calculateMax();
         canvas.requestPaint(); 
     }
 
+    onVisibleSamplesChanged: {
+        calculateMax();
+        canvas.requestPaint();
+    }
+
     on_CurrentMaxYChanged: canvas.requestPaint()
 
+    Component.onDestruction: unbindSeries()
+
+    function sampleCount(dataset) {
+        if (dataset.series) return dataset.series.count;
+        return dataset.values ? dataset.values.length : 0;
+    }
+
+    function sampleAt(dataset, index) {
+        return dataset.series ? dataset.series.valueAt(index) : dataset.values[index];
+    }
+
+    // 新采样到达时只重绘，不再整体拷贝历史数组
+    function handleSeriesSample() {
+        calculateMax();
+        canvas.requestPaint();
+    }
+
+    function unbindSeries() {
+        for (var i = 0; i < root._boundSeries.length; i++) {
+            root._boundSeries[i].sampleAppended.disconnect(root.handleSeriesSample);
+        }
+        root._boundSeries = [];
+    }
+
+    function rebindSeries() {
+        unbindSeries();
+        if (!root.datasets) return;
+
+        var bound = [];
+        for (var d = 0; d < root.datasets.length; d++) {
+            var series = root.datasets[d].series;
+            if (series && bound.indexOf(series) < 0) {
+                series.sampleAppended.connect(root.handleSeriesSample);
+                bound.push(series);
+            }
+        }
+        root._boundSeries = bound;
+    }
+
     function calculateMax() {
         if (!root.datasets || root.datasets.length === 0) return;
 
@@ -34,9 +83,14 @@ Item {
             globalMax = root.fixedMax;
         } else {
             for (var d = 0; d < root.datasets.length; d++) {
-                var vals = root.datasets[d].values;
+                var dataset = root.datasets[d];
+                if (dataset.series) {
+                    globalMax = Math.max(globalMax, dataset.series.maxValue(root.visibleSamples));
+                    continue;
+                }
+                var vals = dataset.values;
                 if (!vals) continue;
-                for (var i = 0; i < vals.length; i++) {
+                for (var i = Math.max(0, vals.length - root.visibleSamples); i < vals.length; i++) {
                     if (vals[i] > globalMax) globalMax = vals[i];
                 }
             }
@@ -91,24 +145,36 @@ Item {
                     // --- 绘制曲线 ---
                     function getY(val) { return h - (val / drawMax * h); }
 
+                    // 数据右对齐：不足 visibleSamples 个点时从右侧开始绘制
+                    var slots = Math.max(2, root.visibleSamples);
+                    var stepX = w / (slots - 1);
+
                     for (var k = 0; k < root.datasets.length; k++) {
-                        var series = root.datasets[k];
-                        var data = series.values;
-                        var color = series.color;
+                        var dataset = root.datasets[k];
+                        var count = root.sampleCount(dataset);
+                        var color = dataset.color;
 
-                        if (!data || data.length < 2) continue;
+                        if (count < 2) continue;
 
-                        var stepX = w / (data.length - 1);
+                        var first = Math.max(0, count - slots);
+                        var points = count - first;
+                        var startX = (slots - points) * stepX;
+
+                        // 先取出可见窗口内的点，避免两次遍历都调用 C++
+                        var data = new Array(points);
+                        for (var p = 0; p < points; p++) {
+                            data[p] = root.sampleAt(dataset, first + p);
+                        }
 
                         // 填充
                         ctx.save(); 
                         ctx.beginPath();
-                        ctx.moveTo(0, getY(data[0]));
-                        for (var i = 1; i < data.length; i++) {
-                            ctx.lineTo(i * stepX, getY(data[i]));
+                        ctx.moveTo(startX, getY(data[0]));
+                        for (var i = 1; i < points; i++) {
+                            ctx.lineTo(startX + i * stepX, getY(data[i]));
                         }
-                        ctx.lineTo((data.length - 1) * stepX, h);
-                        ctx.lineTo(0, h);
+                        ctx.lineTo(startX + (points - 1) * stepX, h);
+                        ctx.lineTo(startX, h);
                         ctx.closePath();
                         ctx.globalAlpha = 0.2; 
                         ctx.fillStyle = color;
@@ -117,9 +183,9 @@ Item {
 
                         // 描边
                         ctx.beginPath();
-                        ctx.moveTo(0, getY(data[0]));
-                        for (var i = 1; i < data.length; i++) {
-                            ctx.lineTo(i * stepX, getY(data[i]));
+                        ctx.moveTo(startX, getY(data[0]));
+                        for (var j = 1; j < points; j++) {
+                            ctx.lineTo(startX + j * stepX, getY(data[j]));
                         }
                         ctx.lineJoin = "round";
                         ctx.lineCap = "round";
@@ -14,9 +14,48 @@ Window {
 
     property bool historyExpanded: true
     property string screenshotToastMessage: ""
+    // 0 = 实时 (内存中的 HistorySeries)，其余为从磁盘历史库查询的秒数
+    property int historyRangeSec: 0
+    property var storedHistory: ({})
+
+    function refreshStoredHistory() {
+        var store = backend.historyStore
+        if (historyRangeSec <= 0 || !store || !store.enabled) {
+            storedHistory = ({})
+            return
+        }
+
+        var result = {}
+        var names = ["cpu", "mem", "netRx", "netTx", "psiCpu", "psiMem", "psiIo"]
+        for (var i = 0; i < names.length; i++) {
+            result[names[i]] = store.queryRecent(names[i], historyRangeSec, 120).values
+        }
+        storedHistory = result
+    }
+
+    function historyDataset(label, series, metric, color) {
+        if (historyRangeSec > 0)
+            return { label: label, values: storedHistory[metric] || [], color: color }
+        return { label: label, series: series, color: color }
+    }
+
+    onHistoryRangeSecChanged: refreshStoredHistory()
+
+    Timer {
+        interval: window.historyRangeSec > 3600 ? 60000 : 5000
+        running: window.historyRangeSec > 0
+        repeat: true
+        onTriggered: window.refreshStoredHistory()
+    }
 
     SystemMonitor {
         id: backend
+        // 记录交互期间的帧间隔，用于对比触摸升频前后的帧时间；
+        // 渲染线程启动后按 CPU 拓扑重新放置线程
+        Component.onCompleted: {
+            touchBoost.trackWindow(window)
+            threadPolicy.trackWindow(window)
+        }
     }
 
     TerminalBackend {
@@ -120,6 +159,11 @@ Window {
             window.showScreenshotToast(message)
         }
 
+        function onPressureAlert(resource, values) {
+            window.showScreenshotToast("High " + resource + " pressure: "
+                                       + Number(values.someAvg10 || 0).toFixed(1) + "% stalled")
+        }
+
         function onPluginPageRequested(url, props) {
             stackView.push(url, props)
         }
@@ -131,6 +175,21 @@ Window {
 
     // ================= POPUPS =================
 
+    // 弹窗打开时提高对应数据的采样频率
+    MetricSubscription {
+        scheduler: backend.metricScheduler
+        metrics: ["disk"]
+        interval: 2000
+        active: diskPopup.visible
+    }
+
+    MetricSubscription {
+        scheduler: backend.metricScheduler
+        metrics: ["battery"]
+        interval: 2000
+        active: batPopup.visible
+    }
+
     Popup {
         id: cpuDetailsPopup
         parent: Overlay.overlay
@@ -172,7 +231,61 @@ Window {
                 Layout.alignment: Qt.AlignHCenter
             }
 
+            // 各状态时间占比 (iowait / irq / steal 不再被算作空闲)
+            Text {
+                property var cpuState: backend.cpuStates
+                Layout.fillWidth: true
+                Layout.leftMargin: 20
+                Layout.rightMargin: 20
+                text: "usr " + ((cpuState.user + cpuState.nice) * 100).toFixed(0) + "%  "
+                    + "sys " + (cpuState.system * 100).toFixed(0) + "%  "
+                    + "io " + (cpuState.iowait * 100).toFixed(0) + "%  "
+                    + "irq " + ((cpuState.irq + cpuState.softirq) * 100).toFixed(0) + "%  "
+                    + "steal " + (cpuState.steal * 100).toFixed(0) + "%"
+                color: "#aaaaaa"
+                font.pixelSize: 12
+                font.family: "Monospace"
+                horizontalAlignment: Text.AlignHCenter
+            }
+
+            // 每核心热力图：一行一个核心，从左 (旧) 到右 (新)
+            Canvas {
+                id: cpuHeatmapCanvas
+                Layout.fillWidth: true
+                Layout.leftMargin: 20
+                Layout.rightMargin: 20
+                Layout.preferredHeight: Math.min(120, Math.max(1, backend.cpuCoreStates.length) * 10)
+                renderTarget: Canvas.Image
+
+                onPaint: {
+                    var ctx = getContext("2d")
+                    ctx.clearRect(0, 0, width, height)
+
+                    var rows = backend.cpuHeatmap
+                    if (!rows || rows.length === 0) return
+
+                    var rowHeight = height / rows.length
+                    for (var r = 0; r < rows.length; r++) {
+                        var row = rows[r]
+                        var cellWidth = width / Math.max(1, row.length)
+                        for (var c = 0; c < row.length; c++) {
+                            ctx.fillStyle = cpuColor(row[c] / 100)
+                            ctx.globalAlpha = 0.25 + 0.75 * row[c] / 100
+                            ctx.fillRect(c * cellWidth, r * rowHeight, Math.ceil(cellWidth), rowHeight - 1)
+                        }
+                    }
+                    ctx.globalAlpha = 1.0
+                }
+
+                Connections {
+                    target: backend
+                    enabled: cpuDetailsPopup.visible
+                    function onCpuDetailsChanged() { cpuHeatmapCanvas.requestPaint() }
+                }
+            }
+
             ListView {
+                id: cpuCoreList
                 focus: true
                 Layout.fillWidth: true
                 Layout.fillHeight: true
@@ -180,6 +293,8 @@ Window {
                 Layout.leftMargin: 20
                 Layout.rightMargin: 20 
                 model: backend.cpuCores
+                // 每次读取 cpuCoreStates 都会重建整个列表，这里只读一次供各行索引
+                property var coreStates: backend.cpuCoreStates
                 spacing: 15
                 clip: true
                 
@@ -195,6 +310,16 @@ Window {
                             font.pixelSize: 14 
                         }
                         Item { Layout.fillWidth: true } // 弹簧占位
+                        Text {
+                            // 中断或 iowait 偏高时单独提示，便于发现中断风暴
+                            property var coreState: cpuCoreList.coreStates[index]
+                            visible: !!coreState && (coreState.irq >= 0.1 || coreState.iowait >= 0.1)
+                            text: coreState ? "irq " + (coreState.irq * 100).toFixed(0) + "%  io "
+                                              + (coreState.iowait * 100).toFixed(0) + "%" : ""
+                            color: "#FFC107"
+                            font.pixelSize: 12
+                            font.family: "Monospace"
+                        }
                         Text { 
                             text: (modelData * 100).toFixed(1) + "%"
                             color: "white"
@@ -299,8 +424,9 @@ Window {
                             }
                             
                             Text { 
-                                text: modelData.used + " / " + modelData.size
-                                color: "#aaaaaa"
+                                // 挂载点无响应时标记为过期
+                                text: modelData.stale ? "Not responding" : modelData.used + " / " + modelData.size
+                                color: modelData.stale ? "#FFB020" : "#aaaaaa"
                                 font.pixelSize: 12
                                 // 强制不换行，保持右侧对齐
                                 Layout.preferredWidth: implicitWidth 
@@ -809,6 +935,25 @@ Window {
     Component {
         id: homePage
         Item {
+            id: homeView
+
+            // 仪表盘只在可见且亮屏时采样
+            readonly property bool sampling: backend.isScreenOn && homeView.StackView.status === StackView.Active
+
+            MetricSubscription {
+                scheduler: backend.metricScheduler
+                metrics: ["cpu", "memory", "network", "pressure"]
+                interval: 1000
+                active: homeView.sampling
+            }
+
+            MetricSubscription {
+                scheduler: backend.metricScheduler
+                metrics: ["disk", "battery"]
+                interval: 5000
+                active: homeView.sampling
+            }
+
             Rectangle { 
                 anchors.fill: parent
                 color: "#121212"
@@ -1070,13 +1215,51 @@ Window {
                         anchors.margins: 15 
                         spacing: 5 // 减小间距，因为图表内部有 padding
 
-                        Text {
-                            text: "System History"
-                            color: "white"
-                            font.pixelSize: 16
-                            font.bold: true
-                            Layout.alignment: Qt.AlignVCenter
+                        RowLayout {
+                            Layout.fillWidth: true
                             Layout.bottomMargin: 5
+                            spacing: 6
+
+                            Text {
+                                text: "System History"
+                                color: "white"
+                                font.pixelSize: 16
+                                font.bold: true
+                                Layout.alignment: Qt.AlignVCenter
+                            }
+
+                            Item { Layout.fillWidth: true }
+
+                            Repeater {
+                                model: backend.historyStore && backend.historyStore.enabled
+                                       ? [ { label: "Live", seconds: 0 },
+                                           { label: "1h", seconds: 3600 },
+                                           { label: "24h", seconds: 86400 },
+                                           { label: "7d", seconds: 604800 } ]
+                                       : []
+
+                                delegate: Rectangle {
+                                    implicitWidth: rangeLabel.implicitWidth + 16
+                                    implicitHeight: 24
+                                    radius: 12
+                                    color: window.historyRangeSec === modelData.seconds ? "#203546" : "#181D25"
+                                    border.width: 1
+                                    border.color: window.historyRangeSec === modelData.seconds ? "#81A1C1" : "#2F3847"
+
+                                    Text {
+                                        id: rangeLabel
+                                        anchors.centerIn: parent
+                                        text: modelData.label
+                                        color: window.historyRangeSec === modelData.seconds ? "#F4F8FB" : "#AAB6C5"
+                                        font.pixelSize: 11
+                                        font.bold: true
+                                    }
+
+                                    TapHandler {
+                                        onTapped: window.historyRangeSec = modelData.seconds
+                                    }
+                                }
+                            }
                         }
 
                         ColumnLayout {
@@ -1089,13 +1272,10 @@ Window {
                                 Layout.fillHeight: true
                                 
                                 chartTitle: "CPU Usage"
+                                visibleSamples: window.historyRangeSec > 0 ? 120 : 60
                                 
                                 datasets: [
-                                    { 
-                                        label: "Total", 
-                                        values: backend.cpuHistory, 
-                                        color: "#FF5252" 
-                                    }
+                                    window.historyDataset("Total", backend.cpuHistory, "cpu", "#FF5252")
                                 ]
                                 fixedMax: 100
                                 suffix: "%"
@@ -1110,13 +1290,10 @@ Window {
                                 Layout.fillHeight: true
                                 
                                 chartTitle: "Memory Usage" // 【传入标题】
+                                visibleSamples: window.historyRangeSec > 0 ? 120 : 60
                                 
                                 datasets: [
-                                    { 
-                                        label: "RAM", 
-                                        values: backend.memHistory, 
-                                        color: "#2196F3" 
-                                    }
+                                    window.historyDataset("RAM", backend.memHistory, "mem", "#2196F3")
                                 ]
                                 fixedMax: 100
                                 suffix: "%"
@@ -1130,11 +1307,12 @@ Window {
                             LineChart {
                                 Layout.fillWidth: true; Layout.fillHeight: true
                                 chartTitle: "Network I/O"
+                                visibleSamples: window.historyRangeSec > 0 ? 120 : 60
                                 
                                 // 双曲线
                                 datasets: [
-                                    { label: "Down", values: backend.netRxHistory, color: "#00E676" },
-                                    { label: "Up",   values: backend.netTxHistory, color: "#FF9800" }
+                                    window.historyDataset("Down", backend.netRxHistory, "netRx", "#00E676"),
+                                    window.historyDataset("Up",   backend.netTxHistory, "netTx", "#FF9800")
                                 ]
                                 
                                 // 开启自动缩放
@@ -1143,6 +1321,27 @@ Window {
                                 // (虽然主页卡片显示 MB/s，但折线图保持统一单位更稳定)
                                 suffix: " KB/s" 
                             }
+
+                            Rectangle { 
+                                Layout.fillWidth: true; height: 3; color: "#333333" 
+                            }
+
+                            // 4. PSI：任务因资源不足而停顿的时间占比 (some avg10)
+                            LineChart {
+                                Layout.fillWidth: true; Layout.fillHeight: true
+                                visible: Object.keys(backend.pressure).length > 0
+                                chartTitle: "Pressure"
+                                visibleSamples: window.historyRangeSec > 0 ? 120 : 60
+
+                                datasets: [
+                                    window.historyDataset("CPU", backend.pressureCpuHistory, "psiCpu", "#FF5252"),
+                                    window.historyDataset("Mem", backend.pressureMemoryHistory, "psiMem", "#2196F3"),
+                                    window.historyDataset("IO",  backend.pressureIoHistory, "psiIo", "#FFB020")
+                                ]
+
+                                fixedMax: -1
+                                suffix: "%"
+                            }
                         }
                     }
                 }
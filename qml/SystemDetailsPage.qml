@@ -2,6 +2,7 @@ import QtQuick
 import QtQuick.Controls
 import QtQuick.Controls.impl
 import QtQuick.Layouts
+import MyDesktop.Backend 1.0
 
 Page {
     id: detailsPage
@@ -9,6 +10,12 @@ Page {
 
     property var backend
     readonly property var detailsCtrl: backend ? backend.systemDetailsBackend : null
+    readonly property var cgroupCtrl: backend ? backend.cgroupMonitor : null
+    readonly property var profileCtrl: backend ? backend.cpuProfiles : null
+    readonly property var boostCtrl: backend ? backend.touchBoost : null
+    readonly property var threadCtrl: backend ? backend.threadPolicy : null
+    readonly property var vmStatCtrl: backend ? backend.vmStat : null
+    readonly property var perfCtrl: backend ? backend.perfEvents : null
     property int processDisplayCount: 5
 
     function displayedTopProcesses() {
@@ -18,18 +25,48 @@ Page {
         return detailsCtrl.topProcesses.slice(0, processDisplayCount)
     }
 
+    readonly property bool pageActive: StackView.status === StackView.Active && (!backend || backend.isScreenOn)
+
     function syncBackendActiveState() {
         if (detailsCtrl)
-            detailsCtrl.active = StackView.status === StackView.Active
+            detailsCtrl.active = pageActive
     }
 
-    StackView.onStatusChanged: syncBackendActiveState()
+    onPageActiveChanged: syncBackendActiveState()
     Component.onCompleted: syncBackendActiveState()
     Component.onDestruction: {
         if (detailsCtrl)
             detailsCtrl.active = false
     }
 
+    MetricSubscription {
+        scheduler: backend ? backend.metricScheduler : null
+        metrics: ["load", "disk"]
+        interval: 2000
+        active: detailsPage.pageActive
+    }
+
+    MetricSubscription {
+        scheduler: backend ? backend.metricScheduler : null
+        metrics: ["vmstat"]
+        interval: 2000
+        active: detailsPage.pageActive && !!vmStatCtrl && vmStatCtrl.available
+    }
+
+    MetricSubscription {
+        scheduler: backend ? backend.metricScheduler : null
+        metrics: ["perf"]
+        interval: 2000
+        active: detailsPage.pageActive && !!perfCtrl && perfCtrl.available
+    }
+
+    MetricSubscription {
+        scheduler: backend ? backend.metricScheduler : null
+        metrics: ["cgroups"]
+        interval: 2000
+        active: detailsPage.pageActive && !!cgroupCtrl && cgroupCtrl.available
+    }
+
     component SectionCard : Rectangle {
         color: "#1e1e1e"
         radius: 12
@@ -125,6 +162,35 @@ Page {
         }
     }
 
+    component OptionChip : Rectangle {
+        id: optionChip
+
+        property string label: ""
+        property bool active: false
+        signal tapped()
+
+        implicitWidth: optionText.implicitWidth + 20
+        implicitHeight: 30
+        radius: 15
+        color: active ? "#203546" : (optionTap.pressed ? "#222B36" : "#181D25")
+        border.width: 1
+        border.color: active ? "#81A1C1" : "#2F3847"
+
+        Text {
+            id: optionText
+            anchors.centerIn: parent
+            text: optionChip.label
+            color: optionChip.active ? "#F4F8FB" : "#AAB6C5"
+            font.pixelSize: 12
+            font.bold: true
+        }
+
+        TapHandler {
+            id: optionTap
+            onTapped: optionChip.tapped()
+        }
+    }
+
     ColumnLayout {
         anchors.fill: parent
         spacing: 0
@@ -385,6 +451,100 @@ Page {
                                 }
                             }
                         }
+
+                        // 内存动态：缺页、换入换出、回收扫描与工作集回填速率，用于调整 swappiness
+                        ColumnLayout {
+                            Layout.fillWidth: true
+                            spacing: 4
+                            visible: !!vmStatCtrl && !!vmStatCtrl.rates.valid
+
+                            Repeater {
+                                model: {
+                                    var r = vmStatCtrl ? vmStatCtrl.rates : ({})
+                                    if (!r.valid)
+                                        return []
+                                    return [
+                                        { label: "Major faults", value: r.displayMajorFaults },
+                                        { label: "Swap in / out", value: r.displaySwapIn + " / " + r.displaySwapOut },
+                                        { label: "Scan kswapd / direct", value: r.displayScanKswapd + " / " + r.displayScanDirect },
+                                        { label: "Reclaim efficiency", value: r.displayReclaimEfficiency },
+                                        { label: "Refaults", value: r.displayRefaults },
+                                        { label: "Swappiness", value: "" + r.swappiness }
+                                    ]
+                                }
+
+                                delegate: RowLayout {
+                                    Layout.fillWidth: true
+                                    spacing: 8
+
+                                    Text {
+                                        text: modelData.label
+                                        color: "#9AA7B7"
+                                        font.pixelSize: 12
+                                        Layout.fillWidth: true
+                                    }
+
+                                    Text {
+                                        text: modelData.value
+                                        color: "white"
+                                        font.pixelSize: 12
+                                        font.family: "Monospace"
+                                    }
+                                }
+                            }
+                        }
+
+                        // zram：压缩比按实际占用内存计算，节省量 = 原始数据 - 占用
+                        Repeater {
+                            model: vmStatCtrl ? vmStatCtrl.zram : []
+
+                            delegate: ColumnLayout {
+                                Layout.fillWidth: true
+                                spacing: 4
+
+                                RowLayout {
+                                    Layout.fillWidth: true
+                                    spacing: 8
+
+                                    Text {
+                                        text: modelData.name + " (" + modelData.algorithm + ")"
+                                        color: "#9AA7B7"
+                                        font.pixelSize: 13
+                                        Layout.fillWidth: true
+                                        elide: Text.ElideRight
+                                    }
+
+                                    Text {
+                                        text: modelData.displayRatio + "  saved " + modelData.displaySaved
+                                        color: "white"
+                                        font.pixelSize: 13
+                                        font.bold: true
+                                        font.family: "Monospace"
+                                    }
+                                }
+
+                                Rectangle {
+                                    Layout.fillWidth: true
+                                    height: 6
+                                    radius: 3
+                                    color: "#2A3240"
+
+                                    Rectangle {
+                                        width: Math.max(0, Math.min(1, modelData.fill)) * parent.width
+                                        height: parent.height
+                                        radius: 3
+                                        color: "#88C0D0"
+                                    }
+                                }
+
+                                Text {
+                                    text: modelData.displayStored + " stored in " + modelData.displayUsed
+                                          + " of " + modelData.displayDiskSize
+                                    color: "#777"
+                                    font.pixelSize: 11
+                                }
+                            }
+                        }
                     }
                 }
 
@@ -481,49 +641,70 @@ Page {
 
                             delegate: Rectangle {
                                 Layout.fillWidth: true
-                                implicitHeight: 56
+                                implicitHeight: diskRowLayout.implicitHeight + 20
                                 radius: 10
                                 color: "#181D25"
                                 border.width: 1
                                 border.color: "#2A3240"
 
-                                RowLayout {
+                                ColumnLayout {
+                                    id: diskRowLayout
                                     anchors.fill: parent
                                     anchors.leftMargin: 14
                                     anchors.rightMargin: 14
-                                    spacing: 10
+                                    anchors.topMargin: 10
+                                    anchors.bottomMargin: 10
+                                    spacing: 6
 
-                                    Text {
-                                        text: modelData.device
-                                        color: "#9AA7B7"
-                                        font.pixelSize: 13
-                                        font.bold: true
+                                    RowLayout {
                                         Layout.fillWidth: true
-                                        elide: Text.ElideRight
-                                    }
-
-                                    ColumnLayout {
-                                        spacing: 2
-                                        Layout.alignment: Qt.AlignVCenter
+                                        spacing: 10
 
                                         Text {
-                                            text: "R " + modelData.readSpeed
-                                            color: "#42A5F5"
-                                            font.pixelSize: 12
-                                            font.family: "Monospace"
-                                            horizontalAlignment: Text.AlignRight
-                                            Layout.alignment: Qt.AlignRight
+                                            text: modelData.device
+                                            color: "#9AA7B7"
+                                            font.pixelSize: 13
+                                            font.bold: true
+                                            Layout.fillWidth: true
+                                            elide: Text.ElideRight
                                         }
 
-                                        Text {
-                                            text: "W " + modelData.writeSpeed
-                                            color: "#FF7043"
-                                            font.pixelSize: 12
-                                            font.family: "Monospace"
-                                            horizontalAlignment: Text.AlignRight
-                                            Layout.alignment: Qt.AlignRight
+                                        ColumnLayout {
+                                            spacing: 2
+                                            Layout.alignment: Qt.AlignVCenter
+
+                                            Text {
+                                                text: "R " + modelData.readSpeed
+                                                color: "#42A5F5"
+                                                font.pixelSize: 12
+                                                font.family: "Monospace"
+                                                horizontalAlignment: Text.AlignRight
+                                                Layout.alignment: Qt.AlignRight
+                                            }
+
+                                            Text {
+                                                text: "W " + modelData.writeSpeed
+                                                color: "#FF7043"
+                                                font.pixelSize: 12
+                                                font.family: "Monospace"
+                                                horizontalAlignment: Text.AlignRight
+                                                Layout.alignment: Qt.AlignRight
+                                            }
                                         }
                                     }
+
+                                    // 平均每次请求耗时、设备忙碌比例与队列深度，用于判断存储是否成为瓶颈
+                                    Text {
+                                        Layout.fillWidth: true
+                                        text: "await R " + modelData.readLatency + " / W " + modelData.writeLatency
+                                              + "  util " + modelData.displayUtilization
+                                              + "  queue " + modelData.displayQueueDepth
+                                              + "  in-flight " + modelData.inFlight
+                                              + (modelData.hasDiscards ? "  discard " + modelData.discardSpeed : "")
+                                        color: modelData.utilization > 0.9 ? "#FFB74D" : "#777"
+                                        font.pixelSize: 11
+                                        wrapMode: Text.WordWrap
+                                    }
                                 }
                             }
                         }
@@ -558,6 +739,125 @@ Page {
                             }
                         }
 
+                        // 性能配置：调速器与频率上下限，退出时恢复系统原值
+                        Flow {
+                            Layout.fillWidth: true
+                            spacing: 8
+                            visible: !!profileCtrl && profileCtrl.available
+
+                            OptionChip {
+                                label: "System"
+                                active: !!profileCtrl && profileCtrl.activeProfile === ""
+                                onTapped: profileCtrl.restoreDefaults()
+                            }
+
+                            Repeater {
+                                model: profileCtrl ? profileCtrl.profiles : []
+
+                                delegate: OptionChip {
+                                    label: modelData.name
+                                    active: profileCtrl.activeProfile === modelData.id
+                                    onTapped: profileCtrl.applyProfile(modelData.id)
+                                }
+                            }
+
+                            OptionChip {
+                                label: "+ Save current"
+                                onTapped: profileCtrl.saveCurrentAsProfile("Custom " + (profileCtrl.profiles.length - 2))
+                            }
+                        }
+
+                        Text {
+                            visible: !!profileCtrl && profileCtrl.lastError !== ""
+                            text: profileCtrl ? profileCtrl.lastError : ""
+                            color: "#FF7043"
+                            font.pixelSize: 11
+                            Layout.fillWidth: true
+                            wrapMode: Text.WrapAnywhere
+                        }
+
+                        // 触摸升频：交互期间临时抬高频率下限，并对比升频与否的交互帧时间
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 8
+                            visible: !!boostCtrl && boostCtrl.available
+
+                            OptionChip {
+                                label: "Touch boost"
+                                active: !!boostCtrl && boostCtrl.enabled
+                                onTapped: boostCtrl.enabled = !boostCtrl.enabled
+                            }
+
+                            Text {
+                                readonly property var stats: boostCtrl ? boostCtrl.frameStats : ({})
+                                Layout.fillWidth: true
+                                color: "#777"
+                                font.pixelSize: 11
+                                elide: Text.ElideRight
+                                text: {
+                                    if (!stats.boosted)
+                                        return ""
+                                    var line = "p95 frame " + stats.boosted.p95FrameMs.toFixed(1) + " ms"
+                                    if (stats.hasComparison)
+                                        line += " vs " + stats.plain.p95FrameMs.toFixed(1) + " ms ("
+                                                + (stats.p95Improvement * 100).toFixed(0) + "%)"
+                                    return line
+                                }
+                            }
+                        }
+
+                        // 线程放置：渲染线程在大核，后台采样线程在小核并以 SCHED_IDLE 运行
+                        Text {
+                            Layout.fillWidth: true
+                            visible: !!threadCtrl && threadCtrl.placements.length > 0
+                            color: "#777"
+                            font.pixelSize: 11
+                            wrapMode: Text.WordWrap
+                            text: {
+                                if (!threadCtrl)
+                                    return ""
+                                var parts = []
+                                var placements = threadCtrl.placements
+                                for (var i = 0; i < placements.length; i++) {
+                                    var p = placements[i]
+                                    var part = p.role + " cpu" + p.cpus + " " + p.policy
+                                    if (p.nice !== 0)
+                                        part += " nice " + p.nice
+                                    if (p.error !== "")
+                                        part += " (" + p.error + ")"
+                                    parts.push(part)
+                                }
+                                return parts.join(" · ")
+                            }
+                        }
+
+                        // 内核软件计数器 (perf_event)：上下文切换、迁移、缺页；无权限时仅统计本进程
+                        Text {
+                            readonly property var rates: perfCtrl ? perfCtrl.rates : ({})
+                            Layout.fillWidth: true
+                            visible: !!perfCtrl && (rates.valid === true || perfCtrl.limitation !== "")
+                            color: "#777"
+                            font.pixelSize: 11
+                            wrapMode: Text.WordWrap
+                            text: {
+                                if (!perfCtrl)
+                                    return ""
+                                if (!perfCtrl.available)
+                                    return "perf: " + perfCtrl.limitation
+                                var line = ""
+                                if (rates.valid) {
+                                    line = "ctx " + rates.displayContextSwitches
+                                        + " · migr " + rates.displayMigrations
+                                        + " · faults " + rates.displayPageFaults
+                                    if (perfCtrl.scope === "process")
+                                        line += " · " + rates.displayClock
+                                }
+                                if (perfCtrl.limitation !== "")
+                                    line += (line !== "" ? "\n" : "") + perfCtrl.limitation
+                                return line
+                            }
+                        }
+
                         GridLayout {
                             Layout.fillWidth: true
                             columns: 2
@@ -614,6 +914,85 @@ Page {
                             visible: !detailsCtrl || detailsCtrl.cpuFrequencies.length === 0
                             text: "No CPU frequency data available"
                         }
+
+                        // 每个 cpufreq policy（簇）的频点驻留直方图；柱高为页面打开以来的累计占比
+                        Repeater {
+                            model: detailsCtrl ? detailsCtrl.cpuPolicies : []
+
+                            delegate: ColumnLayout {
+                                Layout.fillWidth: true
+                                spacing: 6
+
+                                RowLayout {
+                                    Layout.fillWidth: true
+                                    spacing: 8
+
+                                    Text {
+                                        text: modelData.label
+                                        color: "white"
+                                        font.pixelSize: 13
+                                        font.bold: true
+                                    }
+
+                                    Text {
+                                        text: modelData.displayFreq + " / " + modelData.displayMax
+                                        color: "#93A1B3"
+                                        font.pixelSize: 11
+                                    }
+
+                                    Item { Layout.fillWidth: true }
+
+                                    Text {
+                                        visible: modelData.capped
+                                        text: modelData.capReason === "thermal"
+                                              ? "Thermal cap " + modelData.coolingState + "/" + modelData.coolingMax
+                                              : "Capped"
+                                        color: modelData.capReason === "thermal" ? "#FF7043" : "#FFB020"
+                                        font.pixelSize: 11
+                                        font.bold: true
+                                    }
+
+                                    Text {
+                                        text: "Top " + modelData.displayTopShare
+                                        color: "#777"
+                                        font.pixelSize: 11
+                                    }
+                                }
+
+                                RowLayout {
+                                    Layout.fillWidth: true
+                                    Layout.preferredHeight: 56
+                                    spacing: 3
+
+                                    Repeater {
+                                        model: modelData.residency
+
+                                        delegate: Item {
+                                            Layout.fillWidth: true
+                                            Layout.fillHeight: true
+
+                                            Rectangle {
+                                                anchors.left: parent.left
+                                                anchors.right: parent.right
+                                                anchors.bottom: parent.bottom
+                                                anchors.bottomMargin: 14
+                                                height: Math.max(2, (parent.height - 14) * modelData.totalShare)
+                                                radius: 2
+                                                color: modelData.share > 0 ? "#42A5F5" : "#2F3847"
+                                            }
+
+                                            Text {
+                                                anchors.bottom: parent.bottom
+                                                anchors.horizontalCenter: parent.horizontalCenter
+                                                text: modelData.displayFreq
+                                                color: "#777"
+                                                font.pixelSize: 8
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
                     }
                 }
 
@@ -650,6 +1029,30 @@ Page {
                             }
                         }
 
+                        // 排序键；磁盘读写与上下文切换计数只在选中时才采样
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 8
+
+                            Repeater {
+                                model: [
+                                    { key: "cpu", label: "CPU" },
+                                    { key: "memory", label: "Mem" },
+                                    { key: "read", label: "Read" },
+                                    { key: "write", label: "Write" },
+                                    { key: "switches", label: "Ctx" }
+                                ]
+
+                                delegate: OptionChip {
+                                    label: modelData.label
+                                    active: !!detailsCtrl && detailsCtrl.processSortKey === modelData.key
+                                    onTapped: detailsCtrl.processSortKey = modelData.key
+                                }
+                            }
+
+                            Item { Layout.fillWidth: true }
+                        }
+
                         Repeater {
                             model: detailsPage.displayedTopProcesses()
 
@@ -696,6 +1099,19 @@ Page {
                                         Layout.preferredWidth: 44
                                     }
 
+                                    Text {
+                                        readonly property string sortKey: detailsCtrl ? detailsCtrl.processSortKey : "cpu"
+                                        visible: sortKey === "read" || sortKey === "write" || sortKey === "switches"
+                                        text: sortKey === "read" ? modelData.displayRead
+                                            : sortKey === "write" ? modelData.displayWrite
+                                            : modelData.displaySwitches
+                                        color: "#B48EAD"
+                                        font.pixelSize: 11
+                                        font.bold: true
+                                        horizontalAlignment: Text.AlignRight
+                                        Layout.preferredWidth: 64
+                                    }
+
                                     Text {
                                         text: modelData.displayMemory
                                         color: "#8FBCBB"
@@ -711,6 +1127,170 @@ Page {
                             visible: !detailsCtrl || detailsCtrl.topProcesses.length === 0
                             text: "Process usage will appear after the first sample"
                         }
+
+                        // 两次采样之间启动又退出的短命进程，仅在 proc connector 可用时出现
+                        Text {
+                            visible: !!detailsCtrl && detailsCtrl.recentExits.length > 0
+                            text: "Short-lived"
+                            color: "#AAB4C3"
+                            font.pixelSize: 12
+                            font.bold: true
+                            Layout.topMargin: 4
+                        }
+
+                        Repeater {
+                            model: detailsCtrl ? detailsCtrl.recentExits : []
+
+                            delegate: RowLayout {
+                                Layout.fillWidth: true
+                                spacing: 10
+
+                                Text {
+                                    text: modelData.name
+                                    color: "#D8DEE9"
+                                    font.pixelSize: 12
+                                    Layout.fillWidth: true
+                                    elide: Text.ElideRight
+                                }
+
+                                Text {
+                                    text: "PID " + modelData.pid
+                                    color: "#777"
+                                    font.pixelSize: 10
+                                }
+
+                                Text {
+                                    text: modelData.displayLifetime
+                                    color: "#8FBCBB"
+                                    font.pixelSize: 11
+                                    horizontalAlignment: Text.AlignRight
+                                    Layout.preferredWidth: 56
+                                }
+
+                                Text {
+                                    text: modelData.displayCpu
+                                    color: "#FF7043"
+                                    font.pixelSize: 11
+                                    horizontalAlignment: Text.AlignRight
+                                    Layout.preferredWidth: 56
+                                }
+                            }
+                        }
+                    }
+                }
+
+                // 按 systemd slice/服务聚合的 cgroup v2 资源占用，可展开为树
+                SectionCard {
+                    visible: !!cgroupCtrl && cgroupCtrl.available
+                    implicitHeight: serviceLayout.implicitHeight + 30
+
+                    ColumnLayout {
+                        id: serviceLayout
+                        anchors.fill: parent
+                        anchors.margins: 15
+                        spacing: 10
+
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 8
+
+                            Text {
+                                text: "Services"
+                                color: "white"
+                                font.pixelSize: 16
+                                font.bold: true
+                            }
+
+                            Item { Layout.fillWidth: true }
+
+                            Repeater {
+                                model: [
+                                    { key: "cpu", label: "CPU" },
+                                    { key: "memory", label: "Mem" },
+                                    { key: "io", label: "I/O" }
+                                ]
+
+                                delegate: OptionChip {
+                                    label: modelData.label
+                                    active: !!cgroupCtrl && cgroupCtrl.sortKey === modelData.key
+                                    onTapped: cgroupCtrl.sortKey = modelData.key
+                                }
+                            }
+                        }
+
+                        Repeater {
+                            model: cgroupCtrl ? cgroupCtrl.groups : []
+
+                            delegate: Rectangle {
+                                Layout.fillWidth: true
+                                implicitHeight: 44
+                                radius: 10
+                                color: groupTap.pressed ? "#1F2630" : "#181D25"
+                                border.width: 1
+                                border.color: "#2A3240"
+
+                                TapHandler {
+                                    id: groupTap
+                                    enabled: modelData.hasChildren
+                                    onTapped: cgroupCtrl.toggleExpanded(modelData.path)
+                                }
+
+                                RowLayout {
+                                    anchors.fill: parent
+                                    anchors.leftMargin: 12 + modelData.depth * 14
+                                    anchors.rightMargin: 12
+                                    spacing: 8
+
+                                    Text {
+                                        text: modelData.hasChildren ? (modelData.expanded ? "▾" : "▸") : ""
+                                        color: "#7F8A99"
+                                        font.pixelSize: 12
+                                        Layout.preferredWidth: 10
+                                    }
+
+                                    Text {
+                                        text: modelData.name
+                                        color: modelData.pressure >= 10 ? "#FFB020" : "white"
+                                        font.pixelSize: 12
+                                        font.bold: modelData.depth === 0
+                                        Layout.fillWidth: true
+                                        elide: Text.ElideMiddle
+                                    }
+
+                                    Text {
+                                        text: modelData.displayCpu
+                                        color: "#FF7043"
+                                        font.pixelSize: 12
+                                        font.bold: cgroupCtrl.sortKey === "cpu"
+                                        horizontalAlignment: Text.AlignRight
+                                        Layout.preferredWidth: 40
+                                    }
+
+                                    Text {
+                                        text: modelData.displayMemory
+                                        color: "#8FBCBB"
+                                        font.pixelSize: 11
+                                        font.bold: cgroupCtrl.sortKey === "memory"
+                                        horizontalAlignment: Text.AlignRight
+                                        Layout.preferredWidth: 60
+                                    }
+
+                                    Text {
+                                        text: modelData.displayIo
+                                        color: "#B48EAD"
+                                        font.pixelSize: 11
+                                        font.bold: cgroupCtrl.sortKey === "io"
+                                        horizontalAlignment: Text.AlignRight
+                                        Layout.preferredWidth: 64
+                                    }
+                                }
+                            }
+                        }
+
+                        EmptyState {
+                            visible: !cgroupCtrl || cgroupCtrl.groups.length === 0
+                            text: "Service usage will appear after the first sample"
+                        }
                     }
                 }
 
@@ -753,6 +1333,14 @@ Page {
                                     elide: Text.ElideRight
                                 }
 
+                                // 距离节流触发点的余量，低于 5 °C 时高亮
+                                Text {
+                                    visible: modelData.hasTrip
+                                    text: modelData.hasTrip ? modelData.displayTrip : ""
+                                    color: modelData.hasTrip && modelData.headroomC < 5 ? "#FFB020" : "#777"
+                                    font.pixelSize: 10
+                                }
+
                                 Text {
                                     text: modelData.displayTemp
                                     color: modelData.color
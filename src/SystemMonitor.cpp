@@ -1,28 +1,58 @@
 #include "SystemMonitor.h"
 
+#include "backend/CgroupMonitor.h"
+#include "backend/CpuProfileEngine.h"
 #include "backend/DisplayBackend.h"
+#include "backend/HistorySeries.h"
 #include "backend/LedBackend.h"
+#include "backend/MetricScheduler.h"
+#include "backend/MetricsExporter.h"
+#include "backend/NetlinkMonitor.h"
+#include "backend/PerfEventMonitor.h"
+#include "backend/PressureMonitor.h"
+#include "backend/SampleCache.h"
 #include "backend/SystemDetailsBackend.h"
 #include "backend/SystemHelpers.h"
 #include "backend/SystemStatsBackend.h"
+#include "backend/ThreadPolicy.h"
+#include "backend/TimeSeriesStore.h"
+#include "backend/TouchBoost.h"
+#include "backend/UeventMonitor.h"
+#include "backend/VmStatMonitor.h"
 #include "backend/WifiBackend.h"
 #include "plugins/OrbitalApi.h"
 #include "plugins/PluginManager.h"
 
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QProcess>
-#include <QTimer>
 #include <QUrl>
 
 SystemMonitor::SystemMonitor(QObject *parent)
     : QObject(parent)
-    , m_statsBackend(new SystemStatsBackend(this))
+    , m_scheduler(new MetricScheduler(this))
+    , m_netlink(new NetlinkMonitor(this))
+    , m_sampleCache(new SampleCache(m_netlink, this))
+    , m_uevent(new UeventMonitor(this))
+    , m_pressure(new PressureMonitor(this))
+    , m_vmStat(new VmStatMonitor(m_uevent, this))
+    , m_perfEvents(new PerfEventMonitor(this))
+    , m_cgroupMonitor(new CgroupMonitor(this))
+    , m_statsBackend(new SystemStatsBackend(m_netlink, m_uevent, m_sampleCache, this))
     , m_displayBackend(new DisplayBackend(this))
     , m_ledBackend(new LedBackend(this))
-    , m_systemDetailsBackend(new SystemDetailsBackend(this))
+    , m_systemDetailsBackend(new SystemDetailsBackend(m_scheduler, m_netlink, m_uevent, m_sampleCache, this))
+    , m_cpuProfiles(new CpuProfileEngine(this))
+    , m_touchBoost(new TouchBoost(this))
+    , m_threadPolicy(new ThreadPolicy(this))
     , m_wifiBackend(new WifiBackend(this))
     , m_pluginManager(new PluginManager(this))
-    , m_timer(new QTimer(this))
+    , m_historyStore(new TimeSeriesStore(
+          Backend::readEnvironmentValue("ORBITAL_HISTORY_STORE") == QLatin1String("0")
+              ? QString()
+              : QDir(Backend::stateDirectory()).filePath(QStringLiteral("history")),
+          this))
 {
     m_pluginManager->addRoot(QUrl(QStringLiteral("qrc:/MyDesktop/Backend/plugins/")));
     const QByteArray devRoot = qgetenv("ORBITAL_PLUGIN_DIR");
@@ -31,10 +61,44 @@ SystemMonitor::SystemMonitor(QObject *parent)
     }
     m_pluginManager->scan();
 
-    connect(m_statsBackend, &SystemStatsBackend::statsUpdated, this, [this]() {
-        m_wifiBackend->setNetworkInterfaces(m_statsBackend->netInterfaces());
+    m_sampleCache->attach(m_scheduler);
+    m_statsBackend->registerCollectors(m_scheduler);
+    m_pressure->registerCollector(m_scheduler);
+    m_vmStat->registerCollector(m_scheduler);
+    m_perfEvents->registerCollector(m_scheduler);
+    m_cgroupMonitor->registerCollector(m_scheduler);
+    connect(m_scheduler, &MetricScheduler::tickFinished, this, [this](const QStringList &sampled) {
+        recordHistory(sampled);
         emit statsChanged();
     });
+    // Only passes that produced a value reach the store; see recordHistory().
+    connect(m_statsBackend, &SystemStatsBackend::historySampled,
+            m_historyStore, &TimeSeriesStore::append);
+    connect(m_statsBackend, &SystemStatsBackend::cpuChanged,
+            this, &SystemMonitor::cpuChanged);
+    connect(m_statsBackend, &SystemStatsBackend::cpuDetailsChanged,
+            this, &SystemMonitor::cpuDetailsChanged);
+    connect(m_statsBackend, &SystemStatsBackend::memoryChanged,
+            this, &SystemMonitor::memoryChanged);
+    connect(m_statsBackend, &SystemStatsBackend::diskChanged,
+            this, &SystemMonitor::diskChanged);
+    connect(m_statsBackend, &SystemStatsBackend::batteryChanged,
+            this, &SystemMonitor::batteryChanged);
+    connect(m_statsBackend, &SystemStatsBackend::netSpeedChanged,
+            this, &SystemMonitor::netSpeedChanged);
+    connect(m_statsBackend, &SystemStatsBackend::loadAverageChanged,
+            this, &SystemMonitor::loadAverageChanged);
+    connect(m_statsBackend, &SystemStatsBackend::netInterfacesChanged, this, [this]() {
+        m_wifiBackend->setNetworkInterfaces(m_statsBackend->netInterfaces());
+        emit netInterfacesChanged();
+    });
+    m_wifiBackend->setNetworkInterfaces(m_statsBackend->netInterfaces());
+
+    connect(m_pressure, &PressureMonitor::pressureChanged,
+            this, &SystemMonitor::pressureChanged);
+    connect(m_pressure, &PressureMonitor::thresholdCrossed, this, [this](const QString &resource) {
+        emit pressureAlert(resource, m_pressure->values().value(resource).toMap());
+    });
 
     connect(m_displayBackend, &DisplayBackend::brightnessChanged,
             this, &SystemMonitor::brightnessChanged);
@@ -46,6 +110,10 @@ SystemMonitor::SystemMonitor(QObject *parent)
             this, &SystemMonitor::volumeKeyEvent);
     connect(m_displayBackend, &DisplayBackend::screenshotRequested,
             this, &SystemMonitor::screenshotRequested);
+    connect(m_displayBackend, &DisplayBackend::inputActivity,
+            m_touchBoost, &TouchBoost::poke);
+    connect(m_cpuProfiles, &CpuProfileEngine::aboutToChangeLimits,
+            m_touchBoost, &TouchBoost::release);
 
     connect(m_wifiBackend, &WifiBackend::wifiListChanged,
             this, &SystemMonitor::wifiListChanged);
@@ -56,9 +124,30 @@ SystemMonitor::SystemMonitor(QObject *parent)
     connect(m_wifiBackend, &WifiBackend::wifiOperationResult,
             this, &SystemMonitor::wifiOperationResult);
 
-    connect(m_timer, &QTimer::timeout, this, &SystemMonitor::refreshStats);
-    m_timer->start(1000);
-    QTimer::singleShot(0, this, &SystemMonitor::refreshStats);
+    // Everything else is sampled only while some page or plugin subscribes.
+    // The on-disk history needs its metrics continuously, though.
+    if (m_historyStore->enabled()) {
+        m_scheduler->subscribe({ QStringLiteral("cpu"), QStringLiteral("memory"), QStringLiteral("network"),
+                                 QStringLiteral("pressure") },
+                               1000);
+    }
+
+    // Opt-in scrape endpoint, e.g. ORBITAL_METRICS_LISTEN=127.0.0.1:9101 or
+    // ORBITAL_METRICS_LISTEN=unix:/run/user/1000/orbital-metrics.sock.
+    const QString metricsListen = Backend::readEnvironmentValue("ORBITAL_METRICS_LISTEN");
+    if (!metricsListen.isEmpty()) {
+        MetricsExporter::Sources sources;
+        sources.scheduler = m_scheduler;
+        sources.stats = m_statsBackend;
+        sources.details = m_systemDetailsBackend;
+        sources.pressure = m_pressure;
+        sources.netlink = m_netlink;
+        m_metricsExporter = new MetricsExporter(sources, this);
+        if (!m_metricsExporter->listen(metricsListen)) {
+            delete m_metricsExporter;
+            m_metricsExporter = nullptr;
+        }
+    }
 }
 
 double SystemMonitor::cpuTotal() const
@@ -71,6 +160,21 @@ QVariantList SystemMonitor::cpuCores() const
     return m_statsBackend->cpuCores();
 }
 
+QVariantMap SystemMonitor::cpuStates() const
+{
+    return m_statsBackend->cpuStates();
+}
+
+QVariantList SystemMonitor::cpuCoreStates() const
+{
+    return m_statsBackend->cpuCoreStates();
+}
+
+QVariantList SystemMonitor::cpuHeatmap() const
+{
+    return m_statsBackend->cpuHeatmap();
+}
+
 double SystemMonitor::memPercent() const
 {
     return m_statsBackend->memPercent();
@@ -111,22 +215,22 @@ QVariantMap SystemMonitor::batDetails() const
     return m_statsBackend->batDetails();
 }
 
-QVariantList SystemMonitor::cpuHistory() const
+QObject *SystemMonitor::cpuHistory() const
 {
     return m_statsBackend->cpuHistory();
 }
 
-QVariantList SystemMonitor::memHistory() const
+QObject *SystemMonitor::memHistory() const
 {
     return m_statsBackend->memHistory();
 }
 
-QVariantList SystemMonitor::netRxHistory() const
+QObject *SystemMonitor::netRxHistory() const
 {
     return m_statsBackend->netRxHistory();
 }
 
-QVariantList SystemMonitor::netTxHistory() const
+QObject *SystemMonitor::netTxHistory() const
 {
     return m_statsBackend->netTxHistory();
 }
@@ -146,6 +250,36 @@ QString SystemMonitor::loadAverage() const
     return m_statsBackend->loadAverage();
 }
 
+QVariantMap SystemMonitor::pressure() const
+{
+    return m_pressure->values();
+}
+
+QObject *SystemMonitor::pressureCpuHistory() const
+{
+    return m_pressure->cpuHistory();
+}
+
+QObject *SystemMonitor::pressureMemoryHistory() const
+{
+    return m_pressure->memoryHistory();
+}
+
+QObject *SystemMonitor::pressureIoHistory() const
+{
+    return m_pressure->ioHistory();
+}
+
+QObject *SystemMonitor::vmStat() const
+{
+    return m_vmStat;
+}
+
+QObject *SystemMonitor::perfEvents() const
+{
+    return m_perfEvents;
+}
+
 int SystemMonitor::brightness() const
 {
     return m_displayBackend->brightness();
@@ -211,6 +345,41 @@ QObject *SystemMonitor::pluginManager() const
     return m_pluginManager;
 }
 
+QObject *SystemMonitor::historyStore() const
+{
+    return m_historyStore;
+}
+
+QObject *SystemMonitor::cgroupMonitor() const
+{
+    return m_cgroupMonitor;
+}
+
+QObject *SystemMonitor::cpuProfiles() const
+{
+    return m_cpuProfiles;
+}
+
+QObject *SystemMonitor::touchBoost() const
+{
+    return m_touchBoost;
+}
+
+QObject *SystemMonitor::threadPolicy() const
+{
+    return m_threadPolicy;
+}
+
+QObject *SystemMonitor::metricScheduler() const
+{
+    return m_scheduler;
+}
+
+MetricScheduler *SystemMonitor::scheduler() const
+{
+    return m_scheduler;
+}
+
 QObject *SystemMonitor::apiFor(const QString &pluginId)
 {
     auto it = m_apis.constFind(pluginId);
@@ -288,7 +457,18 @@ void SystemMonitor::systemCmd(const QString &cmd)
     }
 }
 
-void SystemMonitor::refreshStats()
+void SystemMonitor::recordHistory(const QStringList &sampled)
 {
-    m_statsBackend->update();
+    if (!m_historyStore->enabled()) {
+        return;
+    }
+
+    // cpu, mem and network arrive through SystemStatsBackend::historySampled,
+    // which skips passes that only set a new baseline.
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (sampled.contains(QLatin1String("pressure")) && m_pressure->isAvailable()) {
+        m_historyStore->append(QStringLiteral("psiCpu"), m_pressure->resource(QStringLiteral("cpu")).some.avg10, now);
+        m_historyStore->append(QStringLiteral("psiMem"), m_pressure->resource(QStringLiteral("memory")).some.avg10, now);
+        m_historyStore->append(QStringLiteral("psiIo"), m_pressure->resource(QStringLiteral("io")).some.avg10, now);
+    }
 }
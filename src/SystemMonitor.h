@@ -3,41 +3,63 @@
 #include <QHash>
 #include <QJSValue>
 #include <QObject>
+#include <QStringList>
 #include <QUrl>
 #include <QVariantList>
 #include <QVariantMap>
 
-class QTimer;
+class CgroupMonitor;
+class CpuProfileEngine;
 class DisplayBackend;
 class LedBackend;
+class MetricScheduler;
+class MetricsExporter;
+class NetlinkMonitor;
 class OrbitalApi;
+class PerfEventMonitor;
 class PluginManager;
+class PressureMonitor;
+class SampleCache;
 class SystemDetailsBackend;
 class SystemStatsBackend;
+class ThreadPolicy;
+class TimeSeriesStore;
+class TouchBoost;
+class UeventMonitor;
+class VmStatMonitor;
 class WifiBackend;
 
 class SystemMonitor : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(double cpuTotal READ cpuTotal NOTIFY statsChanged)
-    Q_PROPERTY(QVariantList cpuCores READ cpuCores NOTIFY statsChanged)
-    Q_PROPERTY(double memPercent READ memPercent NOTIFY statsChanged)
-    Q_PROPERTY(QString memDetail READ memDetail NOTIFY statsChanged)
-    Q_PROPERTY(double diskPercent READ diskPercent NOTIFY statsChanged)
-    Q_PROPERTY(QString diskRootUsage READ diskRootUsage NOTIFY statsChanged)
-    Q_PROPERTY(QVariantList diskPartitions READ diskPartitions NOTIFY statsChanged)
-    Q_PROPERTY(int batPercent READ batPercent NOTIFY statsChanged)
-    Q_PROPERTY(QString batState READ batState NOTIFY statsChanged)
-    Q_PROPERTY(QVariantMap batDetails READ batDetails NOTIFY statsChanged)
-    Q_PROPERTY(QVariantList cpuHistory READ cpuHistory NOTIFY statsChanged)
-    Q_PROPERTY(QVariantList memHistory READ memHistory NOTIFY statsChanged)
-    Q_PROPERTY(QVariantList netRxHistory READ netRxHistory NOTIFY statsChanged)
-    Q_PROPERTY(QVariantList netTxHistory READ netTxHistory NOTIFY statsChanged)
-    Q_PROPERTY(QString netRxSpeed READ netRxSpeed NOTIFY statsChanged)
-    Q_PROPERTY(QString netTxSpeed READ netTxSpeed NOTIFY statsChanged)
-    Q_PROPERTY(QString loadAverage READ loadAverage NOTIFY statsChanged)
+    Q_PROPERTY(double cpuTotal READ cpuTotal NOTIFY cpuChanged)
+    Q_PROPERTY(QVariantList cpuCores READ cpuCores NOTIFY cpuChanged)
+    Q_PROPERTY(QVariantMap cpuStates READ cpuStates NOTIFY cpuDetailsChanged)
+    Q_PROPERTY(QVariantList cpuCoreStates READ cpuCoreStates NOTIFY cpuDetailsChanged)
+    Q_PROPERTY(QVariantList cpuHeatmap READ cpuHeatmap NOTIFY cpuDetailsChanged)
+    Q_PROPERTY(double memPercent READ memPercent NOTIFY memoryChanged)
+    Q_PROPERTY(QString memDetail READ memDetail NOTIFY memoryChanged)
+    Q_PROPERTY(double diskPercent READ diskPercent NOTIFY diskChanged)
+    Q_PROPERTY(QString diskRootUsage READ diskRootUsage NOTIFY diskChanged)
+    Q_PROPERTY(QVariantList diskPartitions READ diskPartitions NOTIFY diskChanged)
+    Q_PROPERTY(int batPercent READ batPercent NOTIFY batteryChanged)
+    Q_PROPERTY(QString batState READ batState NOTIFY batteryChanged)
+    Q_PROPERTY(QVariantMap batDetails READ batDetails NOTIFY batteryChanged)
+    Q_PROPERTY(QObject* cpuHistory READ cpuHistory CONSTANT)
+    Q_PROPERTY(QObject* memHistory READ memHistory CONSTANT)
+    Q_PROPERTY(QObject* netRxHistory READ netRxHistory CONSTANT)
+    Q_PROPERTY(QObject* netTxHistory READ netTxHistory CONSTANT)
+    Q_PROPERTY(QString netRxSpeed READ netRxSpeed NOTIFY netSpeedChanged)
+    Q_PROPERTY(QString netTxSpeed READ netTxSpeed NOTIFY netSpeedChanged)
+    Q_PROPERTY(QString loadAverage READ loadAverage NOTIFY loadAverageChanged)
+    Q_PROPERTY(QVariantMap pressure READ pressure NOTIFY pressureChanged)
+    Q_PROPERTY(QObject* pressureCpuHistory READ pressureCpuHistory CONSTANT)
+    Q_PROPERTY(QObject* pressureMemoryHistory READ pressureMemoryHistory CONSTANT)
+    Q_PROPERTY(QObject* pressureIoHistory READ pressureIoHistory CONSTANT)
+    Q_PROPERTY(QObject* vmStat READ vmStat CONSTANT)
+    Q_PROPERTY(QObject* perfEvents READ perfEvents CONSTANT)
     Q_PROPERTY(int brightness READ brightness WRITE setBrightness NOTIFY brightnessChanged)
-    Q_PROPERTY(QVariantList netInterfaces READ netInterfaces NOTIFY statsChanged)
+    Q_PROPERTY(QVariantList netInterfaces READ netInterfaces NOTIFY netInterfacesChanged)
     Q_PROPERTY(bool isScreenOn READ isScreenOn NOTIFY screenStateChanged)
     Q_PROPERTY(QString screenOffMethod READ screenOffMethod WRITE setScreenOffMethod NOTIFY screenOffMethodChanged)
     Q_PROPERTY(QVariantList wifiList READ wifiList NOTIFY wifiListChanged)
@@ -48,12 +70,21 @@ class SystemMonitor : public QObject
     Q_PROPERTY(QObject* ledBackend READ ledBackend CONSTANT)
     Q_PROPERTY(QObject* systemDetailsBackend READ systemDetailsBackend CONSTANT)
     Q_PROPERTY(QObject* pluginManager READ pluginManager CONSTANT)
+    Q_PROPERTY(QObject* historyStore READ historyStore CONSTANT)
+    Q_PROPERTY(QObject* cgroupMonitor READ cgroupMonitor CONSTANT)
+    Q_PROPERTY(QObject* cpuProfiles READ cpuProfiles CONSTANT)
+    Q_PROPERTY(QObject* touchBoost READ touchBoost CONSTANT)
+    Q_PROPERTY(QObject* threadPolicy READ threadPolicy CONSTANT)
+    Q_PROPERTY(QObject* metricScheduler READ metricScheduler CONSTANT)
 
 public:
     explicit SystemMonitor(QObject *parent = nullptr);
 
     double cpuTotal() const;
     QVariantList cpuCores() const;
+    QVariantMap cpuStates() const;
+    QVariantList cpuCoreStates() const;
+    QVariantList cpuHeatmap() const;
     double memPercent() const;
     QString memDetail() const;
     double diskPercent() const;
@@ -62,13 +93,19 @@ public:
     int batPercent() const;
     QString batState() const;
     QVariantMap batDetails() const;
-    QVariantList cpuHistory() const;
-    QVariantList memHistory() const;
-    QVariantList netRxHistory() const;
-    QVariantList netTxHistory() const;
+    QObject *cpuHistory() const;
+    QObject *memHistory() const;
+    QObject *netRxHistory() const;
+    QObject *netTxHistory() const;
     QString netRxSpeed() const;
     QString netTxSpeed() const;
     QString loadAverage() const;
+    QVariantMap pressure() const;
+    QObject *pressureCpuHistory() const;
+    QObject *pressureMemoryHistory() const;
+    QObject *pressureIoHistory() const;
+    QObject *vmStat() const;
+    QObject *perfEvents() const;
     int brightness() const;
     QVariantList netInterfaces() const;
     bool isScreenOn() const;
@@ -82,6 +119,13 @@ public:
     QObject *ledBackend() const;
     QObject *systemDetailsBackend() const;
     QObject *pluginManager() const;
+    QObject *historyStore() const;
+    QObject *cgroupMonitor() const;
+    QObject *cpuProfiles() const;
+    QObject *touchBoost() const;
+    QObject *threadPolicy() const;
+    QObject *metricScheduler() const;
+    MetricScheduler *scheduler() const;
 
     void setWifiEnabled(bool enable);
     void setBrightness(int percent);
@@ -103,7 +147,22 @@ public:
     Q_INVOKABLE void systemCmd(const QString &cmd);
 
 signals:
+    // Emitted once per scheduler tick that sampled anything. Property
+    // bindings use the per-metric signals below; this is only a heartbeat
+    // for plugins.
     void statsChanged();
+    void cpuChanged();
+    void cpuDetailsChanged();
+    void memoryChanged();
+    void diskChanged();
+    void batteryChanged();
+    void netSpeedChanged();
+    void loadAverageChanged();
+    void netInterfacesChanged();
+    void pressureChanged();
+    // A PSI trigger fired: `resource` ("cpu", "memory" or "io") stalled
+    // longer than the configured threshold within the trigger window.
+    void pressureAlert(QString resource, QVariantMap values);
     void brightnessChanged();
     void screenStateChanged();
     void screenOffMethodChanged();
@@ -117,17 +176,28 @@ signals:
     void pluginPageRequested(QUrl url, QVariantMap props);
     void pluginPopRequested();
 
-private slots:
-    void refreshStats();
-
 private:
+    void recordHistory(const QStringList &sampled);
+
+    MetricScheduler *m_scheduler = nullptr;
+    NetlinkMonitor *m_netlink = nullptr;
+    SampleCache *m_sampleCache = nullptr;
+    UeventMonitor *m_uevent = nullptr;
+    PressureMonitor *m_pressure = nullptr;
+    VmStatMonitor *m_vmStat = nullptr;
+    PerfEventMonitor *m_perfEvents = nullptr;
+    CgroupMonitor *m_cgroupMonitor = nullptr;
     SystemStatsBackend *m_statsBackend = nullptr;
     DisplayBackend *m_displayBackend = nullptr;
     LedBackend *m_ledBackend = nullptr;
     SystemDetailsBackend *m_systemDetailsBackend = nullptr;
+    CpuProfileEngine *m_cpuProfiles = nullptr;
+    TouchBoost *m_touchBoost = nullptr;
+    ThreadPolicy *m_threadPolicy = nullptr;
     WifiBackend *m_wifiBackend = nullptr;
     PluginManager *m_pluginManager = nullptr;
-    QTimer *m_timer = nullptr;
+    TimeSeriesStore *m_historyStore = nullptr;
+    MetricsExporter *m_metricsExporter = nullptr;
     QHash<QString, OrbitalApi *> m_apis;
     QHash<QString, QJSValue> m_pluginExports;
 };
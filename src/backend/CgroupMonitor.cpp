@@ -0,0 +1,316 @@
+#include "CgroupMonitor.h"
+
+#include "MetricScheduler.h"
+#include "SystemHelpers.h"
+
+#include <QFile>
+
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Deep enough for user.slice/user-1000.slice/user@1000.service/app.slice/x;
+// the node cap keeps a container host with thousands of scopes bounded.
+constexpr int kMaxDepth = 5;
+constexpr int kMaxNodes = 1024;
+constexpr int kReadBufferSize = 8192;
+
+QByteArray readGroupFile(const QByteArray &directory, const char *name)
+{
+    const QByteArray path = directory + '/' + name;
+    const int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return {};
+    }
+
+    char buffer[kReadBufferSize];
+    const ssize_t length = ::read(fd, buffer, sizeof(buffer));
+    ::close(fd);
+    return length > 0 ? QByteArray(buffer, static_cast<int>(length)) : QByteArray();
+}
+
+// Value of `key` in a "key value" or "key=value" list, 0 if absent.
+quint64 fieldValue(const QByteArray &line, const QByteArray &key)
+{
+    int index = 0;
+    while ((index = line.indexOf(key, index)) >= 0) {
+        const bool startsField = index == 0 || line.at(index - 1) == ' ' || line.at(index - 1) == '\n';
+        const int valueStart = index + key.size();
+        if (startsField && valueStart < line.size()
+            && (line.at(valueStart) == ' ' || line.at(valueStart) == '=')) {
+            int end = valueStart + 1;
+            while (end < line.size() && line.at(end) >= '0' && line.at(end) <= '9') {
+                ++end;
+            }
+            return line.mid(valueStart + 1, end - valueStart - 1).toULongLong();
+        }
+        index = valueStart;
+    }
+
+    return 0;
+}
+
+// "some avg10=1.23 ..." -> 1.23
+double someAvg10(const QByteArray &pressure)
+{
+    if (!pressure.startsWith("some ")) {
+        return 0.0;
+    }
+
+    const int start = pressure.indexOf("avg10=");
+    if (start < 0) {
+        return 0.0;
+    }
+
+    const int end = pressure.indexOf(' ', start);
+    return pressure.mid(start + 6, end < 0 ? -1 : end - start - 6).toDouble();
+}
+
+QString formatRate(double bytesPerSecond)
+{
+    return Backend::formatSpeed(static_cast<quint64>(std::max(0.0, bytesPerSecond)));
+}
+
+} // namespace
+
+CgroupMonitor::CgroupMonitor(QObject *parent)
+    : QObject(parent)
+    , m_root(Backend::sysPath(QStringLiteral("/fs/cgroup")))
+{
+    // Only the unified (v2) hierarchy has cgroup.controllers at its root.
+    m_available = QFile::exists(m_root + QStringLiteral("/cgroup.controllers"));
+    m_expanded.insert(QStringLiteral("system.slice"));
+
+    const long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    m_cpuCount = cpus > 0 ? static_cast<int>(cpus) : 1;
+}
+
+void CgroupMonitor::registerCollector(MetricScheduler *scheduler)
+{
+    scheduler->registerCollector(QStringLiteral("cgroups"), [this]() { sample(); });
+}
+
+bool CgroupMonitor::available() const
+{
+    return m_available;
+}
+
+QVariantList CgroupMonitor::groups() const
+{
+    return m_groups;
+}
+
+QString CgroupMonitor::sortKey() const
+{
+    return m_sortKey;
+}
+
+void CgroupMonitor::setSortKey(const QString &key)
+{
+    if (key == m_sortKey) {
+        return;
+    }
+
+    m_sortKey = key;
+    emit sortKeyChanged();
+    rebuildRows();
+}
+
+void CgroupMonitor::toggleExpanded(const QString &path)
+{
+    if (m_expanded.contains(path)) {
+        m_expanded.remove(path);
+    } else {
+        m_expanded.insert(path);
+    }
+
+    rebuildRows();
+}
+
+void CgroupMonitor::sample()
+{
+    if (!m_available) {
+        return;
+    }
+
+    // 0 on the first pass and after a suspend: rates stay 0, baselines move.
+    const double elapsedSec = m_clock.restart();
+
+    m_nodes.clear();
+    m_topLevel.clear();
+
+    // The root group itself only carries system-wide totals, so the tree
+    // starts at its children.
+    const QByteArray root = QFile::encodeName(m_root);
+    DIR *dir = ::opendir(root.constData());
+    if (!dir) {
+        return;
+    }
+
+    while (const dirent *entry = ::readdir(dir)) {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') {
+            continue;
+        }
+
+        const QString name = QString::fromUtf8(entry->d_name);
+        const int index = walk(root + '/' + entry->d_name, name, name, 0);
+        if (index >= 0) {
+            m_topLevel.append(index);
+        }
+    }
+    ::closedir(dir);
+
+    QHash<QString, Counters> current;
+    current.reserve(m_nodes.size());
+    for (Node &node : m_nodes) {
+        const auto previous = m_previous.constFind(node.path);
+        if (elapsedSec > 0.0 && previous != m_previous.constEnd()) {
+            node.cpuPercent = CounterRate::rateOver(node.usageUsec, previous->usageUsec, elapsedSec) / 1e6 * 100.0
+                / m_cpuCount;
+            node.readRate = CounterRate::rateOver(node.readBytes, previous->readBytes, elapsedSec);
+            node.writeRate = CounterRate::rateOver(node.writeBytes, previous->writeBytes, elapsedSec);
+        }
+
+        current.insert(node.path, { node.usageUsec, node.readBytes, node.writeBytes });
+    }
+    m_previous = current;
+
+    rebuildRows();
+}
+
+int CgroupMonitor::walk(const QByteArray &directory, const QString &path, const QString &name, int depth)
+{
+    if (m_nodes.size() >= kMaxNodes) {
+        return -1;
+    }
+
+    const int index = m_nodes.size();
+    Node node;
+    node.path = path;
+    node.name = name;
+    node.depth = depth;
+    readNode(directory, node);
+    m_nodes.append(node);
+
+    if (depth + 1 >= kMaxDepth) {
+        return index;
+    }
+
+    DIR *dir = ::opendir(directory.constData());
+    if (!dir) {
+        return index;
+    }
+
+    QVector<int> children;
+    while (const dirent *entry = ::readdir(dir)) {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') {
+            continue;
+        }
+
+        const QString childName = QString::fromUtf8(entry->d_name);
+        const int child = walk(directory + '/' + entry->d_name, path + QLatin1Char('/') + childName,
+                               childName, depth + 1);
+        if (child >= 0) {
+            children.append(child);
+        }
+    }
+    ::closedir(dir);
+
+    // m_nodes may have reallocated during the recursion.
+    m_nodes[index].children = children;
+    return index;
+}
+
+void CgroupMonitor::readNode(const QByteArray &directory, Node &node) const
+{
+    node.usageUsec = fieldValue(readGroupFile(directory, "cpu.stat"), QByteArrayLiteral("usage_usec"));
+    node.memoryBytes = readGroupFile(directory, "memory.current").trimmed().toLongLong();
+
+    const QByteArray io = readGroupFile(directory, "io.stat");
+    for (const QByteArray &line : io.split('\n')) {
+        node.readBytes += fieldValue(line, QByteArrayLiteral("rbytes"));
+        node.writeBytes += fieldValue(line, QByteArrayLiteral("wbytes"));
+    }
+
+    node.cpuPressure = someAvg10(readGroupFile(directory, "cpu.pressure"));
+    node.memoryPressure = someAvg10(readGroupFile(directory, "memory.pressure"));
+    node.ioPressure = someAvg10(readGroupFile(directory, "io.pressure"));
+}
+
+bool CgroupMonitor::lessThan(const Node &left, const Node &right) const
+{
+    if (m_sortKey == QLatin1String("name")) {
+        return left.name < right.name;
+    }
+
+    double leftValue = left.cpuPercent;
+    double rightValue = right.cpuPercent;
+    if (m_sortKey == QLatin1String("memory")) {
+        leftValue = left.memoryBytes;
+        rightValue = right.memoryBytes;
+    } else if (m_sortKey == QLatin1String("io")) {
+        leftValue = left.readRate + left.writeRate;
+        rightValue = right.readRate + right.writeRate;
+    }
+
+    if (leftValue != rightValue) {
+        return leftValue > rightValue;
+    }
+
+    return left.name < right.name;
+}
+
+void CgroupMonitor::appendRows(int index, QVariantList &rows) const
+{
+    const Node &node = m_nodes.at(index);
+    const bool expanded = m_expanded.contains(node.path);
+    const double pressure = std::max({ node.cpuPressure, node.memoryPressure, node.ioPressure });
+
+    QVariantMap row;
+    row[QStringLiteral("path")] = node.path;
+    row[QStringLiteral("name")] = node.name;
+    row[QStringLiteral("depth")] = node.depth;
+    row[QStringLiteral("hasChildren")] = !node.children.isEmpty();
+    row[QStringLiteral("expanded")] = expanded;
+    row[QStringLiteral("cpuPercent")] = node.cpuPercent;
+    row[QStringLiteral("displayCpu")] =
+        QStringLiteral("%1%").arg(QString::number(node.cpuPercent, 'f', node.cpuPercent >= 10.0 ? 0 : 1));
+    row[QStringLiteral("memoryBytes")] = node.memoryBytes;
+    row[QStringLiteral("displayMemory")] = Backend::formatSize(node.memoryBytes);
+    row[QStringLiteral("ioRate")] = node.readRate + node.writeRate;
+    row[QStringLiteral("displayIo")] = formatRate(node.readRate + node.writeRate);
+    row[QStringLiteral("pressure")] = pressure;
+    rows.append(row);
+
+    if (!expanded) {
+        return;
+    }
+
+    QVector<int> children = node.children;
+    std::sort(children.begin(), children.end(), [this](int left, int right) {
+        return lessThan(m_nodes.at(left), m_nodes.at(right));
+    });
+    for (int child : children) {
+        appendRows(child, rows);
+    }
+}
+
+void CgroupMonitor::rebuildRows()
+{
+    QVector<int> topLevel = m_topLevel;
+    std::sort(topLevel.begin(), topLevel.end(), [this](int left, int right) {
+        return lessThan(m_nodes.at(left), m_nodes.at(right));
+    });
+
+    QVariantList rows;
+    for (int index : topLevel) {
+        appendRows(index, rows);
+    }
+
+    m_groups = rows;
+    emit groupsChanged();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+#include "CounterRate.h"
+
+class MetricScheduler;
+
+// Per-service resource usage from the cgroup v2 hierarchy. The "cgroups"
+// collector walks /sys/fs/cgroup, reads cpu.stat, memory.current, io.stat
+// and the PSI files of every group, and turns the counters into rates. The
+// result is published as a flattened tree (depth-first, siblings sorted by
+// sortKey) containing only the rows whose parents are expanded.
+class CgroupMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool available READ available CONSTANT)
+    Q_PROPERTY(QVariantList groups READ groups NOTIFY groupsChanged)
+    // "cpu", "memory", "io" or "name".
+    Q_PROPERTY(QString sortKey READ sortKey WRITE setSortKey NOTIFY sortKeyChanged)
+
+public:
+    explicit CgroupMonitor(QObject *parent = nullptr);
+
+    void registerCollector(MetricScheduler *scheduler);
+
+    bool available() const;
+    QVariantList groups() const;
+    QString sortKey() const;
+    void setSortKey(const QString &key);
+
+    Q_INVOKABLE void toggleExpanded(const QString &path);
+
+signals:
+    void groupsChanged();
+    void sortKeyChanged();
+
+private:
+    struct Node {
+        QString path;
+        QString name;
+        int depth = 0;
+        QVector<int> children;
+        quint64 usageUsec = 0;
+        quint64 readBytes = 0;
+        quint64 writeBytes = 0;
+        qint64 memoryBytes = 0;
+        double cpuPercent = 0.0;
+        double readRate = 0.0;
+        double writeRate = 0.0;
+        double cpuPressure = 0.0;
+        double memoryPressure = 0.0;
+        double ioPressure = 0.0;
+    };
+
+    struct Counters {
+        quint64 usageUsec = 0;
+        quint64 readBytes = 0;
+        quint64 writeBytes = 0;
+    };
+
+    void sample();
+    int walk(const QByteArray &directory, const QString &path, const QString &name, int depth);
+    void readNode(const QByteArray &directory, Node &node) const;
+    bool lessThan(const Node &left, const Node &right) const;
+    void appendRows(int index, QVariantList &rows) const;
+    void rebuildRows();
+
+    QString m_root;
+    bool m_available = false;
+    QString m_sortKey = QStringLiteral("cpu");
+    QVector<Node> m_nodes;
+    QVector<int> m_topLevel;
+    QHash<QString, Counters> m_previous;
+    RateClock m_clock;
+    QSet<QString> m_expanded;
+    QVariantList m_groups;
+    int m_cpuCount = 1;
+};
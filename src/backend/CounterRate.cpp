@@ -0,0 +1,109 @@
+#include "CounterRate.h"
+
+#include <ctime>
+
+namespace {
+
+// The two clocks are read back to back; anything beyond this is suspend.
+constexpr qint64 kSuspendToleranceNs = 10 * 1000 * 1000;
+// A 32-bit counter only counts as wrapped when the previous value was in
+// its top quarter; a drop from lower down is a reset (interface re-created,
+// driver reloaded).
+constexpr quint64 kWrapThreshold32 = Q_UINT64_C(0xC0000000);
+
+qint64 clockNs(clockid_t clock)
+{
+    timespec value {};
+    ::clock_gettime(clock, &value);
+    return static_cast<qint64>(value.tv_sec) * 1000000000 + value.tv_nsec;
+}
+
+} // namespace
+
+RateStamp RateStamp::now()
+{
+    RateStamp stamp;
+    stamp.monotonicNs = clockNs(CLOCK_MONOTONIC);
+    stamp.suspendedNs = clockNs(CLOCK_BOOTTIME) - stamp.monotonicNs;
+    return stamp;
+}
+
+double rateInterval(const RateStamp &from, const RateStamp &to)
+{
+    if (!from.isValid() || !to.isValid() || to.monotonicNs <= from.monotonicNs) {
+        return 0.0;
+    }
+
+    if (to.suspendedNs - from.suspendedNs > kSuspendToleranceNs) {
+        return 0.0;
+    }
+
+    return (to.monotonicNs - from.monotonicNs) / 1e9;
+}
+
+double RateClock::restart()
+{
+    const RateStamp now = RateStamp::now();
+    const double interval = rateInterval(m_last, now);
+    m_last = now;
+    return interval;
+}
+
+void RateClock::invalidate()
+{
+    m_last = RateStamp();
+}
+
+CounterRate::CounterRate(Width width)
+    : m_width(width)
+{
+}
+
+bool CounterRate::sample(quint64 value, const RateStamp &stamp)
+{
+    const double interval = rateInterval(m_stamp, stamp);
+    m_valid = interval > 0.0 && counterDelta(value, m_value, m_width, m_delta);
+    m_rate = m_valid ? m_delta / interval : 0.0;
+    if (!m_valid) {
+        m_delta = 0;
+    }
+
+    m_value = value;
+    m_stamp = stamp;
+    return m_valid;
+}
+
+void CounterRate::reset()
+{
+    m_value = 0;
+    m_stamp = RateStamp();
+    m_delta = 0;
+    m_rate = 0.0;
+    m_valid = false;
+}
+
+bool CounterRate::counterDelta(quint64 now, quint64 before, Width width, quint64 &delta)
+{
+    if (now >= before) {
+        delta = now - before;
+        return true;
+    }
+
+    if (width == Bits32 && before >= kWrapThreshold32 && before <= Q_UINT64_C(0xFFFFFFFF)) {
+        delta = (Q_UINT64_C(0x100000000) - before) + now;
+        return true;
+    }
+
+    delta = 0;
+    return false;
+}
+
+double CounterRate::rateOver(quint64 now, quint64 before, double intervalSec, Width width)
+{
+    quint64 delta = 0;
+    if (intervalSec <= 0.0 || !counterDelta(now, before, width, delta)) {
+        return 0.0;
+    }
+
+    return delta / intervalSec;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QtGlobal>
+
+// When a counter was read. CLOCK_BOOTTIME runs on during suspend while
+// CLOCK_MONOTONIC stops, so their difference grows by exactly the time spent
+// suspended; an interval over which it grew is not a valid rate interval.
+struct RateStamp {
+    qint64 monotonicNs = 0;
+    qint64 suspendedNs = 0;
+
+    static RateStamp now();
+    bool isValid() const { return monotonicNs > 0; }
+};
+
+// Seconds between two stamps, or 0 when either is missing, the clock did
+// not advance or the device was suspended in between.
+double rateInterval(const RateStamp &from, const RateStamp &to);
+
+// Interval between successive passes of a collector that computes many
+// deltas from one read (per process, per device, ...).
+class RateClock
+{
+public:
+    // Seconds since the previous restart(); 0 on the first call and after
+    // invalidate() or a suspend, which callers treat as "baseline only".
+    double restart();
+    void invalidate();
+
+    const RateStamp &last() const { return m_last; }
+
+private:
+    RateStamp m_last;
+};
+
+// Per-second rate of one cumulative counter. Every sample keeps its own
+// stamp, so late or irregular ticks give the true average over the actual
+// interval.
+class CounterRate
+{
+public:
+    enum Width {
+        Bits32,
+        Bits64
+    };
+
+    explicit CounterRate(Width width = Bits64);
+
+    // Feeds a reading; returns true when rate() and delta() describe the
+    // interval ending here. The first sample, a counter reset and an
+    // interval across suspend only set a new baseline.
+    bool sample(quint64 value, const RateStamp &stamp = RateStamp::now());
+    void reset();
+
+    bool isValid() const { return m_valid; }
+    double rate() const { return m_rate; }
+    quint64 delta() const { return m_delta; }
+
+    // Increase from `before` to `now`, allowing for one wrap of a 32-bit
+    // counter. Any other decrease is a reset and yields false.
+    static bool counterDelta(quint64 now, quint64 before, Width width, quint64 &delta);
+    // counterDelta() per second of `intervalSec`; 0 for resets and empty
+    // intervals.
+    static double rateOver(quint64 now, quint64 before, double intervalSec, Width width = Bits64);
+
+private:
+    Width m_width;
+    quint64 m_value = 0;
+    RateStamp m_stamp;
+    quint64 m_delta = 0;
+    double m_rate = 0.0;
+    bool m_valid = false;
+};
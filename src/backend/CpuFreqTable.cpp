@@ -0,0 +1,241 @@
+#include "CpuFreqTable.h"
+
+#include "SystemHelpers.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// One "<kHz> <time>" line per operating point; big clusters have ~30.
+constexpr int kStatsBufferSize = 4096;
+
+int openFile(const QString &path)
+{
+    const QByteArray encoded = QFile::encodeName(path);
+    return ::open(encoded.constData(), O_RDONLY | O_CLOEXEC);
+}
+
+qint64 readNumber(int fd)
+{
+    if (fd < 0) {
+        return 0;
+    }
+
+    char buffer[32];
+    const ssize_t length = ::pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0) {
+        return 0;
+    }
+
+    buffer[length] = '\0';
+    return std::strtoll(buffer, nullptr, 10);
+}
+
+void closeFd(int &fd)
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// Cooling devices name their policy either by CPU ("cpufreq-cpu4") or, on
+// older kernels, by registration order ("thermal-cpufreq-1").
+int policyForCoolingType(const QString &type, const QVector<CpuFreqTable::Policy> &policies)
+{
+    if (type.startsWith(QLatin1String("cpufreq-cpu"))) {
+        bool ok = false;
+        const int cpu = type.mid(11).toInt(&ok);
+        for (int index = 0; ok && index < policies.size(); ++index) {
+            if (policies.at(index).cpus.contains(cpu)) {
+                return index;
+            }
+        }
+        return -1;
+    }
+
+    if (type.startsWith(QLatin1String("thermal-cpufreq-"))) {
+        bool ok = false;
+        const int index = type.mid(16).toInt(&ok);
+        return ok && index >= 0 && index < policies.size() ? index : -1;
+    }
+
+    return -1;
+}
+
+} // namespace
+
+CpuFreqTable::~CpuFreqTable()
+{
+    closeAll();
+}
+
+void CpuFreqTable::refresh()
+{
+    if (!m_discovered) {
+        discover();
+    }
+
+    for (Policy &policy : m_policies) {
+        policy.currentKhz = readNumber(policy.currentFd);
+        policy.scalingMaxKhz = readNumber(policy.scalingMaxFd);
+        for (CoolingDevice &device : policy.cooling) {
+            device.state = static_cast<int>(readNumber(device.fd));
+        }
+        readStats(policy);
+    }
+
+    m_resetPending = false;
+}
+
+void CpuFreqTable::resetResidency()
+{
+    m_resetPending = true;
+}
+
+const QVector<CpuFreqTable::Policy> &CpuFreqTable::policies() const
+{
+    return m_policies;
+}
+
+void CpuFreqTable::discover()
+{
+    closeAll();
+    m_discovered = true;
+    m_resetPending = true;
+
+    const QDir cpufreqDir(Backend::sysPath(QStringLiteral("/devices/system/cpu/cpufreq")));
+    const QStringList policyEntries = cpufreqDir.entryList(QStringList() << QStringLiteral("policy*"),
+                                                           QDir::Dirs | QDir::NoDotAndDotDot,
+                                                           QDir::Name);
+    for (const QString &entryName : policyEntries) {
+        const QString policyPath = cpufreqDir.filePath(entryName);
+
+        Policy policy;
+        policy.name = entryName;
+        policy.cpus = Backend::parseCpuList(Backend::readTextFile(policyPath + QStringLiteral("/related_cpus")));
+        if (policy.cpus.isEmpty()) {
+            continue;
+        }
+
+        policy.hardwareMaxKhz = Backend::readTextFile(policyPath + QStringLiteral("/cpuinfo_max_freq")).toLongLong();
+        policy.currentFd = openFile(policyPath + QStringLiteral("/scaling_cur_freq"));
+        if (policy.currentFd < 0) {
+            policy.currentFd = openFile(policyPath + QStringLiteral("/cpuinfo_cur_freq"));
+        }
+        policy.scalingMaxFd = openFile(policyPath + QStringLiteral("/scaling_max_freq"));
+        // Needs CONFIG_CPU_FREQ_STAT; without it there is no histogram.
+        policy.statsFd = openFile(policyPath + QStringLiteral("/stats/time_in_state"));
+        m_policies.append(policy);
+    }
+
+    // policy10 sorts before policy4 by name.
+    std::sort(m_policies.begin(), m_policies.end(), [](const Policy &left, const Policy &right) {
+        return left.cpus.first() < right.cpus.first();
+    });
+
+    const QDir thermalDir(Backend::sysPath(QStringLiteral("/class/thermal")));
+    const QStringList coolingEntries = thermalDir.entryList(QStringList() << QStringLiteral("cooling_device*"),
+                                                            QDir::Dirs | QDir::NoDotAndDotDot,
+                                                            QDir::Name);
+    for (const QString &entryName : coolingEntries) {
+        const QString devicePath = thermalDir.filePath(entryName);
+        const QString type = Backend::readTextFile(devicePath + QStringLiteral("/type"));
+        const int index = policyForCoolingType(type, m_policies);
+        if (index < 0) {
+            continue;
+        }
+
+        CoolingDevice device;
+        device.type = type;
+        device.maxState = Backend::readTextFile(devicePath + QStringLiteral("/max_state")).toInt();
+        device.fd = openFile(devicePath + QStringLiteral("/cur_state"));
+        if (device.fd >= 0) {
+            m_policies[index].cooling.append(device);
+        }
+    }
+}
+
+void CpuFreqTable::readStats(Policy &policy)
+{
+    if (policy.statsFd < 0) {
+        return;
+    }
+
+    char buffer[kStatsBufferSize];
+    const ssize_t length = ::pread(policy.statsFd, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0) {
+        return;
+    }
+    buffer[length] = '\0';
+
+    int index = 0;
+    bool layoutChanged = false;
+    for (char *cursor = buffer; *cursor;) {
+        char *end = nullptr;
+        const qint64 khz = std::strtoll(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+
+        cursor = end;
+        const quint64 time = std::strtoull(cursor, &end, 10);
+        cursor = end;
+        while (*cursor == '\n' || *cursor == ' ') {
+            ++cursor;
+        }
+
+        if (index >= policy.points.size()) {
+            policy.points.append(OperatingPoint());
+            layoutChanged = true;
+        }
+
+        OperatingPoint &point = policy.points[index];
+        if (point.khz != khz) {
+            point = OperatingPoint();
+            point.khz = khz;
+            layoutChanged = true;
+        }
+
+        point.previousTime = point.time;
+        point.time = time;
+        ++index;
+    }
+
+    if (index != policy.points.size()) {
+        policy.points.resize(index);
+        layoutChanged = true;
+    }
+
+    // A changed OPP table invalidates both the deltas and the totals.
+    if (layoutChanged || m_resetPending) {
+        for (OperatingPoint &point : policy.points) {
+            point.previousTime = point.time;
+            point.baselineTime = point.time;
+        }
+        policy.hasPrevious = false;
+    } else {
+        policy.hasPrevious = true;
+    }
+}
+
+void CpuFreqTable::closeAll()
+{
+    for (Policy &policy : m_policies) {
+        closeFd(policy.currentFd);
+        closeFd(policy.scalingMaxFd);
+        closeFd(policy.statsFd);
+        for (CoolingDevice &device : policy.cooling) {
+            closeFd(device.fd);
+        }
+    }
+
+    m_policies.clear();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// cpufreq policies (one per cluster) from /sys/devices/system/cpu/cpufreq.
+// Policies, their CPUs, hardware limits and the CPU cooling devices are
+// discovered once and their files kept open; refresh() then preads the
+// current and scaling-max frequency, stats/time_in_state and the cooling
+// states of each policy.
+class CpuFreqTable
+{
+public:
+    struct OperatingPoint {
+        qint64 khz = 0;
+        // time_in_state is in 10 ms units; only ratios are used.
+        quint64 time = 0;
+        quint64 previousTime = 0;
+        quint64 baselineTime = 0;
+    };
+
+    struct CoolingDevice {
+        QString type;
+        int maxState = 0;
+        int state = 0;
+
+        int fd = -1;
+    };
+
+    struct Policy {
+        QString name;
+        QVector<int> cpus;
+        qint64 hardwareMaxKhz = 0;
+        qint64 currentKhz = 0;
+        qint64 scalingMaxKhz = 0;
+        QVector<OperatingPoint> points;
+        // Set once two time_in_state reads exist.
+        bool hasPrevious = false;
+        QVector<CoolingDevice> cooling;
+
+        int currentFd = -1;
+        int scalingMaxFd = -1;
+        int statsFd = -1;
+    };
+
+    CpuFreqTable() = default;
+    ~CpuFreqTable();
+
+    CpuFreqTable(const CpuFreqTable &) = delete;
+    CpuFreqTable &operator=(const CpuFreqTable &) = delete;
+
+    void refresh();
+    // Restarts the cumulative residency used for the histogram totals.
+    void resetResidency();
+
+    const QVector<Policy> &policies() const;
+
+private:
+    void discover();
+    void readStats(Policy &policy);
+    void closeAll();
+
+    QVector<Policy> m_policies;
+    bool m_discovered = false;
+    bool m_resetPending = true;
+};
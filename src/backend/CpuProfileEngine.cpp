@@ -0,0 +1,454 @@
+#include "CpuProfileEngine.h"
+
+#include "SystemHelpers.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QSettings>
+#include <QUuid>
+
+#include <algorithm>
+
+#include <unistd.h>
+
+namespace {
+
+const char kUserProfilesKey[] = "cpuProfiles/user";
+
+QByteArray readAttribute(const QString &path)
+{
+    return Backend::readTextFile(path).toUtf8();
+}
+
+QString pickGovernor(const QString &preferences, const QStringList &available)
+{
+    for (const QString &governor : preferences.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        if (available.contains(governor.trimmed())) {
+            return governor.trimmed();
+        }
+    }
+
+    return {};
+}
+
+QVariantMap targetToMap(const QString &governor, qint64 minKhz, qint64 maxKhz)
+{
+    QVariantMap map;
+    map[QStringLiteral("governor")] = governor;
+    map[QStringLiteral("minKhz")] = minKhz;
+    map[QStringLiteral("maxKhz")] = maxKhz;
+    return map;
+}
+
+} // namespace
+
+CpuProfileEngine::CpuProfileEngine(QObject *parent)
+    : QObject(parent)
+{
+    discover();
+
+    Profile powersave;
+    powersave.id = QStringLiteral("powersave");
+    powersave.name = QStringLiteral("Powersave");
+    powersave.builtin = true;
+    powersave.cpu.governor = QStringLiteral("schedutil,ondemand,interactive,powersave");
+    powersave.cpu.minPercent = 0;
+    powersave.cpu.maxPercent = 60;
+    powersave.devfreq.insert(QStringLiteral("*"), QStringLiteral("simple_ondemand,powersave"));
+
+    Profile balanced;
+    balanced.id = QStringLiteral("balanced");
+    balanced.name = QStringLiteral("Balanced");
+    balanced.builtin = true;
+    balanced.cpu.governor = QStringLiteral("schedutil,ondemand,interactive");
+    balanced.cpu.minPercent = 0;
+    balanced.cpu.maxPercent = 100;
+    balanced.devfreq.insert(QStringLiteral("*"), QStringLiteral("simple_ondemand"));
+
+    Profile performance;
+    performance.id = QStringLiteral("performance");
+    performance.name = QStringLiteral("Performance");
+    performance.builtin = true;
+    performance.cpu.governor = QStringLiteral("performance,schedutil");
+    performance.cpu.minPercent = 100;
+    performance.cpu.maxPercent = 100;
+    performance.devfreq.insert(QStringLiteral("*"), QStringLiteral("performance"));
+
+    m_profiles = { powersave, balanced, performance };
+    loadUserProfiles();
+
+    // The destructor may never run if the application object is torn down
+    // first, so restore as soon as the event loop is done.
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this,
+                &CpuProfileEngine::restoreDefaults);
+    }
+}
+
+CpuProfileEngine::~CpuProfileEngine()
+{
+    restoreDefaults();
+}
+
+bool CpuProfileEngine::available() const
+{
+    return m_available;
+}
+
+QVariantList CpuProfileEngine::profiles() const
+{
+    QVariantList profiles;
+    for (const Profile &profile : m_profiles) {
+        QVariantMap map;
+        map[QStringLiteral("id")] = profile.id;
+        map[QStringLiteral("name")] = profile.name;
+        map[QStringLiteral("builtin")] = profile.builtin;
+        profiles.append(map);
+    }
+
+    return profiles;
+}
+
+QString CpuProfileEngine::activeProfile() const
+{
+    return m_activeProfile;
+}
+
+QString CpuProfileEngine::lastError() const
+{
+    return m_lastError;
+}
+
+bool CpuProfileEngine::applyProfile(const QString &id)
+{
+    const Profile *profile = findProfile(id);
+    if (!profile) {
+        setLastError(QStringLiteral("Unknown profile %1").arg(id));
+        return false;
+    }
+
+    emit aboutToChangeLimits();
+
+    QVector<Write> writes;
+    if (!plan(*profile, writes) || !commit(writes)) {
+        return false;
+    }
+
+    for (const Write &write : std::as_const(writes)) {
+        const bool known = std::any_of(m_originals.cbegin(), m_originals.cend(), [&write](const Write &original) {
+            return original.path == write.path;
+        });
+        if (!known) {
+            m_originals.append({ write.path, write.previous, write.previous });
+        }
+    }
+
+    setLastError(QString());
+    setActiveProfile(id);
+    return true;
+}
+
+void CpuProfileEngine::restoreDefaults()
+{
+    if (m_originals.isEmpty()) {
+        setActiveProfile(QString());
+        return;
+    }
+
+    emit aboutToChangeLimits();
+
+    // Min and max limits may only be restorable in one order; a second pass
+    // picks up whatever the first could not write yet.
+    QVector<Write> pending;
+    for (auto it = m_originals.crbegin(); it != m_originals.crend(); ++it) {
+        if (!Backend::writeSysfsValue(it->path, it->value)) {
+            pending.append(*it);
+        }
+    }
+
+    QString error;
+    for (const Write &write : std::as_const(pending)) {
+        if (!Backend::writeSysfsValue(write.path, write.value, &error)) {
+            qWarning() << "CpuProfileEngine: cannot restore" << error;
+        }
+    }
+
+    m_originals.clear();
+    setActiveProfile(QString());
+}
+
+QString CpuProfileEngine::saveCurrentAsProfile(const QString &name)
+{
+    Profile profile;
+    profile.id = QStringLiteral("user-") + QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
+    profile.name = name.trimmed().isEmpty() ? QStringLiteral("Custom") : name.trimmed();
+
+    // The tap that got us here has boosted the floor.
+    emit aboutToChangeLimits();
+    for (const PolicyInfo &policy : std::as_const(m_policies)) {
+        Target target;
+        target.governor = QString::fromUtf8(readAttribute(policy.path + QStringLiteral("/scaling_governor")));
+        target.minKhz = readAttribute(policy.path + QStringLiteral("/scaling_min_freq")).toLongLong();
+        target.maxKhz = readAttribute(policy.path + QStringLiteral("/scaling_max_freq")).toLongLong();
+        profile.policies.insert(policy.name, target);
+    }
+
+    for (const DevfreqInfo &device : std::as_const(m_devfreq)) {
+        profile.devfreq.insert(device.name, QString::fromUtf8(readAttribute(device.path + QStringLiteral("/governor"))));
+    }
+
+    m_profiles.append(profile);
+    storeUserProfiles();
+    emit profilesChanged();
+    return profile.id;
+}
+
+void CpuProfileEngine::removeProfile(const QString &id)
+{
+    const auto it = std::find_if(m_profiles.begin(), m_profiles.end(), [&id](const Profile &profile) {
+        return profile.id == id && !profile.builtin;
+    });
+    if (it == m_profiles.end()) {
+        return;
+    }
+
+    m_profiles.erase(it);
+    storeUserProfiles();
+    emit profilesChanged();
+}
+
+void CpuProfileEngine::discover()
+{
+    const QDir cpufreqDir(Backend::sysPath(QStringLiteral("/devices/system/cpu/cpufreq")));
+    const QStringList policyEntries = cpufreqDir.entryList(QStringList() << QStringLiteral("policy*"),
+                                                           QDir::Dirs | QDir::NoDotAndDotDot,
+                                                           QDir::Name);
+    for (const QString &entryName : policyEntries) {
+        PolicyInfo policy;
+        policy.name = entryName;
+        policy.path = cpufreqDir.filePath(entryName);
+        policy.governors = Backend::readTextFile(policy.path + QStringLiteral("/scaling_available_governors"))
+                               .split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        policy.hardwareMinKhz = readAttribute(policy.path + QStringLiteral("/cpuinfo_min_freq")).toLongLong();
+        policy.hardwareMaxKhz = readAttribute(policy.path + QStringLiteral("/cpuinfo_max_freq")).toLongLong();
+
+        // Absent with intel_pstate and similar drivers; limits then go
+        // through unsnapped.
+        const QStringList frequencies = Backend::readTextFile(
+            policy.path + QStringLiteral("/scaling_available_frequencies")).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        for (const QString &frequency : frequencies) {
+            policy.frequencies.append(frequency.toLongLong());
+        }
+        std::sort(policy.frequencies.begin(), policy.frequencies.end());
+
+        if (::access(QFile::encodeName(policy.path + QStringLiteral("/scaling_governor")).constData(), W_OK) == 0) {
+            m_available = true;
+        }
+        m_policies.append(policy);
+    }
+
+    const QDir devfreqDir(Backend::sysPath(QStringLiteral("/class/devfreq")));
+    for (const QString &entryName : devfreqDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+        DevfreqInfo device;
+        device.name = entryName;
+        device.path = devfreqDir.filePath(entryName);
+        device.governors = Backend::readTextFile(device.path + QStringLiteral("/available_governors"))
+                               .split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        if (!device.governors.isEmpty()) {
+            m_devfreq.append(device);
+        }
+    }
+}
+
+void CpuProfileEngine::loadUserProfiles()
+{
+    QSettings settings;
+    const QVariantList stored = settings.value(QLatin1String(kUserProfilesKey)).toList();
+    for (const QVariant &value : stored) {
+        const QVariantMap map = value.toMap();
+        Profile profile;
+        profile.id = map.value(QStringLiteral("id")).toString();
+        profile.name = map.value(QStringLiteral("name")).toString();
+        if (profile.id.isEmpty() || findProfile(profile.id)) {
+            continue;
+        }
+
+        profile.cpu.governor = map.value(QStringLiteral("governor")).toString();
+        profile.cpu.minPercent = map.value(QStringLiteral("minPercent"), -1).toInt();
+        profile.cpu.maxPercent = map.value(QStringLiteral("maxPercent"), -1).toInt();
+
+        const QVariantMap policies = map.value(QStringLiteral("policies")).toMap();
+        for (auto it = policies.cbegin(); it != policies.cend(); ++it) {
+            const QVariantMap entry = it.value().toMap();
+            Target target;
+            target.governor = entry.value(QStringLiteral("governor")).toString();
+            target.minKhz = entry.value(QStringLiteral("minKhz")).toLongLong();
+            target.maxKhz = entry.value(QStringLiteral("maxKhz")).toLongLong();
+            profile.policies.insert(it.key(), target);
+        }
+
+        const QVariantMap devfreq = map.value(QStringLiteral("devfreq")).toMap();
+        for (auto it = devfreq.cbegin(); it != devfreq.cend(); ++it) {
+            profile.devfreq.insert(it.key(), it.value().toString());
+        }
+
+        m_profiles.append(profile);
+    }
+}
+
+void CpuProfileEngine::storeUserProfiles() const
+{
+    QVariantList stored;
+    for (const Profile &profile : m_profiles) {
+        if (profile.builtin) {
+            continue;
+        }
+
+        QVariantMap map;
+        map[QStringLiteral("id")] = profile.id;
+        map[QStringLiteral("name")] = profile.name;
+        map[QStringLiteral("governor")] = profile.cpu.governor;
+        map[QStringLiteral("minPercent")] = profile.cpu.minPercent;
+        map[QStringLiteral("maxPercent")] = profile.cpu.maxPercent;
+
+        QVariantMap policies;
+        for (auto it = profile.policies.cbegin(); it != profile.policies.cend(); ++it) {
+            policies.insert(it.key(), targetToMap(it->governor, it->minKhz, it->maxKhz));
+        }
+        map[QStringLiteral("policies")] = policies;
+
+        QVariantMap devfreq;
+        for (auto it = profile.devfreq.cbegin(); it != profile.devfreq.cend(); ++it) {
+            devfreq.insert(it.key(), it.value());
+        }
+        map[QStringLiteral("devfreq")] = devfreq;
+        stored.append(map);
+    }
+
+    QSettings settings;
+    settings.setValue(QLatin1String(kUserProfilesKey), stored);
+}
+
+const CpuProfileEngine::Profile *CpuProfileEngine::findProfile(const QString &id) const
+{
+    for (const Profile &profile : m_profiles) {
+        if (profile.id == id) {
+            return &profile;
+        }
+    }
+
+    return nullptr;
+}
+
+bool CpuProfileEngine::plan(const Profile &profile, QVector<Write> &writes)
+{
+    auto add = [&writes](const QString &path, const QByteArray &value) {
+        const QByteArray previous = readAttribute(path);
+        if (previous != value) {
+            writes.append({ path, value, previous });
+        }
+    };
+
+    for (const PolicyInfo &policy : std::as_const(m_policies)) {
+        const Target target = profile.policies.value(policy.name, profile.cpu);
+
+        if (!target.governor.isEmpty()) {
+            const QString governor = pickGovernor(target.governor, policy.governors);
+            if (governor.isEmpty()) {
+                setLastError(QStringLiteral("%1 offers none of %2").arg(policy.name, target.governor));
+                return false;
+            }
+            add(policy.path + QStringLiteral("/scaling_governor"), governor.toUtf8());
+        }
+
+        auto resolve = [&policy](qint64 khz, int percent) -> qint64 {
+            if (khz <= 0 && percent >= 0) {
+                khz = std::max(policy.hardwareMinKhz, policy.hardwareMaxKhz * percent / 100);
+            }
+            if (khz <= 0 || policy.frequencies.isEmpty()) {
+                return khz;
+            }
+
+            // Highest available frequency not above the request.
+            const auto it = std::upper_bound(policy.frequencies.cbegin(), policy.frequencies.cend(), khz);
+            return it == policy.frequencies.cbegin() ? policy.frequencies.first() : *(it - 1);
+        };
+
+        const qint64 maxKhz = resolve(target.maxKhz, target.maxPercent);
+        qint64 minKhz = resolve(target.minKhz, target.minPercent);
+        if (maxKhz > 0 && minKhz > maxKhz) {
+            minKhz = maxKhz;
+        }
+
+        // The kernel rejects min > max at every step, so raise max before
+        // min and lower min before max.
+        const QString minPath = policy.path + QStringLiteral("/scaling_min_freq");
+        const QString maxPath = policy.path + QStringLiteral("/scaling_max_freq");
+        const qint64 currentMax = readAttribute(maxPath).toLongLong();
+        if (minKhz > 0 && minKhz > currentMax) {
+            if (maxKhz > 0) {
+                add(maxPath, QByteArray::number(maxKhz));
+            }
+            add(minPath, QByteArray::number(minKhz));
+        } else {
+            if (minKhz > 0) {
+                add(minPath, QByteArray::number(minKhz));
+            }
+            if (maxKhz > 0) {
+                add(maxPath, QByteArray::number(maxKhz));
+            }
+        }
+    }
+
+    for (const DevfreqInfo &device : std::as_const(m_devfreq)) {
+        const QString preferences = profile.devfreq.value(device.name, profile.devfreq.value(QStringLiteral("*")));
+        const QString governor = pickGovernor(preferences, device.governors);
+        if (!governor.isEmpty()) {
+            add(device.path + QStringLiteral("/governor"), governor.toUtf8());
+        }
+    }
+
+    return true;
+}
+
+bool CpuProfileEngine::commit(const QVector<Write> &writes)
+{
+    for (int index = 0; index < writes.size(); ++index) {
+        QString error;
+        if (Backend::writeSysfsValue(writes.at(index).path, writes.at(index).value, &error)) {
+            continue;
+        }
+
+        for (int undo = index - 1; undo >= 0; --undo) {
+            if (!Backend::writeSysfsValue(writes.at(undo).path, writes.at(undo).previous)) {
+                qWarning() << "CpuProfileEngine: rollback failed for" << writes.at(undo).path;
+            }
+        }
+
+        setLastError(error);
+        return false;
+    }
+
+    return true;
+}
+
+void CpuProfileEngine::setLastError(const QString &error)
+{
+    if (error == m_lastError) {
+        return;
+    }
+
+    m_lastError = error;
+    emit lastErrorChanged();
+}
+
+void CpuProfileEngine::setActiveProfile(const QString &id)
+{
+    if (id == m_activeProfile) {
+        return;
+    }
+
+    m_activeProfile = id;
+    emit activeProfileChanged();
+}
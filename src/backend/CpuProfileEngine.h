@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+// Applies performance profiles: cpufreq governor and min/max frequency per
+// policy, optionally the devfreq governors. A profile is planned against
+// what the kernel offers (available governors and frequencies) and written
+// as one transaction: if any attribute is rejected, the ones already
+// written are put back. The values found before the first write are kept
+// and restored by restoreDefaults() and on exit.
+//
+// Built-in profiles are "powersave", "balanced" and "performance"; user
+// profiles live in QSettings under cpuProfiles/user.
+class CpuProfileEngine : public QObject
+{
+    Q_OBJECT
+    // False when no cpufreq policy can be written (usually not root).
+    Q_PROPERTY(bool available READ available CONSTANT)
+    Q_PROPERTY(QVariantList profiles READ profiles NOTIFY profilesChanged)
+    // Empty while the system settings are untouched.
+    Q_PROPERTY(QString activeProfile READ activeProfile NOTIFY activeProfileChanged)
+    Q_PROPERTY(QString lastError READ lastError NOTIFY lastErrorChanged)
+
+public:
+    explicit CpuProfileEngine(QObject *parent = nullptr);
+    ~CpuProfileEngine() override;
+
+    bool available() const;
+    QVariantList profiles() const;
+    QString activeProfile() const;
+    QString lastError() const;
+
+    Q_INVOKABLE bool applyProfile(const QString &id);
+    Q_INVOKABLE void restoreDefaults();
+    // Stores the current governors and limits as a user profile; returns its id.
+    Q_INVOKABLE QString saveCurrentAsProfile(const QString &name);
+    Q_INVOKABLE void removeProfile(const QString &id);
+
+signals:
+    void profilesChanged();
+    void activeProfileChanged();
+    void lastErrorChanged();
+    // Emitted before any limit is read or written, so temporary overrides
+    // (touch boost) can put their values back first.
+    void aboutToChangeLimits();
+
+private:
+    // Governor entries are comma separated preferences; the first one the
+    // kernel offers wins. Explicit kHz values take precedence over percents
+    // of the hardware maximum; -1 / 0 leave the limit alone.
+    struct Target {
+        QString governor;
+        int minPercent = -1;
+        int maxPercent = -1;
+        qint64 minKhz = 0;
+        qint64 maxKhz = 0;
+    };
+
+    struct Profile {
+        QString id;
+        QString name;
+        bool builtin = false;
+        Target cpu;
+        // Per-policy overrides, keyed by "policyN".
+        QHash<QString, Target> policies;
+        // Keyed by devfreq device name; "*" applies to every device.
+        QHash<QString, QString> devfreq;
+    };
+
+    struct PolicyInfo {
+        QString name;
+        QString path;
+        QStringList governors;
+        QVector<qint64> frequencies;
+        qint64 hardwareMinKhz = 0;
+        qint64 hardwareMaxKhz = 0;
+    };
+
+    struct DevfreqInfo {
+        QString name;
+        QString path;
+        QStringList governors;
+    };
+
+    struct Write {
+        QString path;
+        QByteArray value;
+        QByteArray previous;
+    };
+
+    void discover();
+    void loadUserProfiles();
+    void storeUserProfiles() const;
+    const Profile *findProfile(const QString &id) const;
+    bool plan(const Profile &profile, QVector<Write> &writes);
+    bool commit(const QVector<Write> &writes);
+    void setLastError(const QString &error);
+    void setActiveProfile(const QString &id);
+
+    QVector<PolicyInfo> m_policies;
+    QVector<DevfreqInfo> m_devfreq;
+    QVector<Profile> m_profiles;
+    // Attribute values from before the first write, in write order.
+    QVector<Write> m_originals;
+    QString m_activeProfile;
+    QString m_lastError;
+    bool m_available = false;
+};
@@ -0,0 +1,183 @@
+#include "CpuStatTable.h"
+
+#include "CounterRate.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Far above any real machine; guards the resize against a corrupt line.
+constexpr int kMaxCpus = 4096;
+
+} // namespace
+
+CpuStatTable::CpuStatTable(int historySamples)
+    : m_samples(qMax(1, historySamples))
+{
+}
+
+bool CpuStatTable::update(const QByteArray &content, bool hasInterval)
+{
+    if (content.isEmpty()) {
+        return false;
+    }
+
+    for (Cpu &cpu : m_cores) {
+        cpu.online = false;
+    }
+
+    const char *cursor = content.constData();
+    const char *const end = cursor + content.size();
+    // The cpu lines come first; parsing stops at "intr".
+    while (end - cursor > 3 && std::memcmp(cursor, "cpu", 3) == 0) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        char *parseEnd = const_cast<char *>(cursor + 3);
+        Cpu *cpu = &m_total;
+        if (*parseEnd != ' ') {
+            const unsigned long number = std::strtoul(parseEnd, &parseEnd, 10);
+            cpu = number < static_cast<unsigned long>(kMaxCpus) ? &cpuFor(static_cast<int>(number)) : nullptr;
+        }
+
+        if (cpu) {
+            // Kernels before 2.6.33 have fewer columns; the rest stay zero.
+            quint64 fields[StateCount] = {};
+            for (quint64 &field : fields) {
+                const char *start = parseEnd;
+                field = std::strtoull(start, &parseEnd, 10);
+                if (parseEnd == start || parseEnd > lineEnd) {
+                    field = 0;
+                    break;
+                }
+            }
+
+            quint64 previous[StateCount];
+            std::memcpy(previous, cpu->current, sizeof(previous));
+            std::memcpy(cpu->current, fields, sizeof(fields));
+
+            if (hasInterval && cpu->sampled) {
+                updateShares(*cpu, previous);
+            }
+            cpu->online = true;
+            cpu->sampled = true;
+        }
+
+        cursor = lineEnd + 1;
+    }
+
+    for (Cpu &cpu : m_cores) {
+        if (!cpu.online) {
+            cpu.sampled = false;
+            cpu.usage = 0.0;
+            std::memset(cpu.shares, 0, sizeof(cpu.shares));
+        }
+    }
+
+    if (!hasInterval) {
+        return false;
+    }
+
+    m_head = (m_head + 1) % m_samples;
+    m_filled = qMin(m_filled + 1, m_samples);
+    for (Cpu &cpu : m_cores) {
+        cpu.history[m_head] = static_cast<quint8>(qRound(cpu.usage * 100.0));
+    }
+    return true;
+}
+
+void CpuStatTable::clear()
+{
+    m_total = Cpu();
+    m_cores.clear();
+    m_head = -1;
+    m_filled = 0;
+}
+
+const CpuStatTable::Cpu &CpuStatTable::total() const
+{
+    return m_total;
+}
+
+const QVector<CpuStatTable::Cpu> &CpuStatTable::cores() const
+{
+    return m_cores;
+}
+
+int CpuStatTable::historySamples() const
+{
+    return m_samples;
+}
+
+int CpuStatTable::historySize() const
+{
+    return m_filled;
+}
+
+int CpuStatTable::historyAt(int core, int age) const
+{
+    if (core < 0 || core >= m_cores.size() || age < 0 || age >= m_filled) {
+        return 0;
+    }
+
+    return m_cores.at(core).history.at((m_head - age + m_samples) % m_samples);
+}
+
+double CpuStatTable::smoothedUsage(int core, int samples) const
+{
+    const int count = qMin(samples, m_filled);
+    if (count <= 0) {
+        return core >= 0 && core < m_cores.size() ? m_cores.at(core).usage : 0.0;
+    }
+
+    int sum = 0;
+    for (int age = 0; age < count; ++age) {
+        sum += historyAt(core, age);
+    }
+    return sum / (count * 100.0);
+}
+
+CpuStatTable::Cpu &CpuStatTable::cpuFor(int index)
+{
+    if (index >= m_cores.size()) {
+        const int first = m_cores.size();
+        m_cores.resize(index + 1);
+        for (int i = first; i <= index; ++i) {
+            m_cores[i].history.fill(0, m_samples);
+        }
+    }
+
+    return m_cores[index];
+}
+
+void CpuStatTable::updateShares(Cpu &cpu, const quint64 (&previous)[StateCount])
+{
+    // Per-CPU iowait (and idle on some older kernels) can step backwards
+    // under NO_HZ; such a column counts as zero instead of voiding the
+    // whole interval.
+    quint64 deltas[StateCount] = {};
+    quint64 total = 0;
+    for (int state = 0; state < StateCount; ++state) {
+        CounterRate::counterDelta(cpu.current[state], previous[state], CounterRate::Bits64, deltas[state]);
+        if (state != Guest && state != GuestNice) {
+            total += deltas[state];
+        }
+    }
+
+    // A tickless CPU that stayed idle for the whole interval may not have
+    // accounted anything yet.
+    if (total == 0) {
+        std::memset(cpu.shares, 0, sizeof(cpu.shares));
+        cpu.shares[Idle] = 1.0;
+        cpu.usage = 0.0;
+        return;
+    }
+
+    for (int state = 0; state < StateCount; ++state) {
+        cpu.shares[state] = qMin(1.0, static_cast<double>(deltas[state]) / total);
+    }
+    cpu.usage = qMax(0.0, 1.0 - cpu.shares[Idle] - cpu.shares[IoWait]);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+// Per-CPU time accounting from the "cpu" lines of /proc/stat. All ten
+// columns are parsed in place, so iowait, interrupts and steal are no
+// longer folded into idle. Every CPU also keeps a small ring of recent busy
+// percentages, used for smoothing and the per-core heatmap.
+class CpuStatTable
+{
+public:
+    // Column order of proc(5). guest and guestNice are already included in
+    // user and nice and are not part of the total.
+    enum State {
+        User,
+        Nice,
+        System,
+        Idle,
+        IoWait,
+        Irq,
+        SoftIrq,
+        Steal,
+        Guest,
+        GuestNice,
+        StateCount
+    };
+
+    struct Cpu {
+        quint64 current[StateCount] = {};
+        // Share of the last interval spent in each state, 0..1.
+        double shares[StateCount] = {};
+        // Everything but idle and iowait.
+        double usage = 0.0;
+        // Offline CPUs are missing from /proc/stat; they read as idle and
+        // restart from a new baseline when they come back.
+        bool online = false;
+        bool sampled = false;
+        QVector<quint8> history;
+    };
+
+    explicit CpuStatTable(int historySamples);
+
+    // Without an interval (first pass, across suspend) only the baselines
+    // move; shares and history keep their previous values. Returns true
+    // when a history sample was added.
+    bool update(const QByteArray &content, bool hasInterval);
+    void clear();
+
+    // The aggregate "cpu" line.
+    const Cpu &total() const;
+    // Indexed by CPU number; covers every CPU seen since the last clear().
+    const QVector<Cpu> &cores() const;
+
+    int historySamples() const;
+    int historySize() const;
+    // Busy percent of `core`, `age` samples back (0 is the latest).
+    int historyAt(int core, int age) const;
+    // Mean busy fraction of `core` over its last `samples` history entries.
+    double smoothedUsage(int core, int samples) const;
+
+private:
+    Cpu &cpuFor(int index);
+    void updateShares(Cpu &cpu, const quint64 (&previous)[StateCount]);
+
+    Cpu m_total;
+    QVector<Cpu> m_cores;
+    int m_samples;
+    int m_head = -1;
+    int m_filled = 0;
+};
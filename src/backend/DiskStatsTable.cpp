@@ -0,0 +1,151 @@
+#include "DiskStatsTable.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Counter columns after the device name: 11 up to 4.17, 15 with discards,
+// 17 with flushes.
+constexpr int kMaxFields = 17;
+// Typical phones and boards list well under this many block devices.
+constexpr int kInitialDevices = 16;
+
+bool isWholeDisk(const QString &name)
+{
+    static const QRegularExpression wholeDeviceRe(QStringLiteral("^(sd[a-z]+|nvme\\d+n\\d+|mmcblk\\d+|vd[a-z]+)$"));
+    return wholeDeviceRe.match(name).hasMatch();
+}
+
+bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+} // namespace
+
+void DiskStatsTable::update(const QByteArray &content)
+{
+    if (content.isEmpty()) {
+        return;
+    }
+
+    if (m_devices.capacity() < kInitialDevices) {
+        m_devices.reserve(kInitialDevices);
+    }
+
+    for (Device &device : m_devices) {
+        device.seen = false;
+    }
+
+    const char *cursor = content.constData();
+    const char *const end = cursor + content.size();
+    int index = 0;
+    while (cursor < end) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        // major and minor
+        char *parseEnd = nullptr;
+        std::strtoull(cursor, &parseEnd, 10);
+        std::strtoull(parseEnd, &parseEnd, 10);
+
+        const char *name = parseEnd;
+        while (name < lineEnd && isBlank(*name)) {
+            ++name;
+        }
+        const char *nameEnd = name;
+        while (nameEnd < lineEnd && !isBlank(*nameEnd)) {
+            ++nameEnd;
+        }
+
+        if (nameEnd > name) {
+            Device &device = deviceFor(name, static_cast<int>(nameEnd - name), index++);
+            device.seen = true;
+
+            quint64 fields[kMaxFields] = {};
+            int count = 0;
+            const char *field = nameEnd;
+            while (device.wholeDisk && count < kMaxFields && field < lineEnd) {
+                fields[count] = std::strtoull(field, &parseEnd, 10);
+                if (parseEnd == field || parseEnd > lineEnd) {
+                    break;
+                }
+                field = parseEnd;
+                ++count;
+            }
+
+            if (count >= 11) {
+                device.previous = device.current;
+                Counters &counters = device.current;
+                counters.reads = fields[0];
+                counters.readSectors = fields[2];
+                counters.readMs = fields[3];
+                counters.writes = fields[4];
+                counters.writeSectors = fields[6];
+                counters.writeMs = fields[7];
+                counters.inFlight = fields[8];
+                counters.ioTicksMs = fields[9];
+                counters.queueMs = fields[10];
+                counters.discards = fields[11];
+                counters.discardSectors = fields[13];
+                counters.discardMs = fields[14];
+
+                // The first snapshot, or a counter reset, only sets the baseline.
+                device.hasPrevious = device.sampled && counters.ioTicksMs >= device.previous.ioTicksMs;
+                device.sampled = true;
+            }
+        }
+
+        cursor = lineEnd + 1;
+    }
+
+    // Hot-unplugged devices drop out; the order of the rest is kept.
+    for (int i = m_devices.size() - 1; i >= 0; --i) {
+        if (!m_devices.at(i).seen) {
+            m_devices.remove(i);
+        }
+    }
+}
+
+void DiskStatsTable::clear()
+{
+    m_devices.clear();
+}
+
+const QVector<DiskStatsTable::Device> &DiskStatsTable::devices() const
+{
+    return m_devices;
+}
+
+DiskStatsTable::Device &DiskStatsTable::deviceFor(const char *name, int length, int hint)
+{
+    // Lines keep their order between snapshots, so the expected slot is
+    // almost always the hit.
+    const auto matches = [name, length](const Device &device) {
+        return device.key.size() == length && std::memcmp(device.key.constData(), name, length) == 0;
+    };
+
+    if (hint < m_devices.size() && matches(m_devices.at(hint))) {
+        return m_devices[hint];
+    }
+
+    for (Device &device : m_devices) {
+        if (matches(device)) {
+            return device;
+        }
+    }
+
+    Device device;
+    device.key = QByteArray(name, length);
+    device.name = QString::fromLatin1(device.key);
+    device.wholeDisk = isWholeDisk(device.name);
+    const int position = std::min(hint, static_cast<int>(m_devices.size()));
+    m_devices.insert(position, device);
+    return m_devices[position];
+}
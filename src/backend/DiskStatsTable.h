@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Per-device counters from /proc/diskstats. update() walks the snapshot in
+// place: device names are matched against the stored entries byte-wise and
+// the counters parsed straight into them, so a steady set of devices costs
+// no allocation. Entries keep the previous counters for rate computation.
+class DiskStatsTable
+{
+public:
+    // Field names follow Documentation/admin-guide/iostats.rst. Discard
+    // counters are zero before 4.18.
+    struct Counters {
+        quint64 reads = 0;
+        quint64 readSectors = 0;
+        quint64 readMs = 0;
+        quint64 writes = 0;
+        quint64 writeSectors = 0;
+        quint64 writeMs = 0;
+        quint64 inFlight = 0;
+        // Time with at least one request in flight.
+        quint64 ioTicksMs = 0;
+        // Time in flight summed over requests.
+        quint64 queueMs = 0;
+        quint64 discards = 0;
+        quint64 discardSectors = 0;
+        quint64 discardMs = 0;
+    };
+
+    struct Device {
+        QByteArray key;
+        QString name;
+        // False for partitions, loop and ram devices; their counters are
+        // not parsed.
+        bool wholeDisk = false;
+        Counters current;
+        Counters previous;
+        // Set once two snapshots exist.
+        bool hasPrevious = false;
+        bool sampled = false;
+        bool seen = false;
+    };
+
+    void update(const QByteArray &content);
+    void clear();
+
+    const QVector<Device> &devices() const;
+
+private:
+    Device &deviceFor(const char *name, int length, int hint);
+
+    QVector<Device> m_devices;
+};
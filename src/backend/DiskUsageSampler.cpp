@@ -0,0 +1,234 @@
+#include "DiskUsageSampler.h"
+
+#include "SystemHelpers.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+
+#include <sys/statvfs.h>
+
+namespace {
+
+constexpr int kDefaultPollIntervalMs = 10000;
+constexpr int kDefaultStatfsTimeoutMs = 2000;
+// Upper bound on threads left blocked in the kernel by hung mounts.
+constexpr int kMaxAbandonedThreads = 4;
+
+int environmentInterval(const char *name, int fallback, int minimum)
+{
+    bool ok = false;
+    const int configured = Backend::readEnvironmentValue(name).toInt(&ok);
+    return ok ? std::max(minimum, configured) : fallback;
+}
+
+} // namespace
+
+void DiskUsageWorker::sample(const QStringList &mountPoints)
+{
+    QVector<Usage> result;
+    result.reserve(mountPoints.size());
+    for (const QString &mountPoint : mountPoints) {
+        emit probing(mountPoint);
+
+        Usage usage;
+        usage.mountPoint = mountPoint;
+        struct statvfs info {};
+        if (::statvfs(mountPoint.toLocal8Bit().constData(), &info) == 0) {
+            usage.totalBytes = static_cast<quint64>(info.f_blocks) * info.f_frsize;
+            usage.availableBytes = static_cast<quint64>(info.f_bavail) * info.f_frsize;
+            usage.ok = true;
+        }
+
+        result.append(usage);
+    }
+
+    emit sampled(result);
+}
+
+DiskUsageSampler::DiskUsageSampler(QObject *parent)
+    : QObject(parent)
+    , m_watchdog(new QTimer(this))
+    , m_pollIntervalMs(environmentInterval("ORBITAL_DISK_POLL_MS", kDefaultPollIntervalMs, 1000))
+    , m_timeoutMs(environmentInterval("ORBITAL_DISK_STATFS_TIMEOUT_MS", kDefaultStatfsTimeoutMs, 100))
+{
+    qRegisterMetaType<QVector<DiskUsageWorker::Usage>>();
+
+    m_watchdog->setSingleShot(true);
+    m_watchdog->setInterval(m_timeoutMs);
+    connect(m_watchdog, &QTimer::timeout, this, &DiskUsageSampler::onWatchdogTimeout);
+
+    startWorker();
+}
+
+DiskUsageSampler::~DiskUsageSampler()
+{
+    stopWorker();
+}
+
+void DiskUsageSampler::setMountPoints(const QStringList &mountPoints)
+{
+    if (mountPoints == m_mountPoints) {
+        return;
+    }
+
+    m_mountPoints = mountPoints;
+    for (auto it = m_usage.begin(); it != m_usage.end();) {
+        if (mountPoints.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_usage.erase(it);
+        }
+    }
+
+    // Let the next sampleIfDue() pick up new mounts immediately.
+    m_sinceLastPass.invalidate();
+    emit usageUpdated();
+}
+
+void DiskUsageSampler::sampleIfDue()
+{
+    if (!m_worker || m_passInFlight) {
+        return;
+    }
+
+    if (m_sinceLastPass.isValid() && m_sinceLastPass.elapsed() < m_pollIntervalMs) {
+        return;
+    }
+
+    QStringList pending;
+    for (const QString &mountPoint : std::as_const(m_mountPoints)) {
+        if (!m_stuck.contains(mountPoint)) {
+            pending.append(mountPoint);
+        }
+    }
+
+    m_sinceLastPass.start();
+    if (pending.isEmpty()) {
+        return;
+    }
+
+    m_passInFlight = true;
+    m_probing.clear();
+    m_watchdog->start();
+    QMetaObject::invokeMethod(m_worker, "sample", Qt::QueuedConnection, Q_ARG(QStringList, pending));
+}
+
+bool DiskUsageSampler::hasUsage(const QString &mountPoint) const
+{
+    return m_usage.contains(mountPoint);
+}
+
+DiskUsageSampler::Usage DiskUsageSampler::usage(const QString &mountPoint) const
+{
+    return m_usage.value(mountPoint);
+}
+
+void DiskUsageSampler::startWorker()
+{
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("DiskUsageSampler"));
+    m_worker = new DiskUsageWorker;
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &DiskUsageWorker::probing, this, &DiskUsageSampler::onProbing);
+    connect(m_worker, &DiskUsageWorker::sampled, this, &DiskUsageSampler::onSampled);
+    m_thread->start(QThread::LowPriority);
+}
+
+void DiskUsageSampler::abandonWorker(const QString &stuckMountPoint)
+{
+    QThread *thread = m_thread;
+    disconnect(m_worker, nullptr, this, nullptr);
+    m_worker = nullptr;
+    m_thread = nullptr;
+
+    // The thread is blocked inside statvfs() and cannot be interrupted. Detach
+    // it so this object never waits on it, and clean up once the call returns.
+    thread->setParent(nullptr);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    connect(thread, &QThread::finished, this, [this, stuckMountPoint]() {
+        --m_abandonedThreads;
+        m_stuck.remove(stuckMountPoint);
+        m_sinceLastPass.invalidate();
+        if (!m_worker) {
+            startWorker();
+        }
+    });
+    thread->quit();
+    ++m_abandonedThreads;
+}
+
+void DiskUsageSampler::stopWorker()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    m_thread->quit();
+    if (!m_thread->wait(m_timeoutMs)) {
+        abandonWorker(m_probing);
+        return;
+    }
+
+    delete m_thread;
+    m_thread = nullptr;
+    m_worker = nullptr;
+}
+
+void DiskUsageSampler::onProbing(const QString &mountPoint)
+{
+    m_probing = mountPoint;
+    m_watchdog->start();
+}
+
+void DiskUsageSampler::onSampled(const QVector<DiskUsageWorker::Usage> &usage)
+{
+    m_watchdog->stop();
+    m_passInFlight = false;
+    m_probing.clear();
+
+    for (const DiskUsageWorker::Usage &item : usage) {
+        if (!m_mountPoints.contains(item.mountPoint)) {
+            continue;
+        }
+
+        if (!item.ok) {
+            m_usage.remove(item.mountPoint);
+            continue;
+        }
+
+        Usage &entry = m_usage[item.mountPoint];
+        entry.totalBytes = item.totalBytes;
+        entry.availableBytes = item.availableBytes;
+        entry.stale = false;
+    }
+
+    emit usageUpdated();
+}
+
+void DiskUsageSampler::onWatchdogTimeout()
+{
+    if (!m_passInFlight) {
+        return;
+    }
+
+    qWarning().noquote() << "DiskUsageSampler: statvfs did not return within" << m_timeoutMs
+                         << "ms for" << (m_probing.isEmpty() ? QStringLiteral("<queued>") : m_probing);
+
+    m_passInFlight = false;
+    if (!m_probing.isEmpty()) {
+        m_stuck.insert(m_probing);
+        m_usage[m_probing].stale = true;
+    }
+
+    abandonWorker(m_probing);
+    m_probing.clear();
+    if (m_abandonedThreads < kMaxAbandonedThreads) {
+        startWorker();
+    }
+
+    emit usageUpdated();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class QThread;
+class QTimer;
+
+// Runs statvfs() for a list of mount points. Lives on DiskUsageSampler's
+// worker thread; a probe that hangs blocks only that thread.
+class DiskUsageWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Usage {
+        QString mountPoint;
+        quint64 totalBytes = 0;
+        quint64 availableBytes = 0;
+        bool ok = false;
+    };
+
+public slots:
+    void sample(const QStringList &mountPoints);
+
+signals:
+    void probing(const QString &mountPoint);
+    void sampled(const QVector<DiskUsageWorker::Usage> &usage);
+};
+
+// Off-thread per-mount usage polling. A pass runs at most every
+// ORBITAL_DISK_POLL_MS (default 10 s) and only when asked via sampleIfDue(),
+// so nothing is probed while no one shows disk usage. If a single statvfs()
+// does not return within ORBITAL_DISK_STATFS_TIMEOUT_MS (default 2 s), the
+// mount is reported stale and left out of later passes, and the blocked
+// thread is abandoned in favour of a fresh one. The mount is probed again
+// once the hung call finally returns.
+class DiskUsageSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Usage {
+        quint64 totalBytes = 0;
+        quint64 availableBytes = 0;
+        bool stale = false;
+    };
+
+    explicit DiskUsageSampler(QObject *parent = nullptr);
+    ~DiskUsageSampler() override;
+
+    void setMountPoints(const QStringList &mountPoints);
+    void sampleIfDue();
+
+    bool hasUsage(const QString &mountPoint) const;
+    Usage usage(const QString &mountPoint) const;
+
+signals:
+    void usageUpdated();
+
+private:
+    void startWorker();
+    void abandonWorker(const QString &stuckMountPoint);
+    void stopWorker();
+    void onProbing(const QString &mountPoint);
+    void onSampled(const QVector<DiskUsageWorker::Usage> &usage);
+    void onWatchdogTimeout();
+
+    QThread *m_thread = nullptr;
+    DiskUsageWorker *m_worker = nullptr;
+    QTimer *m_watchdog = nullptr;
+    QStringList m_mountPoints;
+    QHash<QString, Usage> m_usage;
+    QSet<QString> m_stuck;
+    QString m_probing;
+    QElapsedTimer m_sinceLastPass;
+    int m_pollIntervalMs = 0;
+    int m_timeoutMs = 0;
+    int m_abandonedThreads = 0;
+    bool m_passInFlight = false;
+};
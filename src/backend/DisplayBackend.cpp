@@ -189,6 +189,7 @@ void DisplayBackend::onPowerInputEvent(int fd)
         }
 
         if (ev.value == 1) {
+            emit inputActivity();
             qDebug() << "Key Down: Timer Started";
             m_longPressTimer->start();
         } else if (ev.value == 0) {
@@ -254,6 +255,10 @@ void DisplayBackend::onVolumeInputEvent(int fd)
             continue;
         }
 
+        if (ev.value == 1) {
+            emit inputActivity();
+        }
+
         if (ev.code == KEY_VOLUMEUP) {
             m_volumeUpPressed = (ev.value == 1);
         } else if (ev.code == KEY_VOLUMEDOWN) {
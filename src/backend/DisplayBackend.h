@@ -33,6 +33,8 @@ signals:
     void screenOffMethodChanged();
     void volumeKeyEvent(QString key, int value);
     void screenshotRequested();
+    // Any hardware key press; used to boost the CPU ahead of the redraw.
+    void inputActivity();
 
 private slots:
     void onPowerInputEvent(int fd);
@@ -0,0 +1,162 @@
+#include "HistorySeries.h"
+
+#include <algorithm>
+
+HistorySeries::HistorySeries(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_values(static_cast<size_t>(std::max(1, capacity)), 0.0f)
+    , m_timestamps(static_cast<size_t>(std::max(1, capacity)), 0)
+{
+}
+
+int HistorySeries::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return m_count;
+}
+
+QVariant HistorySeries::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_count) {
+        return {};
+    }
+
+    const int slot = slotFor(index.row());
+    if (role == ValueRole || role == Qt::DisplayRole) {
+        return static_cast<double>(m_values[slot]);
+    }
+
+    if (role == TimestampRole) {
+        return m_timestamps[slot];
+    }
+
+    return {};
+}
+
+QHash<int, QByteArray> HistorySeries::roleNames() const
+{
+    return {
+        { ValueRole, "value" },
+        { TimestampRole, "timestamp" }
+    };
+}
+
+int HistorySeries::capacity() const
+{
+    return static_cast<int>(m_values.size());
+}
+
+void HistorySeries::setCapacity(int capacity)
+{
+    capacity = std::max(1, capacity);
+    if (capacity == this->capacity()) {
+        return;
+    }
+
+    const int kept = std::min(m_count, capacity);
+    std::vector<float> values(static_cast<size_t>(capacity), 0.0f);
+    std::vector<qint64> timestamps(static_cast<size_t>(capacity), 0);
+    for (int index = 0; index < kept; ++index) {
+        const int slot = slotFor(m_count - kept + index);
+        values[index] = m_values[slot];
+        timestamps[index] = m_timestamps[slot];
+    }
+
+    const bool countDiffers = kept != m_count;
+    beginResetModel();
+    m_values.swap(values);
+    m_timestamps.swap(timestamps);
+    m_head = 0;
+    m_count = kept;
+    endResetModel();
+
+    emit capacityChanged();
+    if (countDiffers) {
+        emit countChanged();
+    }
+}
+
+int HistorySeries::count() const
+{
+    return m_count;
+}
+
+double HistorySeries::latest() const
+{
+    return m_count > 0 ? static_cast<double>(m_values[slotFor(m_count - 1)]) : 0.0;
+}
+
+void HistorySeries::append(float value, qint64 timestampMs)
+{
+    const int cap = capacity();
+    const bool wasFull = m_count == cap;
+    if (wasFull) {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_head = (m_head + 1) % cap;
+        --m_count;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_count, m_count);
+    const int slot = slotFor(m_count);
+    m_values[slot] = value;
+    m_timestamps[slot] = timestampMs;
+    ++m_count;
+    endInsertRows();
+
+    if (!wasFull) {
+        emit countChanged();
+    }
+
+    emit sampleAppended();
+}
+
+void HistorySeries::clear()
+{
+    if (m_count == 0) {
+        return;
+    }
+
+    beginResetModel();
+    m_head = 0;
+    m_count = 0;
+    endResetModel();
+    emit countChanged();
+}
+
+double HistorySeries::valueAt(int index) const
+{
+    if (index < 0 || index >= m_count) {
+        return 0.0;
+    }
+
+    return static_cast<double>(m_values[slotFor(index)]);
+}
+
+qint64 HistorySeries::timestampAt(int index) const
+{
+    if (index < 0 || index >= m_count) {
+        return 0;
+    }
+
+    return m_timestamps[slotFor(index)];
+}
+
+double HistorySeries::maxValue(int lastN) const
+{
+    const int window = (lastN <= 0 || lastN > m_count) ? m_count : lastN;
+    float result = 0.0f;
+    for (int index = m_count - window; index < m_count; ++index) {
+        result = std::max(result, m_values[slotFor(index)]);
+    }
+
+    return static_cast<double>(result);
+}
+
+int HistorySeries::slotFor(int index) const
+{
+    return (m_head + index) % capacity();
+}
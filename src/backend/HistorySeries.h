@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QAbstractListModel>
+
+#include <vector>
+
+// Fixed-capacity ring of float samples with millisecond timestamps. Appending
+// is O(1) regardless of capacity; when the ring is full the oldest row is
+// removed before the new one is inserted, so views receive exactly one
+// remove/insert pair per sample instead of a full list copy.
+class HistorySeries : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(double latest READ latest NOTIFY sampleAppended)
+
+public:
+    enum Role {
+        ValueRole = Qt::UserRole + 1,
+        TimestampRole
+    };
+
+    explicit HistorySeries(int capacity = 60, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int capacity() const;
+    void setCapacity(int capacity);
+    int count() const;
+    double latest() const;
+
+    void append(float value, qint64 timestampMs);
+    void clear();
+
+    // Index 0 is the oldest retained sample.
+    Q_INVOKABLE double valueAt(int index) const;
+    Q_INVOKABLE qint64 timestampAt(int index) const;
+    // Largest value among the newest `lastN` samples (all samples if <= 0).
+    Q_INVOKABLE double maxValue(int lastN = 0) const;
+
+signals:
+    void capacityChanged();
+    void countChanged();
+    void sampleAppended();
+
+private:
+    int slotFor(int index) const;
+
+    std::vector<float> m_values;
+    std::vector<qint64> m_timestamps;
+    int m_head = 0;
+    int m_count = 0;
+};
@@ -0,0 +1,256 @@
+#include "MetricScheduler.h"
+
+#include <QDebug>
+#include <QTimer>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Intervals are rounded to this granularity so the gcd tick never degrades
+// into a busy timer when two subscribers ask for nearly equal rates.
+constexpr int kIntervalGranularityMs = 100;
+
+int normalizedInterval(int intervalMs)
+{
+    const int rounded = (intervalMs + kIntervalGranularityMs / 2) / kIntervalGranularityMs;
+    return std::max(1, rounded) * kIntervalGranularityMs;
+}
+
+} // namespace
+
+MetricScheduler::MetricScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_timer->setTimerType(Qt::CoarseTimer);
+    connect(m_timer, &QTimer::timeout, this, &MetricScheduler::tick);
+    m_clock.start();
+}
+
+void MetricScheduler::registerCollector(const QString &name, Sampler sampler)
+{
+    if (indexOf(name) >= 0) {
+        qWarning().noquote() << "MetricScheduler: collector registered twice:" << name;
+        return;
+    }
+
+    Collector collector;
+    collector.name = name;
+    collector.sampler = std::move(sampler);
+    m_collectors.append(collector);
+}
+
+int MetricScheduler::subscribe(const QStringList &collectors, int intervalMs, QObject *owner)
+{
+    Subscription subscription;
+    for (const QString &name : collectors) {
+        const int index = indexOf(name);
+        if (index < 0) {
+            qWarning().noquote() << "MetricScheduler: unknown collector" << name;
+            continue;
+        }
+
+        if (!subscription.collectors.contains(index)) {
+            subscription.collectors.append(index);
+        }
+    }
+
+    if (subscription.collectors.isEmpty()) {
+        return 0;
+    }
+
+    const int token = m_nextToken++;
+    subscription.intervalMs = normalizedInterval(intervalMs);
+    if (owner) {
+        subscription.ownerConnection = connect(owner, &QObject::destroyed, this, [this, token]() {
+            unsubscribe(token);
+        });
+    }
+
+    m_subscriptions.insert(token, subscription);
+    reschedule();
+    return token;
+}
+
+void MetricScheduler::setInterval(int token, int intervalMs)
+{
+    auto it = m_subscriptions.find(token);
+    if (it == m_subscriptions.end()) {
+        return;
+    }
+
+    const int normalized = normalizedInterval(intervalMs);
+    if (it->intervalMs == normalized) {
+        return;
+    }
+
+    it->intervalMs = normalized;
+    reschedule();
+}
+
+void MetricScheduler::unsubscribe(int token)
+{
+    auto it = m_subscriptions.find(token);
+    if (it == m_subscriptions.end()) {
+        return;
+    }
+
+    disconnect(it->ownerConnection);
+    m_subscriptions.erase(it);
+    reschedule();
+}
+
+QStringList MetricScheduler::collectors() const
+{
+    QStringList names;
+    names.reserve(m_collectors.size());
+    for (const Collector &collector : m_collectors) {
+        names.append(collector.name);
+    }
+
+    return names;
+}
+
+QStringList MetricScheduler::activeCollectors() const
+{
+    QStringList names;
+    for (const Collector &collector : m_collectors) {
+        if (collector.intervalMs > 0) {
+            names.append(collector.name);
+        }
+    }
+
+    return names;
+}
+
+int MetricScheduler::intervalFor(const QString &collector) const
+{
+    const int index = indexOf(collector);
+    return index >= 0 ? m_collectors.at(index).intervalMs : 0;
+}
+
+int MetricScheduler::tickInterval() const
+{
+    return m_tickInterval;
+}
+
+int MetricScheduler::indexOf(const QString &name) const
+{
+    for (int index = 0; index < m_collectors.size(); ++index) {
+        if (m_collectors.at(index).name == name) {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+void MetricScheduler::reschedule()
+{
+    QVector<int> intervals(m_collectors.size(), 0);
+    for (const Subscription &subscription : std::as_const(m_subscriptions)) {
+        for (int index : subscription.collectors) {
+            int &interval = intervals[index];
+            interval = interval == 0 ? subscription.intervalMs : std::min(interval, subscription.intervalMs);
+        }
+    }
+
+    const qint64 now = m_clock.elapsed();
+    bool changed = false;
+    bool newlyActive = false;
+    int tickInterval = 0;
+    for (int index = 0; index < m_collectors.size(); ++index) {
+        Collector &collector = m_collectors[index];
+        const int interval = intervals.at(index);
+        if (interval != collector.intervalMs) {
+            changed = true;
+            if (collector.intervalMs == 0) {
+                // Sample a collector as soon as it gains its first subscriber
+                // instead of leaving the page blank for a full interval.
+                collector.nextDueMs = now;
+                newlyActive = true;
+            } else if (interval > 0) {
+                collector.nextDueMs = std::min(collector.nextDueMs, now + interval);
+            }
+
+            collector.intervalMs = interval;
+        }
+
+        if (interval > 0) {
+            tickInterval = tickInterval == 0 ? interval : std::gcd(tickInterval, interval);
+        }
+    }
+
+    if (tickInterval != m_tickInterval) {
+        changed = true;
+        m_tickInterval = tickInterval;
+        if (m_tickInterval > 0) {
+            m_timer->start(m_tickInterval);
+        } else {
+            m_timer->stop();
+        }
+    }
+
+    if (newlyActive) {
+        queueTick();
+    }
+
+    if (changed) {
+        emit scheduleChanged();
+    }
+}
+
+void MetricScheduler::queueTick()
+{
+    if (m_tickQueued) {
+        return;
+    }
+
+    m_tickQueued = true;
+    QTimer::singleShot(0, this, &MetricScheduler::tick);
+}
+
+void MetricScheduler::tick()
+{
+    m_tickQueued = false;
+
+    // Accept timer jitter of up to a quarter tick so a collector that fires a
+    // few ms early is not pushed back by a whole interval.
+    const qint64 now = m_clock.elapsed();
+    const qint64 slack = m_tickInterval / 4;
+    QVector<int> due;
+
+    for (int index = 0; index < m_collectors.size(); ++index) {
+        Collector &collector = m_collectors[index];
+        if (collector.intervalMs <= 0 || collector.nextDueMs - now > slack) {
+            continue;
+        }
+
+        collector.nextDueMs += collector.intervalMs;
+        if (collector.nextDueMs <= now) {
+            collector.nextDueMs = now + collector.intervalMs;
+        }
+
+        due.append(index);
+    }
+
+    if (due.isEmpty()) {
+        return;
+    }
+
+    emit tickStarted();
+
+    // Collectors are only ever appended, so the indices stay valid even if a
+    // sampler's signals re-enter subscribe().
+    QStringList sampled;
+    sampled.reserve(due.size());
+    for (int index : due) {
+        sampled.append(m_collectors.at(index).name);
+        const Sampler sampler = m_collectors.at(index).sampler;
+        sampler();
+    }
+
+    emit tickFinished(sampled);
+}
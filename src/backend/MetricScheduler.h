@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class QTimer;
+
+// Subscription registry driving every periodic collector from one timer.
+// Collectors register a sampling callback under a name; consumers subscribe
+// to a set of names with the rate they need. A collector runs at the fastest
+// rate any of its subscribers requested and does not run at all while it has
+// no subscribers. The timer ticks at the gcd of the active intervals and
+// stops when nothing is subscribed.
+class MetricScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QStringList collectors READ collectors CONSTANT)
+    Q_PROPERTY(QStringList activeCollectors READ activeCollectors NOTIFY scheduleChanged)
+    Q_PROPERTY(int tickInterval READ tickInterval NOTIFY scheduleChanged)
+
+public:
+    using Sampler = std::function<void()>;
+
+    explicit MetricScheduler(QObject *parent = nullptr);
+
+    // Collectors run in registration order within a tick.
+    void registerCollector(const QString &name, Sampler sampler);
+
+    // Returns a token for setInterval/unsubscribe, or 0 if none of the names
+    // is a known collector. When an owner is given the subscription is
+    // dropped automatically once the owner is destroyed.
+    int subscribe(const QStringList &collectors, int intervalMs, QObject *owner = nullptr);
+    void setInterval(int token, int intervalMs);
+    void unsubscribe(int token);
+
+    QStringList collectors() const;
+    QStringList activeCollectors() const;
+    // Effective interval of a collector in ms, 0 while it is idle.
+    Q_INVOKABLE int intervalFor(const QString &collector) const;
+    int tickInterval() const;
+
+signals:
+    void scheduleChanged();
+    // Emitted before the first collector of a tick runs.
+    void tickStarted();
+    // Emitted after each tick with the collectors that were sampled in it.
+    void tickFinished(const QStringList &sampled);
+
+private:
+    struct Collector {
+        QString name;
+        Sampler sampler;
+        int intervalMs = 0;
+        qint64 nextDueMs = 0;
+    };
+
+    struct Subscription {
+        QVector<int> collectors;
+        int intervalMs = 0;
+        QMetaObject::Connection ownerConnection;
+    };
+
+    int indexOf(const QString &name) const;
+    void reschedule();
+    void queueTick();
+    void tick();
+
+    QVector<Collector> m_collectors;
+    QHash<int, Subscription> m_subscriptions;
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_clock;
+    int m_nextToken = 1;
+    int m_tickInterval = 0;
+    bool m_tickQueued = false;
+};
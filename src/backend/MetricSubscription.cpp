@@ -0,0 +1,110 @@
+#include "MetricSubscription.h"
+
+#include "MetricScheduler.h"
+
+MetricSubscription::MetricSubscription(QObject *parent)
+    : QObject(parent)
+{
+}
+
+MetricSubscription::~MetricSubscription()
+{
+    release();
+}
+
+void MetricSubscription::classBegin()
+{
+}
+
+void MetricSubscription::componentComplete()
+{
+    m_complete = true;
+    resubscribe();
+}
+
+QObject *MetricSubscription::scheduler() const
+{
+    return m_scheduler;
+}
+
+void MetricSubscription::setScheduler(QObject *scheduler)
+{
+    auto *typed = qobject_cast<MetricScheduler *>(scheduler);
+    if (typed == m_scheduler) {
+        return;
+    }
+
+    release();
+    m_scheduler = typed;
+    emit schedulerChanged();
+    resubscribe();
+}
+
+QStringList MetricSubscription::metrics() const
+{
+    return m_metrics;
+}
+
+void MetricSubscription::setMetrics(const QStringList &metrics)
+{
+    if (metrics == m_metrics) {
+        return;
+    }
+
+    m_metrics = metrics;
+    emit metricsChanged();
+    resubscribe();
+}
+
+int MetricSubscription::interval() const
+{
+    return m_interval;
+}
+
+void MetricSubscription::setInterval(int intervalMs)
+{
+    if (intervalMs == m_interval) {
+        return;
+    }
+
+    m_interval = intervalMs;
+    emit intervalChanged();
+    if (m_token != 0 && m_scheduler) {
+        m_scheduler->setInterval(m_token, m_interval);
+    }
+}
+
+bool MetricSubscription::active() const
+{
+    return m_active;
+}
+
+void MetricSubscription::setActive(bool active)
+{
+    if (active == m_active) {
+        return;
+    }
+
+    m_active = active;
+    emit activeChanged();
+    resubscribe();
+}
+
+void MetricSubscription::resubscribe()
+{
+    release();
+    if (!m_complete || !m_active || !m_scheduler || m_metrics.isEmpty()) {
+        return;
+    }
+
+    m_token = m_scheduler->subscribe(m_metrics, m_interval);
+}
+
+void MetricSubscription::release()
+{
+    if (m_token != 0 && m_scheduler) {
+        m_scheduler->unsubscribe(m_token);
+    }
+
+    m_token = 0;
+}
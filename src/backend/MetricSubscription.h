@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QQmlParserStatus>
+#include <QStringList>
+
+class MetricScheduler;
+
+// Declarative MetricScheduler subscription for QML. A page declares the
+// collectors it shows and binds `active` to its own visibility; the
+// subscription is dropped when it becomes inactive or is destroyed.
+//
+//     MetricSubscription {
+//         scheduler: backend.metricScheduler
+//         metrics: ["cpu", "memory"]
+//         interval: 1000
+//         active: page.StackView.status === StackView.Active
+//     }
+class MetricSubscription : public QObject, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+    Q_PROPERTY(QObject* scheduler READ scheduler WRITE setScheduler NOTIFY schedulerChanged)
+    Q_PROPERTY(QStringList metrics READ metrics WRITE setMetrics NOTIFY metricsChanged)
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(bool active READ active WRITE setActive NOTIFY activeChanged)
+
+public:
+    explicit MetricSubscription(QObject *parent = nullptr);
+    ~MetricSubscription() override;
+
+    void classBegin() override;
+    void componentComplete() override;
+
+    QObject *scheduler() const;
+    void setScheduler(QObject *scheduler);
+    QStringList metrics() const;
+    void setMetrics(const QStringList &metrics);
+    int interval() const;
+    void setInterval(int intervalMs);
+    bool active() const;
+    void setActive(bool active);
+
+signals:
+    void schedulerChanged();
+    void metricsChanged();
+    void intervalChanged();
+    void activeChanged();
+
+private:
+    void resubscribe();
+    void release();
+
+    QPointer<MetricScheduler> m_scheduler;
+    QStringList m_metrics;
+    int m_interval = 1000;
+    bool m_active = true;
+    bool m_complete = false;
+    int m_token = 0;
+};
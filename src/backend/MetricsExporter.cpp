@@ -0,0 +1,492 @@
+#include "MetricsExporter.h"
+
+#include "MetricScheduler.h"
+#include "NetlinkMonitor.h"
+#include "PressureMonitor.h"
+#include "SystemDetailsBackend.h"
+#include "SystemHelpers.h"
+#include "SystemStatsBackend.h"
+
+#include <QDebug>
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <cmath>
+
+namespace {
+
+constexpr int kDefaultIntervalMs = 5000;
+constexpr int kMaxRequestBytes = 8192;
+constexpr int kRequestTimeoutMs = 5000;
+
+using Labels = QList<QPair<QByteArray, QString>>;
+
+int intervalFromEnvironment()
+{
+    bool ok = false;
+    const int configured = Backend::readEnvironmentValue("ORBITAL_METRICS_INTERVAL_MS").toInt(&ok);
+    return ok && configured > 0 ? configured : kDefaultIntervalMs;
+}
+
+QByteArray escapeLabelValue(const QString &value)
+{
+    QByteArray escaped;
+    const QByteArray utf8 = value.toUtf8();
+    escaped.reserve(utf8.size());
+    for (const char c : utf8) {
+        if (c == '\\') {
+            escaped += "\\\\";
+        } else if (c == '"') {
+            escaped += "\\\"";
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+QByteArray formatValue(double value)
+{
+    if (std::isnan(value)) {
+        return QByteArrayLiteral("NaN");
+    }
+
+    if (std::isinf(value)) {
+        return value > 0 ? QByteArrayLiteral("+Inf") : QByteArrayLiteral("-Inf");
+    }
+
+    return QByteArray::number(value, 'g', 12);
+}
+
+// Accumulates one exposition. OpenMetrics wants each family's metadata once
+// and directly before its samples, so every family is written in one go.
+// OpenMetrics names a counter family without the "_total" its samples
+// carry; the Prometheus 0.0.4 text format has no such split, so there the
+// metadata uses the sample name.
+class Exposition
+{
+public:
+    explicit Exposition(bool openMetrics)
+        : m_openMetrics(openMetrics)
+    {
+    }
+
+    void family(const char *name, const char *type, const char *help)
+    {
+        const bool counter = qstrcmp(type, "counter") == 0;
+        m_family = name;
+        m_suffix.clear();
+        if (counter && m_openMetrics) {
+            m_suffix = QByteArrayLiteral("_total");
+        } else if (counter) {
+            m_family += "_total";
+        }
+        m_text += "# TYPE " + m_family + ' ' + type + '\n';
+        m_text += "# HELP " + m_family + ' ' + help + '\n';
+    }
+
+    void sample(const Labels &labels, double value)
+    {
+        m_text += m_family + m_suffix;
+        if (!labels.isEmpty()) {
+            m_text += '{';
+            for (int index = 0; index < labels.size(); ++index) {
+                if (index > 0) {
+                    m_text += ',';
+                }
+                m_text += labels.at(index).first + "=\"" + escapeLabelValue(labels.at(index).second) + '"';
+            }
+            m_text += '}';
+        }
+        m_text += ' ' + formatValue(value) + '\n';
+    }
+
+    void sample(double value)
+    {
+        sample({}, value);
+    }
+
+    QByteArray finish()
+    {
+        if (m_openMetrics) {
+            m_text += "# EOF\n";
+        }
+        return m_text;
+    }
+
+private:
+    bool m_openMetrics;
+    QByteArray m_text;
+    QByteArray m_family;
+    QByteArray m_suffix;
+};
+
+} // namespace
+
+MetricsExporter::MetricsExporter(const Sources &sources, QObject *parent)
+    : QObject(parent)
+    , m_sources(sources)
+{
+}
+
+bool MetricsExporter::listen(const QString &address)
+{
+    if (address.startsWith(QLatin1String("unix:"))) {
+        const QString path = address.mid(5);
+        m_localServer = new QLocalServer(this);
+        m_localServer->setSocketOptions(QLocalServer::UserAccessOption);
+        // A socket file left behind by a crashed instance would block listen().
+        QLocalServer::removeServer(path);
+        if (!m_localServer->listen(path)) {
+            qWarning() << "MetricsExporter: cannot listen on" << path << m_localServer->errorString();
+            delete m_localServer;
+            m_localServer = nullptr;
+            return false;
+        }
+
+        connect(m_localServer, &QLocalServer::newConnection, this, &MetricsExporter::acceptLocal);
+    } else {
+        const int colon = address.lastIndexOf(QLatin1Char(':'));
+        bool ok = false;
+        const quint16 port = colon > 0 ? address.mid(colon + 1).toUShort(&ok) : 0;
+        QString host = colon > 0 ? address.left(colon) : QString();
+        if (host.startsWith(QLatin1Char('[')) && host.endsWith(QLatin1Char(']'))) {
+            host = host.mid(1, host.size() - 2);
+        }
+
+        QHostAddress hostAddress;
+        if (host == QLatin1String("localhost")) {
+            hostAddress = QHostAddress::LocalHost;
+        } else {
+            hostAddress.setAddress(host);
+        }
+
+        if (!ok || hostAddress.isNull()) {
+            qWarning() << "MetricsExporter: invalid listen address" << address;
+            return false;
+        }
+
+        // The metrics include process names and pids; serving them beyond
+        // this machine has to be asked for explicitly.
+        if (!hostAddress.isLoopback()
+            && Backend::readEnvironmentValue("ORBITAL_METRICS_ALLOW_REMOTE") != QLatin1String("1")) {
+            qWarning() << "MetricsExporter: refusing non-loopback listen address" << address
+                       << "(set ORBITAL_METRICS_ALLOW_REMOTE=1 to allow it)";
+            return false;
+        }
+
+        m_tcpServer = new QTcpServer(this);
+        if (!m_tcpServer->listen(hostAddress, port)) {
+            qWarning() << "MetricsExporter: cannot listen on" << address << m_tcpServer->errorString();
+            delete m_tcpServer;
+            m_tcpServer = nullptr;
+            return false;
+        }
+
+        connect(m_tcpServer, &QTcpServer::newConnection, this, &MetricsExporter::acceptTcp);
+    }
+
+    m_subscription = m_sources.scheduler->subscribe(
+        { QStringLiteral("cpu"), QStringLiteral("memory"), QStringLiteral("disk"),
+          QStringLiteral("battery"), QStringLiteral("network"), QStringLiteral("load"),
+          QStringLiteral("pressure"), QStringLiteral("details") },
+        intervalFromEnvironment(), this);
+    return true;
+}
+
+bool MetricsExporter::isListening() const
+{
+    return m_tcpServer || m_localServer;
+}
+
+void MetricsExporter::acceptTcp()
+{
+    while (QTcpSocket *socket = m_tcpServer->nextPendingConnection()) {
+        attach(socket);
+    }
+}
+
+void MetricsExporter::acceptLocal()
+{
+    while (QLocalSocket *socket = m_localServer->nextPendingConnection()) {
+        attach(socket);
+    }
+}
+
+void MetricsExporter::attach(QIODevice *socket)
+{
+    m_pending.insert(socket, QByteArray());
+    connect(socket, &QIODevice::readyRead, this, [this, socket]() { readRequest(socket); });
+    connect(socket, &QObject::destroyed, this, [this, socket]() { m_pending.remove(socket); });
+
+    if (auto *tcp = qobject_cast<QTcpSocket *>(socket)) {
+        connect(tcp, &QTcpSocket::disconnected, tcp, &QObject::deleteLater);
+    } else if (auto *local = qobject_cast<QLocalSocket *>(socket)) {
+        connect(local, &QLocalSocket::disconnected, local, &QObject::deleteLater);
+    }
+
+    // Clients that never finish their request must not pin a socket forever.
+    QPointer<QIODevice> guard(socket);
+    QTimer::singleShot(kRequestTimeoutMs, this, [guard]() {
+        if (guard) {
+            guard->close();
+            guard->deleteLater();
+        }
+    });
+
+    readRequest(socket);
+}
+
+void MetricsExporter::readRequest(QIODevice *socket)
+{
+    auto it = m_pending.find(socket);
+    if (it == m_pending.end()) {
+        return;
+    }
+
+    it.value() += socket->readAll();
+    if (it.value().size() > kMaxRequestBytes) {
+        m_pending.erase(it);
+        respond(socket, "431 Request Header Fields Too Large", "text/plain", "request too large\n");
+        return;
+    }
+
+    const int headerEnd = it.value().indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return;
+    }
+
+    const QByteArray request = it.value().left(headerEnd);
+    m_pending.erase(it);
+
+    const QList<QByteArray> lines = request.split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() < 2) {
+        respond(socket, "400 Bad Request", "text/plain", "bad request\n");
+        return;
+    }
+
+    const QByteArray &method = requestLine.at(0);
+    const QByteArray path = requestLine.at(1).split('?').first();
+    if (method != "GET" && method != "HEAD") {
+        respond(socket, "405 Method Not Allowed", "text/plain", "method not allowed\n");
+        return;
+    }
+
+    if (path != "/metrics") {
+        respond(socket, "404 Not Found", "text/plain", "try /metrics\n");
+        return;
+    }
+
+    bool openMetrics = false;
+    for (int index = 1; index < lines.size(); ++index) {
+        const QByteArray line = lines.at(index).trimmed().toLower();
+        if (line.startsWith("accept:") && line.contains("application/openmetrics-text")) {
+            openMetrics = true;
+        }
+    }
+
+    const QByteArray contentType = openMetrics
+                                       ? QByteArrayLiteral("application/openmetrics-text; version=1.0.0; charset=utf-8")
+                                       : QByteArrayLiteral("text/plain; version=0.0.4; charset=utf-8");
+    const QByteArray body = render(openMetrics);
+    respond(socket, "200 OK", contentType, method == "HEAD" ? QByteArray() : body);
+}
+
+void MetricsExporter::respond(QIODevice *socket, const QByteArray &status,
+                              const QByteArray &contentType, const QByteArray &body)
+{
+    QByteArray response = "HTTP/1.1 " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+    socket->write(response);
+
+    // Both flush pending data before closing.
+    if (auto *tcp = qobject_cast<QTcpSocket *>(socket)) {
+        tcp->disconnectFromHost();
+    } else if (auto *local = qobject_cast<QLocalSocket *>(socket)) {
+        local->disconnectFromServer();
+    }
+}
+
+QByteArray MetricsExporter::render(bool openMetrics) const
+{
+    Exposition out(openMetrics);
+    const SystemStatsBackend *stats = m_sources.stats;
+
+    out.family("orbital_cpu_usage_ratio", "gauge", "Busy fraction of all CPUs since the previous sample.");
+    out.sample(stats->cpuTotal());
+
+    const QVector<double> cores = stats->cpuCoreUsage();
+    if (!cores.isEmpty()) {
+        out.family("orbital_cpu_core_usage_ratio", "gauge", "Busy fraction per CPU since the previous sample.");
+        for (int index = 0; index < cores.size(); ++index) {
+            out.sample({ { "cpu", QString::number(index) } }, cores.at(index));
+        }
+    }
+
+    const QVariantMap states = stats->cpuStates();
+    out.family("orbital_cpu_state_ratio", "gauge", "Share of all CPU time per state since the previous sample.");
+    for (auto it = states.cbegin(); it != states.cend(); ++it) {
+        out.sample({ { "state", it.key() } }, it.value().toDouble());
+    }
+
+    const QVariantList frequencies = m_sources.details->cpuFrequencies();
+    if (!frequencies.isEmpty()) {
+        out.family("orbital_cpu_frequency_hertz", "gauge", "Current frequency per online CPU.");
+        for (const QVariant &entry : frequencies) {
+            const QVariantMap map = entry.toMap();
+            if (map.value(QStringLiteral("online")).toBool()) {
+                out.sample({ { "cpu", map.value(QStringLiteral("core")).toString() } },
+                           map.value(QStringLiteral("freqMHz")).toDouble() * 1e6);
+            }
+        }
+    }
+
+    const QVector<double> load = stats->loadAverages();
+    if (load.size() == 3) {
+        out.family("orbital_load_average", "gauge", "System load average.");
+        out.sample({ { "period", QStringLiteral("1m") } }, load.at(0));
+        out.sample({ { "period", QStringLiteral("5m") } }, load.at(1));
+        out.sample({ { "period", QStringLiteral("15m") } }, load.at(2));
+    }
+
+    if (stats->memTotalBytes() > 0) {
+        out.family("orbital_memory_total_bytes", "gauge", "MemTotal from /proc/meminfo.");
+        out.sample(stats->memTotalBytes());
+        out.family("orbital_memory_available_bytes", "gauge", "MemAvailable from /proc/meminfo.");
+        out.sample(stats->memAvailableBytes());
+    }
+
+    const QVariantList partitions = stats->diskPartitions();
+    if (!partitions.isEmpty()) {
+        auto labelsFor = [](const QVariantMap &part) {
+            return Labels{ { "device", part.value(QStringLiteral("device")).toString() },
+                           { "mountpoint", part.value(QStringLiteral("mount")).toString() },
+                           { "fstype", part.value(QStringLiteral("type")).toString() } };
+        };
+
+        out.family("orbital_filesystem_size_bytes", "gauge", "Filesystem size.");
+        for (const QVariant &entry : partitions) {
+            const QVariantMap part = entry.toMap();
+            out.sample(labelsFor(part), part.value(QStringLiteral("totalBytes")).toDouble());
+        }
+
+        out.family("orbital_filesystem_avail_bytes", "gauge", "Filesystem space available to unprivileged users.");
+        for (const QVariant &entry : partitions) {
+            const QVariantMap part = entry.toMap();
+            out.sample(labelsFor(part), part.value(QStringLiteral("availableBytes")).toDouble());
+        }
+
+        out.family("orbital_filesystem_stale", "gauge", "1 if the last statfs did not return in time.");
+        for (const QVariant &entry : partitions) {
+            const QVariantMap part = entry.toMap();
+            out.sample(labelsFor(part), part.value(QStringLiteral("stale")).toBool() ? 1 : 0);
+        }
+    }
+
+    // Counters as of the last "network" sample; reading the table is free.
+    const QVector<NetlinkMonitor::Link> links = m_sources.netlink->links();
+    if (!links.isEmpty()) {
+        out.family("orbital_network_receive_bytes", "counter", "Bytes received per interface.");
+        for (const NetlinkMonitor::Link &link : links) {
+            out.sample({ { "device", link.name } }, static_cast<double>(link.rxBytes));
+        }
+
+        out.family("orbital_network_transmit_bytes", "counter", "Bytes transmitted per interface.");
+        for (const NetlinkMonitor::Link &link : links) {
+            out.sample({ { "device", link.name } }, static_cast<double>(link.txBytes));
+        }
+
+        out.family("orbital_network_up", "gauge", "1 if the interface is operationally up.");
+        for (const NetlinkMonitor::Link &link : links) {
+            out.sample({ { "device", link.name } }, link.operUp ? 1 : 0);
+        }
+    }
+
+    // batDetails stays empty until a battery has actually been read.
+    const QString batteryState = stats->batState();
+    if (!stats->batDetails().isEmpty()) {
+        out.family("orbital_battery_capacity_ratio", "gauge", "Battery charge level.");
+        out.sample(stats->batPercent() / 100.0);
+        out.family("orbital_battery_status", "gauge", "Power supply status reported by the driver.");
+        out.sample({ { "status", batteryState } }, 1);
+        if (stats->batPowerWatts() >= 0.0) {
+            out.family("orbital_battery_power_watts", "gauge", "Smoothed battery power draw.");
+            out.sample(stats->batPowerWatts());
+        }
+    }
+
+    if (m_sources.pressure->isAvailable()) {
+        const QStringList resources = { QStringLiteral("cpu"), QStringLiteral("memory"), QStringLiteral("io") };
+
+        out.family("orbital_pressure_stalled_seconds", "counter", "Time tasks stalled on the resource (PSI total).");
+        for (const QString &name : resources) {
+            const PressureMonitor::Resource resource = m_sources.pressure->resource(name);
+            if (resource.name.isEmpty()) {
+                continue;
+            }
+
+            out.sample({ { "resource", name }, { "kind", QStringLiteral("some") } }, resource.some.totalUs / 1e6);
+            if (resource.hasFull) {
+                out.sample({ { "resource", name }, { "kind", QStringLiteral("full") } }, resource.full.totalUs / 1e6);
+            }
+        }
+
+        out.family("orbital_pressure_avg10_ratio", "gauge", "Share of the last 10 s tasks stalled on the resource.");
+        for (const QString &name : resources) {
+            const PressureMonitor::Resource resource = m_sources.pressure->resource(name);
+            if (resource.name.isEmpty()) {
+                continue;
+            }
+
+            out.sample({ { "resource", name }, { "kind", QStringLiteral("some") } }, resource.some.avg10 / 100.0);
+            if (resource.hasFull) {
+                out.sample({ { "resource", name }, { "kind", QStringLiteral("full") } }, resource.full.avg10 / 100.0);
+            }
+        }
+    }
+
+    const QVariantList sensors = m_sources.details->thermalSensors();
+    if (!sensors.isEmpty()) {
+        out.family("orbital_thermal_celsius", "gauge", "Temperature per thermal sensor.");
+        for (const QVariant &entry : sensors) {
+            const QVariantMap map = entry.toMap();
+            out.sample({ { "sensor", map.value(QStringLiteral("key")).toString() },
+                         { "name", map.value(QStringLiteral("name")).toString() } },
+                       map.value(QStringLiteral("tempC")).toDouble());
+        }
+    }
+
+    const QVariantList processes = m_sources.details->topProcesses();
+    if (!processes.isEmpty()) {
+        auto labelsFor = [](const QVariantMap &process) {
+            return Labels{ { "pid", process.value(QStringLiteral("pid")).toString() },
+                           { "name", process.value(QStringLiteral("name")).toString() } };
+        };
+
+        out.family("orbital_top_process_cpu_ratio", "gauge", "CPU share of the busiest processes.");
+        for (const QVariant &entry : processes) {
+            const QVariantMap process = entry.toMap();
+            out.sample(labelsFor(process), process.value(QStringLiteral("cpuPercent")).toDouble() / 100.0);
+        }
+
+        out.family("orbital_top_process_memory_ratio", "gauge", "Resident memory share of the busiest processes.");
+        for (const QVariant &entry : processes) {
+            const QVariantMap process = entry.toMap();
+            out.sample(labelsFor(process), process.value(QStringLiteral("memoryPercent")).toDouble() / 100.0);
+        }
+    }
+
+    return out.finish();
+}
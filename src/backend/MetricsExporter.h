@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class MetricScheduler;
+class NetlinkMonitor;
+class PressureMonitor;
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+class SystemDetailsBackend;
+class SystemStatsBackend;
+
+// Serves the latest collected values in OpenMetrics (or, without an
+// OpenMetrics Accept header, Prometheus 0.0.4) text format over a
+// minimal HTTP endpoint (GET /metrics), so a scraper can read what Orbital
+// already sampled instead of running a second agent over /proc. A scrape
+// only renders the current snapshot; freshness comes from one scheduler
+// subscription held at ORBITAL_METRICS_INTERVAL_MS.
+//
+// The listen address is "host:port" for TCP or "unix:/path" for a local
+// socket, e.g. ORBITAL_METRICS_LISTEN=127.0.0.1:9101.
+// TCP addresses must be loopback unless ORBITAL_METRICS_ALLOW_REMOTE=1.
+class MetricsExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Sources {
+        MetricScheduler *scheduler = nullptr;
+        SystemStatsBackend *stats = nullptr;
+        SystemDetailsBackend *details = nullptr;
+        PressureMonitor *pressure = nullptr;
+        NetlinkMonitor *netlink = nullptr;
+    };
+
+    MetricsExporter(const Sources &sources, QObject *parent = nullptr);
+
+    bool listen(const QString &address);
+    bool isListening() const;
+
+    // OpenMetrics 1.0 when `openMetrics` is set, otherwise the Prometheus
+    // 0.0.4 text format.
+    QByteArray render(bool openMetrics = true) const;
+
+private:
+    void acceptTcp();
+    void acceptLocal();
+    void attach(QIODevice *socket);
+    void readRequest(QIODevice *socket);
+    void respond(QIODevice *socket, const QByteArray &status,
+                 const QByteArray &contentType, const QByteArray &body);
+
+    Sources m_sources;
+    QTcpServer *m_tcpServer = nullptr;
+    QLocalServer *m_localServer = nullptr;
+    int m_subscription = 0;
+    QHash<QIODevice *, QByteArray> m_pending;
+};
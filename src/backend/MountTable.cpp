@@ -0,0 +1,155 @@
+#include "MountTable.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+bool isPseudoFilesystem(const QString &fsType)
+{
+    static const QStringList pseudoTypes = {
+        QStringLiteral("autofs"), QStringLiteral("binfmt_misc"), QStringLiteral("bpf"),
+        QStringLiteral("cgroup"), QStringLiteral("cgroup2"), QStringLiteral("configfs"),
+        QStringLiteral("debugfs"), QStringLiteral("devpts"), QStringLiteral("efivarfs"),
+        QStringLiteral("fusectl"), QStringLiteral("hugetlbfs"), QStringLiteral("mqueue"),
+        QStringLiteral("nsfs"), QStringLiteral("pstore"), QStringLiteral("ramfs"),
+        QStringLiteral("rpc_pipefs"), QStringLiteral("securityfs"), QStringLiteral("tracefs")
+    };
+
+    return fsType.contains(QLatin1String("tmpfs")) || fsType.contains(QLatin1String("proc"))
+        || fsType.contains(QLatin1String("sysfs")) || fsType.contains(QLatin1String("overlay"))
+        || pseudoTypes.contains(fsType);
+}
+
+// mountinfo escapes space, tab, newline and backslash as \ooo octal.
+QString unescapeMountField(const QByteArray &field)
+{
+    QByteArray result;
+    result.reserve(field.size());
+    for (int index = 0; index < field.size(); ++index) {
+        const char ch = field.at(index);
+        if (ch == '\\' && index + 3 < field.size()) {
+            bool ok = false;
+            const int value = field.mid(index + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                result.append(static_cast<char>(value));
+                index += 3;
+                continue;
+            }
+        }
+
+        result.append(ch);
+    }
+
+    return QString::fromUtf8(result);
+}
+
+} // namespace
+
+MountTable::MountTable(QObject *parent)
+    : QObject(parent)
+{
+    m_fd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        qWarning() << "MountTable: cannot open /proc/self/mountinfo:" << std::strerror(errno);
+        return;
+    }
+
+    reload();
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Exception, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, [this]() {
+        if (reload()) {
+            emit mountsChanged();
+        }
+    });
+}
+
+MountTable::~MountTable()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+QVector<MountTable::Entry> MountTable::mounts() const
+{
+    return m_mounts;
+}
+
+bool MountTable::reload()
+{
+    const QByteArray content = readAll();
+    if (content.isEmpty()) {
+        return false;
+    }
+
+    QVector<Entry> mounts;
+    QHash<QString, int> indexByMountPoint;
+    for (const QByteArray &line : content.split('\n')) {
+        // 36 35 98:0 /root /mnt rw,noatime master:1 - ext4 /dev/sda1 rw
+        const QList<QByteArray> fields = line.split(' ');
+        const int separator = fields.indexOf(QByteArrayLiteral("-"));
+        if (fields.size() < 5 || separator < 6 || separator + 2 >= fields.size()) {
+            continue;
+        }
+
+        Entry entry;
+        entry.mountId = fields.at(0).toInt();
+        entry.mountPoint = unescapeMountField(fields.at(4));
+        entry.fsType = QString::fromUtf8(fields.at(separator + 1));
+        entry.device = unescapeMountField(fields.at(separator + 2));
+        if (isPseudoFilesystem(entry.fsType)) {
+            continue;
+        }
+
+        // A later mount on the same point shadows the earlier one.
+        const auto existing = indexByMountPoint.constFind(entry.mountPoint);
+        if (existing != indexByMountPoint.constEnd()) {
+            mounts[existing.value()] = entry;
+            continue;
+        }
+
+        indexByMountPoint.insert(entry.mountPoint, mounts.size());
+        mounts.append(entry);
+    }
+
+    if (mounts == m_mounts) {
+        return false;
+    }
+
+    m_mounts = mounts;
+    return true;
+}
+
+QByteArray MountTable::readAll() const
+{
+    QByteArray content;
+    if (m_fd < 0 || ::lseek(m_fd, 0, SEEK_SET) < 0) {
+        return content;
+    }
+
+    char buffer[8192];
+    while (true) {
+        const ssize_t bytes = ::read(m_fd, buffer, sizeof(buffer));
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes <= 0) {
+            break;
+        }
+
+        content.append(buffer, static_cast<int>(bytes));
+    }
+
+    return content;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class QSocketNotifier;
+
+// Cached view of /proc/self/mountinfo. The kernel flags the file with
+// POLLPRI whenever the mount table changes, so it is only re-parsed then
+// instead of on every disk sample. Pseudo filesystems are filtered out.
+class MountTable : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        int mountId = 0;
+        QString device;
+        QString mountPoint;
+        QString fsType;
+
+        bool operator==(const Entry &other) const
+        {
+            return mountId == other.mountId && device == other.device
+                && mountPoint == other.mountPoint && fsType == other.fsType;
+        }
+    };
+
+    explicit MountTable(QObject *parent = nullptr);
+    ~MountTable() override;
+
+    QVector<Entry> mounts() const;
+
+signals:
+    void mountsChanged();
+
+private:
+    bool reload();
+    QByteArray readAll() const;
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QVector<Entry> m_mounts;
+};
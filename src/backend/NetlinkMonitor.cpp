@@ -0,0 +1,448 @@
+#include "NetlinkMonitor.h"
+
+#include <QDebug>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <linux/if.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+// Large enough for one dump part; the kernel sizes dump skbs to at most 32 KiB.
+constexpr size_t kReceiveBufferSize = 64 * 1024;
+constexpr int kQueryTimeoutMs = 1000;
+
+int openRouteSocket(unsigned int groups)
+{
+    const int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sockaddr_nl address {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = groups;
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+QString formatHardwareAddress(const unsigned char *data, int length)
+{
+    QStringList parts;
+    parts.reserve(length);
+    for (int index = 0; index < length; ++index) {
+        parts.append(QStringLiteral("%1").arg(data[index], 2, 16, QLatin1Char('0')).toUpper());
+    }
+
+    return parts.join(QLatin1Char(':'));
+}
+
+QHostAddress hostAddressFrom(int family, const void *data, int length)
+{
+    if (family == AF_INET && length >= 4) {
+        quint32 raw = 0;
+        std::memcpy(&raw, data, sizeof(raw));
+        return QHostAddress(ntohl(raw));
+    }
+
+    if (family == AF_INET6 && length >= 16) {
+        return QHostAddress(static_cast<const quint8 *>(data));
+    }
+
+    return {};
+}
+
+} // namespace
+
+NetlinkMonitor::NetlinkMonitor(QObject *parent)
+    : QObject(parent)
+    , m_buffer(kReceiveBufferSize)
+{
+    // Subscribe first so nothing that changes during the initial dump is lost;
+    // replayed events are idempotent upserts.
+    m_eventFd = openRouteSocket(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR | RTMGRP_IPV4_ROUTE);
+    m_queryFd = openRouteSocket(0);
+    if (m_eventFd < 0 || m_queryFd < 0) {
+        qWarning() << "NetlinkMonitor: cannot open NETLINK_ROUTE socket:" << std::strerror(errno);
+        return;
+    }
+
+    timeval timeout {};
+    timeout.tv_sec = kQueryTimeoutMs / 1000;
+    timeout.tv_usec = (kQueryTimeoutMs % 1000) * 1000;
+    ::setsockopt(m_queryFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    resync();
+
+    m_notifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &NetlinkMonitor::readEvents);
+}
+
+NetlinkMonitor::~NetlinkMonitor()
+{
+    if (m_eventFd >= 0) {
+        ::close(m_eventFd);
+    }
+
+    if (m_queryFd >= 0) {
+        ::close(m_queryFd);
+    }
+}
+
+bool NetlinkMonitor::isValid() const
+{
+    return m_eventFd >= 0 && m_queryFd >= 0;
+}
+
+QVector<NetlinkMonitor::Link> NetlinkMonitor::links() const
+{
+    return QVector<Link>(m_links.cbegin(), m_links.cend());
+}
+
+QVector<NetlinkMonitor::Address> NetlinkMonitor::addresses(int linkIndex) const
+{
+    QVector<Address> result;
+    for (const Address &address : m_addresses) {
+        if (address.linkIndex == linkIndex) {
+            result.append(address);
+        }
+    }
+
+    return result;
+}
+
+QString NetlinkMonitor::defaultRouteInterface() const
+{
+    const DefaultRoute *best = nullptr;
+    for (const DefaultRoute &route : m_defaultRoutes) {
+        if (!best || route.priority < best->priority) {
+            best = &route;
+        }
+    }
+
+    return best ? m_links.value(best->linkIndex).name : QString();
+}
+
+bool NetlinkMonitor::refreshCounters()
+{
+    if (!isValid()) {
+        return false;
+    }
+
+    // The dump also catches link changes whose events were lost or are
+    // still queued on the event socket.
+    bool changed = false;
+    const bool ok = dump(RTM_GETLINK, AF_UNSPEC, &changed);
+    if (changed) {
+        emit interfacesChanged();
+    }
+
+    return ok;
+}
+
+bool NetlinkMonitor::resync()
+{
+    m_links.clear();
+    m_addresses.clear();
+    m_defaultRoutes.clear();
+
+    return dump(RTM_GETLINK, AF_UNSPEC) && dump(RTM_GETADDR, AF_UNSPEC) && dump(RTM_GETROUTE, AF_INET);
+}
+
+bool NetlinkMonitor::dump(int type, unsigned char family, bool *changed)
+{
+    // ifinfomsg, ifaddrmsg and rtmsg all start with the family byte, and a
+    // zeroed body of the largest of them is a valid unfiltered dump request.
+    struct {
+        nlmsghdr header;
+        ifinfomsg body;
+    } request {};
+
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.body));
+    request.header.nlmsg_type = static_cast<__u16>(type);
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++m_sequence;
+    request.body.ifi_family = family;
+
+    if (::send(m_queryFd, &request, request.header.nlmsg_len, 0) < 0) {
+        qWarning() << "NetlinkMonitor: dump request failed:" << std::strerror(errno);
+        return false;
+    }
+
+    while (true) {
+        const ssize_t received = ::recv(m_queryFd, m_buffer.data(), m_buffer.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            qWarning() << "NetlinkMonitor: dump receive failed:" << std::strerror(errno);
+            return false;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(m_buffer.data()); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq != m_sequence) {
+                continue;
+            }
+
+            if (header->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                return false;
+            }
+
+            if (handleMessage(header) && changed) {
+                *changed = true;
+            }
+        }
+    }
+}
+
+void NetlinkMonitor::readEvents()
+{
+    bool changed = false;
+    while (true) {
+        const ssize_t received = ::recv(m_eventFd, m_buffer.data(), m_buffer.size(), MSG_DONTWAIT);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // The kernel dropped events because we fell behind; the tables
+            // can no longer be patched incrementally.
+            if (errno == ENOBUFS) {
+                resync();
+                changed = true;
+                continue;
+            }
+
+            break;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(m_buffer.data()); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            changed = handleMessage(header) || changed;
+        }
+    }
+
+    if (changed) {
+        emit interfacesChanged();
+    }
+}
+
+bool NetlinkMonitor::handleMessage(nlmsghdr *header)
+{
+    switch (header->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+        return handleLink(header);
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+        return handleAddress(header);
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE:
+        return handleRoute(header);
+    default:
+        return false;
+    }
+}
+
+bool NetlinkMonitor::handleLink(nlmsghdr *header)
+{
+    auto *info = static_cast<ifinfomsg *>(NLMSG_DATA(header));
+    if (header->nlmsg_type == RTM_DELLINK) {
+        const int index = info->ifi_index;
+        m_addresses.erase(std::remove_if(m_addresses.begin(), m_addresses.end(),
+                                         [index](const Address &address) { return address.linkIndex == index; }),
+                          m_addresses.end());
+        return m_links.remove(index) > 0;
+    }
+
+    Link link;
+    link.index = info->ifi_index;
+    link.up = info->ifi_flags & IFF_UP;
+    link.running = info->ifi_flags & IFF_RUNNING;
+    link.loopback = info->ifi_flags & IFF_LOOPBACK;
+
+    bool haveStats64 = false;
+    int length = IFLA_PAYLOAD(header);
+    for (auto *attr = IFLA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+        const int payload = static_cast<int>(RTA_PAYLOAD(attr));
+        switch (attr->rta_type) {
+        case IFLA_IFNAME:
+            link.name = QString::fromUtf8(static_cast<const char *>(RTA_DATA(attr)),
+                                          static_cast<int>(strnlen(static_cast<const char *>(RTA_DATA(attr)), payload)));
+            break;
+        case IFLA_ADDRESS:
+            link.mac = formatHardwareAddress(static_cast<const unsigned char *>(RTA_DATA(attr)), payload);
+            break;
+        case IFLA_OPERSTATE:
+            link.operUp = payload >= 1 && *static_cast<const unsigned char *>(RTA_DATA(attr)) == IF_OPER_UP;
+            break;
+        case IFLA_STATS64:
+            if (payload >= static_cast<int>(sizeof(rtnl_link_stats64))) {
+                rtnl_link_stats64 stats {};
+                std::memcpy(&stats, RTA_DATA(attr), sizeof(stats));
+                link.rxBytes = stats.rx_bytes;
+                link.txBytes = stats.tx_bytes;
+                haveStats64 = true;
+            }
+            break;
+        case IFLA_STATS:
+            if (!haveStats64 && payload >= static_cast<int>(sizeof(rtnl_link_stats))) {
+                rtnl_link_stats stats {};
+                std::memcpy(&stats, RTA_DATA(attr), sizeof(stats));
+                link.rxBytes = stats.rx_bytes;
+                link.txBytes = stats.tx_bytes;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    const auto existing = m_links.constFind(link.index);
+    const bool changed = existing == m_links.constEnd() || existing->name != link.name
+        || existing->mac != link.mac || existing->up != link.up || existing->running != link.running
+        || existing->loopback != link.loopback || existing->operUp != link.operUp;
+    m_links.insert(link.index, link);
+    return changed;
+}
+
+bool NetlinkMonitor::handleAddress(nlmsghdr *header)
+{
+    auto *info = static_cast<ifaddrmsg *>(NLMSG_DATA(header));
+    if (info->ifa_family != AF_INET && info->ifa_family != AF_INET6) {
+        return false;
+    }
+
+    // IFA_LOCAL is the interface's own address; IFA_ADDRESS is the peer on
+    // point-to-point links and identical otherwise.
+    QHostAddress local;
+    QHostAddress address;
+    int length = IFA_PAYLOAD(header);
+    for (auto *attr = IFA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+        const int payload = static_cast<int>(RTA_PAYLOAD(attr));
+        if (attr->rta_type == IFA_LOCAL) {
+            local = hostAddressFrom(info->ifa_family, RTA_DATA(attr), payload);
+        } else if (attr->rta_type == IFA_ADDRESS) {
+            address = hostAddressFrom(info->ifa_family, RTA_DATA(attr), payload);
+        }
+    }
+
+    Address entry;
+    entry.linkIndex = static_cast<int>(info->ifa_index);
+    entry.ip = local.isNull() ? address : local;
+    entry.prefixLength = info->ifa_prefixlen;
+    if (entry.ip.isNull()) {
+        return false;
+    }
+
+    if (entry.ip.protocol() == QAbstractSocket::IPv6Protocol && entry.ip.isLinkLocal()) {
+        entry.ip.setScopeId(m_links.value(entry.linkIndex).name);
+    }
+
+    const auto existing = std::find_if(m_addresses.begin(), m_addresses.end(), [&entry](const Address &other) {
+        return other.linkIndex == entry.linkIndex && other.ip == entry.ip;
+    });
+
+    if (header->nlmsg_type == RTM_DELADDR) {
+        if (existing == m_addresses.end()) {
+            return false;
+        }
+
+        m_addresses.erase(existing);
+        return true;
+    }
+
+    if (existing != m_addresses.end()) {
+        const bool changed = existing->prefixLength != entry.prefixLength;
+        *existing = entry;
+        return changed;
+    }
+
+    m_addresses.append(entry);
+    return true;
+}
+
+bool NetlinkMonitor::handleRoute(nlmsghdr *header)
+{
+    auto *info = static_cast<rtmsg *>(NLMSG_DATA(header));
+    if (info->rtm_family != AF_INET || info->rtm_dst_len != 0 || info->rtm_type != RTN_UNICAST) {
+        return false;
+    }
+
+    quint32 table = info->rtm_table;
+    bool hasGateway = false;
+    DefaultRoute route;
+    int length = RTM_PAYLOAD(header);
+    for (auto *attr = RTM_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+        const int payload = static_cast<int>(RTA_PAYLOAD(attr));
+        if (payload < static_cast<int>(sizeof(quint32))) {
+            continue;
+        }
+
+        quint32 value = 0;
+        std::memcpy(&value, RTA_DATA(attr), sizeof(value));
+        switch (attr->rta_type) {
+        case RTA_TABLE:
+            table = value;
+            break;
+        case RTA_OIF:
+            route.linkIndex = static_cast<int>(value);
+            break;
+        case RTA_PRIORITY:
+            route.priority = value;
+            break;
+        case RTA_GATEWAY:
+            hasGateway = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (table != RT_TABLE_MAIN || !hasGateway || route.linkIndex == 0) {
+        return false;
+    }
+
+    const auto existing = std::find_if(m_defaultRoutes.begin(), m_defaultRoutes.end(), [&route](const DefaultRoute &other) {
+        return other.linkIndex == route.linkIndex && other.priority == route.priority;
+    });
+
+    if (header->nlmsg_type == RTM_DELROUTE) {
+        if (existing == m_defaultRoutes.end()) {
+            return false;
+        }
+
+        m_defaultRoutes.erase(existing);
+        return true;
+    }
+
+    if (existing != m_defaultRoutes.end()) {
+        return false;
+    }
+
+    m_defaultRoutes.append(route);
+    return true;
+}
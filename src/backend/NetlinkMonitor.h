@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QHostAddress>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+class QSocketNotifier;
+struct nlmsghdr;
+
+// rtnetlink view of network interfaces, addresses and the IPv4 default
+// route. The tables are filled by an initial dump and then kept current from
+// RTM_NEW*/RTM_DEL* multicast events, so nothing is enumerated periodically.
+// Byte counters are refreshed on demand with one RTM_GETLINK dump.
+class NetlinkMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Link {
+        int index = 0;
+        QString name;
+        QString mac;
+        bool up = false;
+        bool running = false;
+        bool loopback = false;
+        bool operUp = false;
+        quint64 rxBytes = 0;
+        quint64 txBytes = 0;
+    };
+
+    struct Address {
+        int linkIndex = 0;
+        QHostAddress ip;
+        int prefixLength = 0;
+    };
+
+    explicit NetlinkMonitor(QObject *parent = nullptr);
+    ~NetlinkMonitor() override;
+
+    bool isValid() const;
+
+    // Ordered by interface index.
+    QVector<Link> links() const;
+    QVector<Address> addresses(int linkIndex) const;
+    // Interface of the preferred IPv4 default route via a gateway, if any.
+    QString defaultRouteInterface() const;
+
+    // Re-reads all links, including IFLA_STATS64 counters, in one dump.
+    bool refreshCounters();
+
+signals:
+    // Links, addresses or the default route changed. Counter updates alone
+    // do not emit this.
+    void interfacesChanged();
+
+private:
+    struct DefaultRoute {
+        int linkIndex = 0;
+        quint32 priority = 0;
+    };
+
+    bool resync();
+    // `changed` is set when a dumped message altered the tables.
+    bool dump(int type, unsigned char family, bool *changed = nullptr);
+    void readEvents();
+    bool handleMessage(nlmsghdr *header);
+    bool handleLink(nlmsghdr *header);
+    bool handleAddress(nlmsghdr *header);
+    bool handleRoute(nlmsghdr *header);
+
+    int m_eventFd = -1;
+    int m_queryFd = -1;
+    quint32 m_sequence = 0;
+    QSocketNotifier *m_notifier = nullptr;
+    std::vector<char> m_buffer;
+    QMap<int, Link> m_links;
+    QVector<Address> m_addresses;
+    QVector<DefaultRoute> m_defaultRoutes;
+};
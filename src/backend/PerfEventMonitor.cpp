@@ -0,0 +1,342 @@
+#include "PerfEventMonitor.h"
+
+#include "MetricScheduler.h"
+#include "SystemHelpers.h"
+
+#include <QDebug>
+#include <QDir>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const char kCollectorName[] = "perf";
+
+// Order matches PerfEventMonitor::Counter; the first one leads the group.
+const quint64 kEventConfigs[] = {
+    PERF_COUNT_SW_CONTEXT_SWITCHES,
+    PERF_COUNT_SW_CPU_MIGRATIONS,
+    PERF_COUNT_SW_PAGE_FAULTS,
+    PERF_COUNT_SW_TASK_CLOCK,
+};
+
+int perfEventOpen(perf_event_attr *attr, int pid, int cpu, int groupFd)
+{
+    return static_cast<int>(::syscall(__NR_perf_event_open, attr, pid, cpu, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+bool isPermissionError(int error)
+{
+    return error == EACCES || error == EPERM;
+}
+
+QString paranoidLevel()
+{
+    const QString level = Backend::readTextFile(Backend::procPath(QStringLiteral("/sys/kernel/perf_event_paranoid")));
+    return level.isEmpty() ? QStringLiteral("?") : level;
+}
+
+} // namespace
+
+PerfEventMonitor::PerfEventMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_enabled = Backend::readEnvironmentValue("ORBITAL_PERF_EVENTS") != QLatin1String("0");
+    if (!m_enabled) {
+        m_scope = Unavailable;
+        m_limitation = QStringLiteral("disabled by ORBITAL_PERF_EVENTS=0");
+    }
+}
+
+PerfEventMonitor::~PerfEventMonitor()
+{
+    close();
+}
+
+void PerfEventMonitor::registerCollector(MetricScheduler *scheduler)
+{
+    scheduler->registerCollector(QString::fromLatin1(kCollectorName), [this]() {
+        sample();
+        emit changed();
+    });
+
+    // Software events put a little work on every context switch they count,
+    // so nothing stays open while no one is looking.
+    connect(scheduler, &MetricScheduler::scheduleChanged, this, [this, scheduler]() {
+        if (scheduler->intervalFor(QString::fromLatin1(kCollectorName)) == 0 && !m_groups.isEmpty()) {
+            close();
+        }
+    });
+}
+
+bool PerfEventMonitor::available() const
+{
+    return m_scope != Unavailable;
+}
+
+QString PerfEventMonitor::scope() const
+{
+    switch (m_scope) {
+    case System:
+        return QStringLiteral("system");
+    case Process:
+        return QStringLiteral("process");
+    case Closed:
+    case Unavailable:
+        break;
+    }
+
+    return {};
+}
+
+QString PerfEventMonitor::limitation() const
+{
+    return m_limitation;
+}
+
+QVariantMap PerfEventMonitor::rates() const
+{
+    return m_rates;
+}
+
+QVariantList PerfEventMonitor::perCpu() const
+{
+    return m_perCpu;
+}
+
+void PerfEventMonitor::sample()
+{
+    if (!open()) {
+        return;
+    }
+
+    if (m_scope == Process) {
+        syncThreads();
+    }
+
+    const double elapsedSec = m_clock.restart();
+    for (Group &group : m_groups) {
+        readGroup(group, elapsedSec);
+    }
+
+    publish(elapsedSec > 0.0);
+}
+
+bool PerfEventMonitor::open()
+{
+    if (m_scope != Closed) {
+        return m_scope != Unavailable;
+    }
+
+    int error = 0;
+    m_userOnly = false;
+    if (Backend::readEnvironmentValue("ORBITAL_PERF_SCOPE") != QLatin1String("process")) {
+        // Offline CPUs fail with ENODEV and are skipped; they are picked up
+        // the next time the collector is activated.
+        const long cpuCount = ::sysconf(_SC_NPROCESSORS_CONF);
+        for (int cpu = 0; cpu < cpuCount; ++cpu) {
+            Group group;
+            group.id = cpu;
+            if (openGroup(group, -1, cpu, error)) {
+                m_groups.append(group);
+            } else if (isPermissionError(error)) {
+                break;
+            }
+        }
+
+        if (isPermissionError(error)) {
+            for (Group &group : m_groups) {
+                closeGroup(group);
+            }
+            m_groups.clear();
+        }
+
+        if (!m_groups.isEmpty()) {
+            m_scope = System;
+            m_limitation.clear();
+            return true;
+        }
+    }
+
+    // Per-thread counting of our own process is allowed up to paranoid 2.
+    m_scope = Process;
+    const int threadError = syncThreads();
+    if (threadError != 0) {
+        error = threadError;
+    }
+
+    if (m_groups.isEmpty()) {
+        m_scope = Unavailable;
+        m_limitation = isPermissionError(error) || error == 0
+            ? QStringLiteral("perf_event_paranoid=%1 forbids perf events").arg(paranoidLevel())
+            : QStringLiteral("perf_event_open: %1").arg(QString::fromLocal8Bit(std::strerror(error)));
+        qWarning() << "Perf events:" << m_limitation;
+        return false;
+    }
+
+    m_limitation = QStringLiteral("perf_event_paranoid=%1: counting Orbital only").arg(paranoidLevel());
+    if (m_userOnly) {
+        m_limitation += QStringLiteral(", user space only (no context switches or migrations)");
+    }
+    return true;
+}
+
+void PerfEventMonitor::close()
+{
+    for (Group &group : m_groups) {
+        closeGroup(group);
+    }
+
+    m_groups.clear();
+    m_clock.invalidate();
+    if (m_scope != Unavailable) {
+        m_scope = Closed;
+    }
+}
+
+bool PerfEventMonitor::openGroup(Group &group, int pid, int cpu, int &error)
+{
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        perf_event_attr attr {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = kEventConfigs[counter];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = m_userOnly ? 1 : 0;
+        attr.exclude_hv = 1;
+
+        const int leader = counter == 0 ? -1 : group.fds[0];
+        group.fds[counter] = perfEventOpen(&attr, pid, cpu, leader);
+
+        // paranoid 2 still allows our own threads if kernel-side counting
+        // is excluded. Context switches and migrations happen entirely in
+        // the kernel, so those two counters then always read zero.
+        if (group.fds[counter] < 0 && errno == EACCES && !m_userOnly && pid >= 0) {
+            closeGroup(group);
+            m_userOnly = true;
+            return openGroup(group, pid, cpu, error);
+        }
+
+        if (group.fds[counter] < 0) {
+            error = errno;
+            closeGroup(group);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PerfEventMonitor::closeGroup(Group &group)
+{
+    for (int &fd : group.fds) {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+int PerfEventMonitor::syncThreads()
+{
+    // Counters do not follow threads created after they were opened, so
+    // new threads get their own group. Counts of an exited thread go with it.
+    const QDir taskDir(QStringLiteral("/proc/self/task"));
+    int error = 0;
+    QVector<int> tids;
+    for (const QString &entry : taskDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        bool ok = false;
+        const int tid = entry.toInt(&ok);
+        if (ok) {
+            tids.append(tid);
+        }
+    }
+
+    for (int i = m_groups.size() - 1; i >= 0; --i) {
+        if (!tids.contains(m_groups.at(i).id)) {
+            closeGroup(m_groups[i]);
+            m_groups.remove(i);
+        }
+    }
+
+    for (const int tid : std::as_const(tids)) {
+        const bool known = std::any_of(m_groups.cbegin(), m_groups.cend(),
+                                       [tid](const Group &group) { return group.id == tid; });
+        if (known) {
+            continue;
+        }
+
+        Group group;
+        group.id = tid;
+        if (openGroup(group, tid, -1, error)) {
+            m_groups.append(group);
+        }
+    }
+
+    return error;
+}
+
+void PerfEventMonitor::readGroup(Group &group, double elapsedSec)
+{
+    // PERF_FORMAT_GROUP: { nr, value[nr] }
+    quint64 values[1 + CounterCount] = {};
+    const ssize_t length = ::read(group.fds[0], values, sizeof(values));
+    group.valid = false;
+    if (length != static_cast<ssize_t>(sizeof(values)) || values[0] != CounterCount) {
+        group.hasPrevious = false;
+        return;
+    }
+
+    group.valid = group.hasPrevious && elapsedSec > 0.0;
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        const quint64 value = values[1 + counter];
+        group.perSecond[counter] = group.valid ? CounterRate::rateOver(value, group.previous[counter], elapsedSec) : 0.0;
+        group.previous[counter] = value;
+    }
+    group.hasPrevious = true;
+}
+
+void PerfEventMonitor::publish(bool hasRates)
+{
+    double totals[CounterCount] = {};
+    QVariantList perCpu;
+    for (const Group &group : std::as_const(m_groups)) {
+        for (int counter = 0; counter < CounterCount; ++counter) {
+            totals[counter] += group.perSecond[counter];
+        }
+
+        if (m_scope == System) {
+            QVariantMap map;
+            map[QStringLiteral("cpu")] = group.id;
+            map[QStringLiteral("contextSwitches")] = group.perSecond[ContextSwitches];
+            map[QStringLiteral("migrations")] = group.perSecond[Migrations];
+            map[QStringLiteral("pageFaults")] = group.perSecond[PageFaults];
+            map[QStringLiteral("clockRatio")] = group.perSecond[TaskClock] / 1e9;
+            perCpu.append(map);
+        }
+    }
+
+    // task-clock counts nanoseconds.
+    const double clockRatio = totals[TaskClock] / 1e9;
+    // Counted without the kernel, these two stay at zero whatever happens.
+    const QString unavailable = QStringLiteral("--");
+
+    QVariantMap rates;
+    rates[QStringLiteral("valid")] = hasRates;
+    rates[QStringLiteral("contextSwitches")] = m_userOnly ? -1.0 : totals[ContextSwitches];
+    rates[QStringLiteral("migrations")] = m_userOnly ? -1.0 : totals[Migrations];
+    rates[QStringLiteral("pageFaults")] = totals[PageFaults];
+    rates[QStringLiteral("clockRatio")] = clockRatio;
+    rates[QStringLiteral("displayContextSwitches")] = m_userOnly ? unavailable : Backend::formatRate(totals[ContextSwitches]);
+    rates[QStringLiteral("displayMigrations")] = m_userOnly ? unavailable : Backend::formatRate(totals[Migrations]);
+    rates[QStringLiteral("displayPageFaults")] = Backend::formatRate(totals[PageFaults]);
+    rates[QStringLiteral("displayClock")] = QStringLiteral("%1 CPU").arg(clockRatio, 0, 'f', 2);
+    m_rates = rates;
+    m_perCpu = perCpu;
+}
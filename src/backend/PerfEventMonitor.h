@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+#include "CounterRate.h"
+
+class MetricScheduler;
+
+// Kernel software counters through perf_event_open(2): context switches,
+// CPU migrations, page faults and task-clock. With CAP_PERFMON or a
+// permissive perf_event_paranoid one event group per CPU counts the whole
+// system; otherwise one group per Orbital thread counts this process only.
+// Each group comes back from a single PERF_FORMAT_GROUP read. The events
+// are open only while the "perf" collector has subscribers.
+class PerfEventMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool available READ available NOTIFY changed)
+    // "system", "process", or empty until the collector first runs.
+    Q_PROPERTY(QString scope READ scope NOTIFY changed)
+    // Why counting is narrowed or impossible; empty when system-wide.
+    Q_PROPERTY(QString limitation READ limitation NOTIFY changed)
+    // { contextSwitches, migrations, pageFaults (per second), clockRatio
+    //   (task-clock seconds per second), valid, display* strings }. A
+    //   CPU-wide task clock runs whenever the CPU is online, so clockRatio is
+    //   Orbital's own CPU use only in process scope. contextSwitches and
+    //   migrations are -1 (displayed "--") when only user space is counted.
+    Q_PROPERTY(QVariantMap rates READ rates NOTIFY changed)
+    // System scope only: { cpu, contextSwitches, migrations, pageFaults,
+    //   clockRatio } per CPU.
+    Q_PROPERTY(QVariantList perCpu READ perCpu NOTIFY changed)
+
+public:
+    explicit PerfEventMonitor(QObject *parent = nullptr);
+    ~PerfEventMonitor() override;
+
+    void registerCollector(MetricScheduler *scheduler);
+
+    bool available() const;
+    QString scope() const;
+    QString limitation() const;
+    QVariantMap rates() const;
+    QVariantList perCpu() const;
+
+signals:
+    void changed();
+
+private:
+    enum Counter {
+        ContextSwitches,
+        Migrations,
+        PageFaults,
+        TaskClock,
+        CounterCount
+    };
+
+    enum Scope {
+        Closed,
+        System,
+        Process,
+        Unavailable
+    };
+
+    struct Group {
+        // CPU number in system scope, thread id in process scope.
+        int id = -1;
+        int fds[CounterCount] = { -1, -1, -1, -1 };
+        quint64 previous[CounterCount] = {};
+        double perSecond[CounterCount] = {};
+        bool hasPrevious = false;
+        bool valid = false;
+    };
+
+    void sample();
+    bool open();
+    void close();
+    bool openGroup(Group &group, int pid, int cpu, int &error);
+    void closeGroup(Group &group);
+    // Returns the errno of the last thread that could not be opened.
+    int syncThreads();
+    void readGroup(Group &group, double elapsedSec);
+    void publish(bool hasRates);
+
+    bool m_enabled = true;
+    Scope m_scope = Closed;
+    bool m_userOnly = false;
+    QVector<Group> m_groups;
+    RateClock m_clock;
+    QString m_limitation;
+    QVariantMap m_rates;
+    QVariantList m_perCpu;
+};
@@ -0,0 +1,285 @@
+#include "PressureMonitor.h"
+
+#include "HistorySeries.h"
+#include "MetricScheduler.h"
+#include "SystemHelpers.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Unprivileged processes may only use windows that are a multiple of 2 s.
+constexpr int kDefaultTriggerStallMs = 300;
+constexpr int kDefaultTriggerWindowMs = 2000;
+// While a stall episode lasts, the alert is repeated at most this often.
+constexpr int kDefaultAlertCooldownMs = 60000;
+
+int environmentMs(const char *name, int fallback)
+{
+    bool ok = false;
+    const int configured = Backend::readEnvironmentValue(name).toInt(&ok);
+    return ok && configured >= 0 ? configured : fallback;
+}
+
+// "some avg10=0.12 avg60=0.05 avg300=0.01 total=123456"
+bool parseStallLine(const QByteArray &line, PressureMonitor::Stall &stall)
+{
+    const QList<QByteArray> fields = line.split(' ');
+    if (fields.size() < 5) {
+        return false;
+    }
+
+    for (int index = 1; index < fields.size(); ++index) {
+        const QByteArray &field = fields.at(index);
+        const int separator = field.indexOf('=');
+        if (separator <= 0) {
+            continue;
+        }
+
+        const QByteArray key = field.left(separator);
+        const QByteArray value = field.mid(separator + 1);
+        if (key == "avg10") {
+            stall.avg10 = value.toDouble();
+        } else if (key == "avg60") {
+            stall.avg60 = value.toDouble();
+        } else if (key == "avg300") {
+            stall.avg300 = value.toDouble();
+        } else if (key == "total") {
+            stall.totalUs = value.toULongLong();
+        }
+    }
+
+    return true;
+}
+
+void insertStall(QVariantMap &map, const QString &prefix, const PressureMonitor::Stall &stall)
+{
+    map[prefix + QStringLiteral("Avg10")] = stall.avg10;
+    map[prefix + QStringLiteral("Avg60")] = stall.avg60;
+    map[prefix + QStringLiteral("Avg300")] = stall.avg300;
+    map[prefix + QStringLiteral("TotalUs")] = static_cast<qulonglong>(stall.totalUs);
+}
+
+} // namespace
+
+PressureMonitor::PressureMonitor(QObject *parent)
+    : QObject(parent)
+{
+    const int stallMs = environmentMs("ORBITAL_PSI_TRIGGER_STALL_MS", kDefaultTriggerStallMs);
+    const int windowMs = environmentMs("ORBITAL_PSI_TRIGGER_WINDOW_MS", kDefaultTriggerWindowMs);
+    m_windowMs = windowMs;
+    m_thresholdPercent = windowMs > 0 ? stallMs * 100.0 / windowMs : 0.0;
+    m_alertCooldownMs = environmentMs("ORBITAL_PSI_ALERT_COOLDOWN_MS", kDefaultAlertCooldownMs);
+    m_clock.start();
+    const QByteArray trigger = QByteArrayLiteral("some ") + QByteArray::number(stallMs * 1000)
+        + ' ' + QByteArray::number(windowMs * 1000);
+
+    const int capacity = Backend::historyCapacity();
+    for (const char *name : { "cpu", "memory", "io" }) {
+        const QByteArray path = Backend::procPath(QStringLiteral("/pressure/")).toLocal8Bit() + name;
+        Source source;
+        source.value.name = QString::fromLatin1(name);
+        source.readFd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+        source.history = new HistorySeries(capacity, this);
+        if (source.readFd < 0) {
+            qWarning().noquote() << "PressureMonitor: PSI unavailable for" << source.value.name
+                                 << "-" << std::strerror(errno);
+        } else if (stallMs > 0) {
+            armTrigger(source, trigger);
+        }
+
+        m_sources.append(source);
+    }
+}
+
+PressureMonitor::~PressureMonitor()
+{
+    for (Source &source : m_sources) {
+        if (source.readFd >= 0) {
+            ::close(source.readFd);
+        }
+
+        if (source.triggerFd >= 0) {
+            ::close(source.triggerFd);
+        }
+    }
+}
+
+void PressureMonitor::registerCollector(MetricScheduler *scheduler)
+{
+    scheduler->registerCollector(QStringLiteral("pressure"), [this]() {
+        if (sample(true)) {
+            emit pressureChanged();
+        }
+    });
+}
+
+bool PressureMonitor::isAvailable() const
+{
+    for (const Source &source : m_sources) {
+        if (source.readFd >= 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QVariantMap PressureMonitor::values() const
+{
+    QVariantMap result;
+    for (const Source &source : m_sources) {
+        if (source.readFd < 0) {
+            continue;
+        }
+
+        QVariantMap map;
+        insertStall(map, QStringLiteral("some"), source.value.some);
+        if (source.value.hasFull) {
+            insertStall(map, QStringLiteral("full"), source.value.full);
+        }
+
+        result[source.value.name] = map;
+    }
+
+    return result;
+}
+
+PressureMonitor::Resource PressureMonitor::resource(const QString &name) const
+{
+    for (const Source &source : m_sources) {
+        if (source.value.name == name) {
+            return source.value;
+        }
+    }
+
+    return {};
+}
+
+HistorySeries *PressureMonitor::cpuHistory() const
+{
+    return m_sources.at(0).history;
+}
+
+HistorySeries *PressureMonitor::memoryHistory() const
+{
+    return m_sources.at(1).history;
+}
+
+HistorySeries *PressureMonitor::ioHistory() const
+{
+    return m_sources.at(2).history;
+}
+
+bool PressureMonitor::sample(bool recordHistory)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool changed = false;
+    for (Source &source : m_sources) {
+        const Resource previous = source.value;
+        if (!readSource(source)) {
+            continue;
+        }
+
+        if (recordHistory) {
+            source.history->append(static_cast<float>(source.value.some.avg10), now);
+
+            // avg10 lags behind the trigger, so it only ends an episode once
+            // the kernel has also stopped firing.
+            if (source.alerting && source.value.some.avg10 < m_thresholdPercent
+                && m_clock.elapsed() - source.lastEventMs > m_windowMs) {
+                source.alerting = false;
+            }
+        }
+
+        changed = changed || !Backend::nearlyEqual(previous.some.avg10, source.value.some.avg10)
+            || !Backend::nearlyEqual(previous.some.avg60, source.value.some.avg60)
+            || !Backend::nearlyEqual(previous.full.avg10, source.value.full.avg10)
+            || previous.some.totalUs != source.value.some.totalUs;
+    }
+
+    return changed;
+}
+
+bool PressureMonitor::readSource(Source &source) const
+{
+    if (source.readFd < 0) {
+        return false;
+    }
+
+    char buffer[256];
+    const ssize_t bytes = ::pread(source.readFd, buffer, sizeof(buffer), 0);
+    if (bytes <= 0) {
+        return false;
+    }
+
+    const QByteArray content(buffer, static_cast<int>(bytes));
+    for (const QByteArray &line : content.split('\n')) {
+        if (line.startsWith("some ")) {
+            parseStallLine(line, source.value.some);
+        } else if (line.startsWith("full ")) {
+            source.value.hasFull = parseStallLine(line, source.value.full);
+        }
+    }
+
+    return true;
+}
+
+void PressureMonitor::armTrigger(Source &source, const QByteArray &trigger)
+{
+    const QByteArray path = Backend::procPath(QStringLiteral("/pressure/") + source.value.name).toLocal8Bit();
+    source.triggerFd = ::open(path.constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    // The trigger string is written including its terminating NUL.
+    if (source.triggerFd < 0 || ::write(source.triggerFd, trigger.constData(), trigger.size() + 1) < 0) {
+        qWarning().noquote() << "PressureMonitor: cannot arm" << source.value.name << "trigger"
+                             << trigger << "-" << std::strerror(errno);
+        if (source.triggerFd >= 0) {
+            ::close(source.triggerFd);
+            source.triggerFd = -1;
+        }
+        return;
+    }
+
+    const QString name = source.value.name;
+    source.notifier = new QSocketNotifier(source.triggerFd, QSocketNotifier::Exception, this);
+    connect(source.notifier, &QSocketNotifier::activated, this, [this, name]() { handleTrigger(name); });
+}
+
+void PressureMonitor::handleTrigger(const QString &name)
+{
+    // Refresh the snapshot without feeding the history, whose cadence
+    // belongs to the collector.
+    if (sample(false)) {
+        emit pressureChanged();
+    }
+
+    for (Source &source : m_sources) {
+        if (source.value.name != name) {
+            continue;
+        }
+
+        const qint64 now = m_clock.elapsed();
+        // No event for two windows means the previous stall has ended.
+        if (source.lastEventMs >= 0 && now - source.lastEventMs > 2 * m_windowMs) {
+            source.alerting = false;
+        }
+        source.lastEventMs = now;
+
+        if (source.alerting && now - source.lastAlertMs < m_alertCooldownMs) {
+            return;
+        }
+
+        source.alerting = true;
+        source.lastAlertMs = now;
+        emit thresholdCrossed(name);
+        return;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+class HistorySeries;
+class MetricScheduler;
+class QSocketNotifier;
+
+// Pressure Stall Information from /proc/pressure/{cpu,memory,io}. Values are
+// sampled by the "pressure" collector; independently of that, a PSI trigger
+// is armed on each resource so the kernel wakes us (POLLPRI) as soon as the
+// stall time within a window crosses the configured threshold.
+class PressureMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stall {
+        double avg10 = 0.0;
+        double avg60 = 0.0;
+        double avg300 = 0.0;
+        quint64 totalUs = 0;
+    };
+
+    struct Resource {
+        QString name;
+        Stall some;
+        Stall full;
+        bool hasFull = false;
+    };
+
+    explicit PressureMonitor(QObject *parent = nullptr);
+    ~PressureMonitor() override;
+
+    void registerCollector(MetricScheduler *scheduler);
+
+    bool isAvailable() const;
+    // { cpu: { someAvg10, someAvg60, someAvg300, someTotalUs, full... }, memory: ..., io: ... }
+    QVariantMap values() const;
+    Resource resource(const QString &name) const;
+
+    // "some avg10" per resource, in percent.
+    HistorySeries *cpuHistory() const;
+    HistorySeries *memoryHistory() const;
+    HistorySeries *ioHistory() const;
+
+signals:
+    void pressureChanged();
+    void thresholdCrossed(const QString &resource);
+
+private:
+    struct Source {
+        Resource value;
+        int readFd = -1;
+        int triggerFd = -1;
+        QSocketNotifier *notifier = nullptr;
+        HistorySeries *history = nullptr;
+        // The kernel re-fires a trigger once per window for as long as the
+        // stall lasts; only the first event of an episode is reported.
+        bool alerting = false;
+        qint64 lastEventMs = -1;
+        qint64 lastAlertMs = -1;
+    };
+
+    bool sample(bool recordHistory);
+    bool readSource(Source &source) const;
+    void armTrigger(Source &source, const QByteArray &trigger);
+    void handleTrigger(const QString &name);
+
+    QVector<Source> m_sources;
+    QElapsedTimer m_clock;
+    int m_windowMs = 0;
+    double m_thresholdPercent = 0.0;
+    int m_alertCooldownMs = 0;
+};
@@ -0,0 +1,167 @@
+#include "ProcConnector.h"
+
+#include "SystemHelpers.h"
+
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kMessageBufferSize = 8192;
+// Fork storms can queue a lot of events between two reads.
+constexpr int kReceiveBufferBytes = 1024 * 1024;
+
+} // namespace
+
+ProcConnector::ProcConnector(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ProcConnector::~ProcConnector()
+{
+    stop();
+}
+
+bool ProcConnector::start()
+{
+    if (m_fd >= 0) {
+        return true;
+    }
+
+    if (Backend::readEnvironmentValue("ORBITAL_PROC_CONNECTOR") == QLatin1String("0")) {
+        return false;
+    }
+
+    m_fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+    if (m_fd < 0) {
+        qWarning() << "ProcConnector: cannot open connector socket:" << std::strerror(errno);
+        return false;
+    }
+
+    const int bufferBytes = kReceiveBufferBytes;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+
+    sockaddr_nl address {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (::bind(m_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || !setListening(true)) {
+        // EPERM without CAP_NET_ADMIN is the common case, not worth a warning.
+        if (errno != EPERM) {
+            qWarning() << "ProcConnector: cannot subscribe to process events:" << std::strerror(errno);
+        }
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &ProcConnector::readEvents);
+    return true;
+}
+
+void ProcConnector::stop()
+{
+    if (m_fd < 0) {
+        return;
+    }
+
+    setListening(false);
+    delete m_notifier;
+    m_notifier = nullptr;
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+bool ProcConnector::isRunning() const
+{
+    return m_fd >= 0;
+}
+
+bool ProcConnector::setListening(bool listen)
+{
+    constexpr size_t kPayload = sizeof(cn_msg) + sizeof(proc_cn_mcast_op);
+    alignas(nlmsghdr) char buffer[NLMSG_SPACE(kPayload)] = {};
+
+    auto *header = reinterpret_cast<nlmsghdr *>(buffer);
+    header->nlmsg_len = NLMSG_LENGTH(kPayload);
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = static_cast<__u32>(::getpid());
+
+    auto *message = static_cast<cn_msg *>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(proc_cn_mcast_op);
+
+    const proc_cn_mcast_op op = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+    std::memcpy(message->data, &op, sizeof(op));
+
+    return ::send(m_fd, buffer, header->nlmsg_len, 0) >= 0;
+}
+
+void ProcConnector::readEvents()
+{
+    alignas(nlmsghdr) char buffer[kMessageBufferSize];
+    while (true) {
+        const ssize_t received = ::recv(m_fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received < 0) {
+            if (errno == ENOBUFS) {
+                emit overflowed();
+                continue;
+            }
+            break;
+        }
+
+        if (received == 0) {
+            break;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(buffer); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_OVERRUN) {
+                emit overflowed();
+                continue;
+            }
+
+            if (header->nlmsg_len < NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_event))) {
+                continue;
+            }
+
+            const auto *message = static_cast<const cn_msg *>(NLMSG_DATA(header));
+            proc_event event;
+            std::memcpy(&event, message->data, sizeof(event));
+
+            switch (event.what) {
+            case proc_event::PROC_EVENT_FORK:
+                if (event.event_data.fork.child_pid == event.event_data.fork.child_tgid) {
+                    emit processStarted(event.event_data.fork.child_tgid);
+                }
+                break;
+            case proc_event::PROC_EVENT_EXEC:
+                emit processExecuted(event.event_data.exec.process_tgid);
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                if (event.event_data.exit.process_pid == event.event_data.exit.process_tgid) {
+                    emit processExited(event.event_data.exit.process_tgid);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
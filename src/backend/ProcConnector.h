@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// Process lifecycle events from the netlink proc connector
+// (NETLINK_CONNECTOR, CN_IDX_PROC). Only thread-group leaders are reported,
+// so thread churn inside a process is ignored. Subscribing needs
+// CAP_NET_ADMIN; start() returns false without it and callers keep scanning
+// /proc instead. ORBITAL_PROC_CONNECTOR=0 disables the listener entirely.
+class ProcConnector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProcConnector(QObject *parent = nullptr);
+    ~ProcConnector() override;
+
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+signals:
+    void processStarted(int pid);
+    void processExecuted(int pid);
+    void processExited(int pid);
+    // Events were dropped; the consumer has to resynchronise from /proc.
+    void overflowed();
+
+private:
+    bool setListening(bool listen);
+    void readEvents();
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+};
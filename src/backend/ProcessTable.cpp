@@ -0,0 +1,448 @@
+#include "ProcessTable.h"
+
+#include "SystemHelpers.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+// Cached stat fds may use a quarter of the current soft descriptor limit,
+// and never more than this, so descriptor numbers stay clear of FD_SETSIZE
+// for code that still uses select(). Tasks beyond that are opened per read.
+constexpr rlim_t kMaxCachedFds = 512;
+
+// /proc/<pid>/stat is well below this; comm is at most 16 bytes
+// (TASK_COMM_LEN).
+constexpr int kStatBufferSize = 1024;
+// /proc/<pid>/status grows with the CPU and NUMA masks near its end.
+constexpr int kStatusBufferSize = 8192;
+
+int cachedFdBudget()
+{
+    // The limit is read, not raised: RLIMIT_NOFILE is process-wide and
+    // inherited by the terminal shell and every QProcess child.
+    rlimit limit {};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return 0;
+    }
+
+    return static_cast<int>(std::min<rlim_t>(limit.rlim_cur / 4, kMaxCachedFds));
+}
+
+bool parsePid(const char *name, int &pid)
+{
+    if (*name == '\0') {
+        return false;
+    }
+
+    int value = 0;
+    for (const char *cursor = name; *cursor; ++cursor) {
+        if (*cursor < '0' || *cursor > '9') {
+            return false;
+        }
+        value = value * 10 + (*cursor - '0');
+    }
+
+    pid = value;
+    return true;
+}
+
+qint64 parseNumber(const char *begin, const char *end)
+{
+    bool negative = false;
+    if (begin < end && *begin == '-') {
+        negative = true;
+        ++begin;
+    }
+
+    qint64 value = 0;
+    for (; begin < end && *begin >= '0' && *begin <= '9'; ++begin) {
+        value = value * 10 + (*begin - '0');
+    }
+
+    return negative ? -value : value;
+}
+
+// Value after `key` (which includes the leading newline), 0 if absent.
+quint64 keyedValue(const char *data, int size, const char *key)
+{
+    const size_t keyLength = std::strlen(key);
+    const char *match = static_cast<const char *>(::memmem(data, size, key, keyLength));
+    if (!match) {
+        return 0;
+    }
+
+    const char *end = data + size;
+    const char *cursor = match + keyLength;
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+        ++cursor;
+    }
+
+    return static_cast<quint64>(parseNumber(cursor, end));
+}
+
+int readFile(const QByteArray &path, char *buffer, int size)
+{
+    const int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    const ssize_t length = ::pread(fd, buffer, size, 0);
+    ::close(fd);
+    return static_cast<int>(length);
+}
+
+struct StatFields {
+    const char *name = nullptr;
+    int nameLength = 0;
+    char state = 0;
+    quint64 utime = 0;
+    quint64 stime = 0;
+    quint64 startTime = 0;
+    qint64 rssPages = 0;
+};
+
+// Field numbers below count from the state field, i.e. stat(5) field - 3.
+bool parseStatLine(const char *data, int size, StatFields &fields)
+{
+    const char *end = data + size;
+    // The command name may itself contain ')' or spaces, hence the last ')'.
+    const char *open = static_cast<const char *>(std::memchr(data, '(', size));
+    const char *close = static_cast<const char *>(::memrchr(data, ')', size));
+    if (!open || !close || close <= open) {
+        return false;
+    }
+
+    fields.name = open + 1;
+    fields.nameLength = static_cast<int>(close - open - 1);
+
+    int field = 0;
+    const char *cursor = close + 1;
+    while (cursor < end && field <= 21) {
+        while (cursor < end && *cursor == ' ') {
+            ++cursor;
+        }
+
+        const char *token = cursor;
+        while (cursor < end && *cursor != ' ' && *cursor != '\n') {
+            ++cursor;
+        }
+
+        if (token == cursor) {
+            break;
+        }
+
+        switch (field) {
+        case 0:
+            fields.state = *token;
+            break;
+        case 11:
+            fields.utime = static_cast<quint64>(parseNumber(token, cursor));
+            break;
+        case 12:
+            fields.stime = static_cast<quint64>(parseNumber(token, cursor));
+            break;
+        case 19:
+            fields.startTime = static_cast<quint64>(parseNumber(token, cursor));
+            break;
+        case 21:
+            fields.rssPages = parseNumber(token, cursor);
+            break;
+        default:
+            break;
+        }
+
+        ++field;
+    }
+
+    return field > 21;
+}
+
+} // namespace
+
+ProcessTable::ProcessTable()
+    : m_root(QFile::encodeName(Backend::procRoot()))
+    , m_maxCachedFds(cachedFdBudget())
+{
+}
+
+ProcessTable::~ProcessTable()
+{
+    clear();
+}
+
+void ProcessTable::refresh()
+{
+    if (m_incremental && !m_needsScan) {
+        rereadKnown();
+    } else {
+        scan();
+    }
+}
+
+void ProcessTable::scan()
+{
+    DIR *dir = ::opendir(m_root.constData());
+    if (!dir) {
+        return;
+    }
+
+    ++m_generation;
+    m_needsScan = false;
+    QByteArray statPath;
+    while (const dirent *entry = ::readdir(dir)) {
+        int pid = 0;
+        if (!parsePid(entry->d_name, pid)) {
+            continue;
+        }
+
+        Process &process = m_processes[pid];
+        process.pid = pid;
+        statPath = m_root + '/' + entry->d_name + "/stat";
+        if (!readStat(process, statPath)) {
+            closeFd(process);
+            m_processes.erase(pid);
+            continue;
+        }
+
+        readCounters(process);
+    }
+    ::closedir(dir);
+
+    for (auto it = m_processes.begin(); it != m_processes.end();) {
+        if (it->second.generation != m_generation) {
+            closeFd(it->second);
+            it = m_processes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ProcessTable::rereadKnown()
+{
+    ++m_generation;
+    for (auto it = m_processes.begin(); it != m_processes.end();) {
+        if (!readStat(it->second, statPath(it->first))) {
+            closeFd(it->second);
+            it = m_processes.erase(it);
+        } else {
+            readCounters(it->second);
+            ++it;
+        }
+    }
+}
+
+void ProcessTable::clear()
+{
+    for (auto &entry : m_processes) {
+        closeFd(entry.second);
+    }
+
+    m_processes.clear();
+    m_needsScan = true;
+}
+
+void ProcessTable::setCounters(Counters counters)
+{
+    if (counters == m_counters) {
+        return;
+    }
+
+    m_counters = counters;
+    for (auto &entry : m_processes) {
+        entry.second.countersValid = false;
+        entry.second.hasPreviousCounters = false;
+    }
+}
+
+ProcessTable::Counters ProcessTable::counters() const
+{
+    return m_counters;
+}
+
+void ProcessTable::setIncremental(bool incremental)
+{
+    if (incremental && !m_incremental) {
+        // Tasks that started before the events were flowing are only found
+        // by listing /proc once more.
+        m_needsScan = true;
+    }
+
+    m_incremental = incremental;
+}
+
+bool ProcessTable::isIncremental() const
+{
+    return m_incremental;
+}
+
+void ProcessTable::requestRescan()
+{
+    m_needsScan = true;
+}
+
+void ProcessTable::track(int pid)
+{
+    Process &process = m_processes[pid];
+    process.pid = pid;
+    if (!readStat(process, statPath(pid), ReadMode::Event)) {
+        closeFd(process);
+        m_processes.erase(pid);
+    }
+}
+
+bool ProcessTable::take(int pid, Process &process)
+{
+    const auto it = m_processes.find(pid);
+    if (it == m_processes.end()) {
+        return false;
+    }
+
+    process = it->second;
+    m_processes.erase(it);
+
+    // An exited task stays readable until its parent reaps it; if that
+    // already happened the values from the last read are what we have.
+    const quint64 startTime = process.startTime;
+    Process last = process;
+    if (readStat(last, statPath(pid)) && last.startTime == startTime) {
+        process.cpuTime = last.cpuTime;
+        process.rssPages = last.rssPages;
+        process.name = last.name;
+    }
+
+    // Both copies refer to the same fd; readStat() may have closed it.
+    process.fd = last.fd;
+    closeFd(process);
+    return true;
+}
+
+const std::unordered_map<int, ProcessTable::Process> &ProcessTable::processes() const
+{
+    return m_processes;
+}
+
+QByteArray ProcessTable::statPath(int pid) const
+{
+    return m_root + '/' + QByteArray::number(pid) + "/stat";
+}
+
+void ProcessTable::readCounters(Process &process)
+{
+    if (m_counters == Counters::None) {
+        return;
+    }
+
+    // Both files need ptrace access; other users' tasks simply have none.
+    char buffer[kStatusBufferSize];
+    const QByteArray directory = m_root + '/' + QByteArray::number(process.pid);
+    const bool io = m_counters == Counters::Io;
+    const int length = readFile(directory + (io ? "/io" : "/status"), buffer, sizeof(buffer));
+    if (length <= 0) {
+        process.countersValid = false;
+        process.hasPreviousCounters = false;
+        return;
+    }
+
+    process.hasPreviousCounters = process.countersValid;
+    process.countersValid = true;
+    if (io) {
+        process.previousReadBytes = process.readBytes;
+        process.previousWriteBytes = process.writeBytes;
+        process.readBytes = keyedValue(buffer, length, "\nread_bytes:");
+        process.writeBytes = keyedValue(buffer, length, "\nwrite_bytes:");
+    } else {
+        process.previousVoluntarySwitches = process.voluntarySwitches;
+        process.previousInvoluntarySwitches = process.involuntarySwitches;
+        process.voluntarySwitches = keyedValue(buffer, length, "\nvoluntary_ctxt_switches:");
+        process.involuntarySwitches = keyedValue(buffer, length, "\nnonvoluntary_ctxt_switches:");
+    }
+}
+
+bool ProcessTable::readStat(Process &process, const QByteArray &statPath, ReadMode mode)
+{
+    char buffer[kStatBufferSize];
+    ssize_t length = -1;
+
+    // A cached fd of an exited task fails with ESRCH; if the pid has been
+    // reused since, the fresh open below picks up the new task.
+    if (process.fd >= 0) {
+        length = ::pread(process.fd, buffer, sizeof(buffer), 0);
+        if (length <= 0) {
+            closeFd(process);
+        }
+    }
+
+    if (process.fd < 0) {
+        const int fd = ::open(statPath.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        length = ::pread(fd, buffer, sizeof(buffer), 0);
+        if (m_cachedFds < m_maxCachedFds && length > 0) {
+            process.fd = fd;
+            ++m_cachedFds;
+        } else {
+            ::close(fd);
+        }
+    }
+
+    StatFields fields;
+    if (length <= 0 || !parseStatLine(buffer, static_cast<int>(length), fields)) {
+        return false;
+    }
+
+    const bool known = process.generation != 0 && process.startTime == fields.startTime;
+    if (!known || process.rawName.size() != fields.nameLength
+        || std::memcmp(process.rawName.constData(), fields.name, fields.nameLength) != 0) {
+        process.rawName = QByteArray(fields.name, fields.nameLength);
+        process.name = QString::fromUtf8(process.rawName);
+    }
+
+    // An event-driven read between two samples must not move the baseline
+    // the next CPU delta is computed from.
+    if (mode == ReadMode::Sample || !known) {
+        process.previousCpuTime = process.cpuTime;
+        process.hasPrevious = known && mode == ReadMode::Sample;
+        process.cpuTime = fields.utime + fields.stime;
+    }
+
+    if (mode == ReadMode::Sample) {
+        process.sampled = true;
+    } else if (!known) {
+        process.sampled = false;
+    }
+
+    if (!known) {
+        process.countersValid = false;
+        process.hasPreviousCounters = false;
+    }
+
+    process.state = fields.state;
+    process.rssPages = fields.rssPages;
+    process.startTime = fields.startTime;
+    process.generation = m_generation;
+    return true;
+}
+
+void ProcessTable::closeFd(Process &process)
+{
+    if (process.fd < 0) {
+        return;
+    }
+
+    ::close(process.fd);
+    process.fd = -1;
+    --m_cachedFds;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include <unordered_map>
+
+// Persistent view of /proc/<pid>/stat for every task. Entries survive
+// between refreshes: a pid that still exists keeps its open stat fd and is
+// re-read with a single pread, and the previous CPU time stays next to the
+// current one so callers can compute deltas without a side table. Stat lines
+// are parsed in place; the command name is only converted to a QString when
+// it changes.
+//
+// In incremental mode the caller reports forks, execs and exits (see
+// ProcConnector) and refresh() only re-reads the tasks it already knows,
+// skipping the /proc listing. requestRescan() falls back to one full listing,
+// e.g. after lost events.
+//
+// /proc/<pid>/io and /proc/<pid>/status are only read for the counter set
+// chosen with setCounters(), so ranking by CPU or RSS costs one pread per task.
+class ProcessTable
+{
+public:
+    enum class Counters { None, Io, ContextSwitches };
+
+    struct Process {
+        int pid = 0;
+        QString name;
+        char state = 0;
+        quint64 cpuTime = 0;
+        // Valid only when hasPrevious is set.
+        quint64 previousCpuTime = 0;
+        bool hasPrevious = false;
+        qint64 rssPages = 0;
+        quint64 startTime = 0;
+        // False until a refresh() has read the task; an exit before that
+        // means no sample ever saw it.
+        bool sampled = false;
+
+        // Filled for the current Counters only; previous* are valid when
+        // hasPreviousCounters is set.
+        quint64 readBytes = 0;
+        quint64 writeBytes = 0;
+        quint64 voluntarySwitches = 0;
+        quint64 involuntarySwitches = 0;
+        quint64 previousReadBytes = 0;
+        quint64 previousWriteBytes = 0;
+        quint64 previousVoluntarySwitches = 0;
+        quint64 previousInvoluntarySwitches = 0;
+        bool countersValid = false;
+        bool hasPreviousCounters = false;
+
+        int fd = -1;
+        QByteArray rawName;
+        quint64 generation = 0;
+    };
+
+    ProcessTable();
+    ~ProcessTable();
+
+    ProcessTable(const ProcessTable &) = delete;
+    ProcessTable &operator=(const ProcessTable &) = delete;
+
+    // Lists the proc root and re-reads every task; exited tasks are dropped.
+    void refresh();
+    // Forgets all tasks and closes their fds.
+    void clear();
+
+    void setCounters(Counters counters);
+    Counters counters() const;
+
+    void setIncremental(bool incremental);
+    bool isIncremental() const;
+    void requestRescan();
+    // Reads a forked or exec'd task right away. CPU deltas of known tasks
+    // are left to the next refresh().
+    void track(int pid);
+    // Removes an exited task and hands back its final stat values. Returns
+    // false if the task was never tracked.
+    bool take(int pid, Process &process);
+
+    const std::unordered_map<int, Process> &processes() const;
+
+private:
+    enum class ReadMode { Sample, Event };
+
+    void scan();
+    void rereadKnown();
+    QByteArray statPath(int pid) const;
+    void readCounters(Process &process);
+    bool readStat(Process &process, const QByteArray &statPath, ReadMode mode = ReadMode::Sample);
+    void closeFd(Process &process);
+
+    QByteArray m_root;
+    std::unordered_map<int, Process> m_processes;
+    quint64 m_generation = 0;
+    int m_cachedFds = 0;
+    int m_maxCachedFds = 0;
+    Counters m_counters = Counters::None;
+    bool m_incremental = false;
+    bool m_needsScan = true;
+};
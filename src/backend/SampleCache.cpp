@@ -0,0 +1,66 @@
+#include "SampleCache.h"
+
+#include "MetricScheduler.h"
+#include "NetlinkMonitor.h"
+
+#include <QFile>
+
+SampleCache::SampleCache(NetlinkMonitor *netlink, QObject *parent)
+    : QObject(parent)
+    , m_netlink(netlink)
+{
+}
+
+void SampleCache::attach(MetricScheduler *scheduler)
+{
+    connect(scheduler, &MetricScheduler::tickStarted, this, &SampleCache::begin);
+    connect(scheduler, &MetricScheduler::tickFinished, this, &SampleCache::end);
+}
+
+QByteArray SampleCache::read(const QString &path)
+{
+    if (m_inTick) {
+        const auto it = m_files.constFind(path);
+        if (it != m_files.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // procfs reports a size of 0, so readAll() is the only reliable way.
+    QByteArray content;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        content = file.readAll();
+    }
+
+    if (m_inTick) {
+        m_files.insert(path, content);
+    }
+
+    return content;
+}
+
+bool SampleCache::refreshNetCounters()
+{
+    if (m_inTick && m_countersRefreshed) {
+        return m_countersValid;
+    }
+
+    m_countersValid = m_netlink->refreshCounters();
+    m_countersRefreshed = m_inTick;
+    return m_countersValid;
+}
+
+void SampleCache::begin()
+{
+    m_inTick = true;
+    m_files.clear();
+    m_countersRefreshed = false;
+}
+
+void SampleCache::end()
+{
+    m_inTick = false;
+    m_files.clear();
+    m_countersRefreshed = false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class MetricScheduler;
+class NetlinkMonitor;
+
+// Per-tick cache of kernel sources shared by all collectors. While a
+// scheduler tick is running, each file is read once and every later reader
+// in the same tick gets the same bytes; the same holds for the netlink
+// counter dump. Outside a tick (refreshNow(), uevent handlers) nothing is
+// cached and every call reads fresh data.
+class SampleCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SampleCache(NetlinkMonitor *netlink, QObject *parent = nullptr);
+
+    void attach(MetricScheduler *scheduler);
+
+    // Whole file contents, empty if it cannot be read.
+    QByteArray read(const QString &path);
+    // NetlinkMonitor::refreshCounters(), at most once per tick.
+    bool refreshNetCounters();
+
+private:
+    void begin();
+    void end();
+
+    NetlinkMonitor *m_netlink = nullptr;
+    bool m_inTick = false;
+    QHash<QString, QByteArray> m_files;
+    bool m_countersRefreshed = false;
+    bool m_countersValid = false;
+};
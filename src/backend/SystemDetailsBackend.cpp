@@ -1,24 +1,27 @@
 #include "SystemDetailsBackend.h"
 
+#include "MetricScheduler.h"
+#include "NetlinkMonitor.h"
+#include "ProcConnector.h"
+#include "SampleCache.h"
 #include "SystemHelpers.h"
+#include "UeventMonitor.h"
 
 #include <QDir>
-#include <QFile>
-#include <QNetworkAddressEntry>
-#include <QNetworkInterface>
-#include <QRegularExpression>
-#include <QTextStream>
+#include <QHostAddress>
 #include <QTimer>
 
 #include <algorithm>
 #include <cmath>
 
+#include <time.h>
 #include <unistd.h>
 
 namespace {
 
 constexpr int kRefreshIntervalMs = 2000;
 constexpr int kTopProcessLimit = 10;
+constexpr int kRecentExitLimit = 8;
 
 struct CpuFrequencySample
 {
@@ -36,29 +39,23 @@ struct RankedProcess
     double cpuPercent = 0.0;
     double memPercent = 0.0;
     qint64 rssBytes = 0;
+    double readRate = 0.0;
+    double writeRate = 0.0;
+    double switchRate = 0.0;
+    double rankValue = 0.0;
 };
 
-struct ThermalSample
+ProcessTable::Counters countersForSortKey(const QString &key)
 {
-    QString key;
-    QString name;
-    double tempC = 0.0;
-    QString color;
-};
-
-bool numericName(const QString &text)
-{
-    if (text.isEmpty()) {
-        return false;
+    if (key == QLatin1String("read") || key == QLatin1String("write")) {
+        return ProcessTable::Counters::Io;
     }
 
-    for (const QChar ch : text) {
-        if (!ch.isDigit()) {
-            return false;
-        }
+    if (key == QLatin1String("switches")) {
+        return ProcessTable::Counters::ContextSwitches;
     }
 
-    return true;
+    return ProcessTable::Counters::None;
 }
 
 QString formatUptimeString(double seconds)
@@ -110,46 +107,34 @@ QString cpuFrequencyColor(double ratio, bool online)
     return QStringLiteral("#42A5F5");
 }
 
-QString thermalColorForName(const QString &name)
-{
-    const QString lower = name.toLower();
-    if (lower.contains(QStringLiteral("cpu"))) {
-        return QStringLiteral("#7FB59A");
-    }
-
-    if (lower.contains(QStringLiteral("gpu"))) {
-        return QStringLiteral("#A893CC");
-    }
-
-    if (lower.contains(QStringLiteral("mem")) || lower.contains(QStringLiteral("ebi"))) {
-        return QStringLiteral("#7FAACC");
-    }
-
-    if (lower.contains(QStringLiteral("wlan")) || lower.contains(QStringLiteral("modem"))
-        || lower.contains(QStringLiteral("q6"))) {
-        return QStringLiteral("#7FB7B5");
-    }
-
-    if (lower.contains(QStringLiteral("camera")) || lower.contains(QStringLiteral("video"))) {
-        return QStringLiteral("#C7A784");
-    }
-
-    if (lower.contains(QStringLiteral("charger")) || lower.contains(QStringLiteral("battery"))
-        || lower.contains(QStringLiteral("pm"))) {
-        return QStringLiteral("#CBB07E");
-    }
-
-    return QStringLiteral("#B9A98E");
-}
-
 } // namespace
 
-SystemDetailsBackend::SystemDetailsBackend(QObject *parent)
+SystemDetailsBackend::SystemDetailsBackend(MetricScheduler *scheduler, NetlinkMonitor *netlink,
+                                           UeventMonitor *uevent, SampleCache *cache, QObject *parent)
     : QObject(parent)
-    , m_timer(new QTimer(this))
+    , m_scheduler(scheduler)
+    , m_netlink(netlink)
+    , m_cache(cache)
+    , m_procConnector(new ProcConnector(this))
 {
-    m_timer->setInterval(kRefreshIntervalMs);
-    connect(m_timer, &QTimer::timeout, this, &SystemDetailsBackend::refresh);
+    m_scheduler->registerCollector(QStringLiteral("details"), [this]() { refresh(); });
+
+    auto track = [this](int pid) {
+        if (m_processTable.isIncremental()) {
+            m_processTable.track(pid);
+        }
+    };
+    connect(m_procConnector, &ProcConnector::processStarted, this, track);
+    connect(m_procConnector, &ProcConnector::processExecuted, this, track);
+    connect(m_procConnector, &ProcConnector::processExited, this, &SystemDetailsBackend::handleProcessExit);
+    connect(m_procConnector, &ProcConnector::overflowed, this, [this]() { m_processTable.requestRescan(); });
+
+    // The sensor set only changes with hotplug or driver (un)binding.
+    connect(uevent, &UeventMonitor::eventReceived, this, [this](const UeventMonitor::Event &event) {
+        if (event.subsystem == QLatin1String("hwmon") || event.subsystem == QLatin1String("thermal")) {
+            m_thermalTable.invalidate();
+        }
+    });
 
     const long pageSize = ::sysconf(_SC_PAGESIZE);
     if (pageSize > 0) {
@@ -170,16 +155,22 @@ void SystemDetailsBackend::setActive(bool active)
 
     m_active = active;
     if (m_active) {
+        // The scheduler samples the collector right away; the early second
+        // pass gives the rate-based sections something to show quickly.
+        // Without the proc connector every pass lists /proc instead.
+        m_processTable.setIncremental(m_procConnector->start());
         resetSamplingState();
-        refresh();
-        m_timer->start();
+        m_subscription = m_scheduler->subscribe({ QStringLiteral("details") }, kRefreshIntervalMs);
         QTimer::singleShot(350, this, [this]() {
             if (m_active) {
                 refresh();
             }
         });
     } else {
-        m_timer->stop();
+        m_scheduler->unsubscribe(m_subscription);
+        m_subscription = 0;
+        m_procConnector->stop();
+        m_processTable.setIncremental(false);
     }
 
     emit activeChanged();
@@ -210,11 +201,48 @@ QVariantList SystemDetailsBackend::cpuFrequencies() const
     return m_cpuFrequencies;
 }
 
+QVariantList SystemDetailsBackend::cpuPolicies() const
+{
+    return m_cpuPolicies;
+}
+
 QVariantList SystemDetailsBackend::topProcesses() const
 {
     return m_topProcesses;
 }
 
+QString SystemDetailsBackend::processSortKey() const
+{
+    return m_processSortKey;
+}
+
+void SystemDetailsBackend::setProcessSortKey(const QString &key)
+{
+    if (key == m_processSortKey) {
+        return;
+    }
+
+    m_processSortKey = key;
+    m_processTable.setCounters(countersForSortKey(key));
+    emit processSortKeyChanged();
+
+    // Rates for a newly selected counter need a baseline first, so take it
+    // now instead of showing zeros for a whole interval.
+    if (m_active) {
+        refresh();
+        QTimer::singleShot(350, this, [this]() {
+            if (m_active) {
+                refresh();
+            }
+        });
+    }
+}
+
+QVariantList SystemDetailsBackend::recentExits() const
+{
+    return m_recentExits;
+}
+
 QVariantList SystemDetailsBackend::thermalSensors() const
 {
     return m_thermalSensors;
@@ -247,6 +275,12 @@ void SystemDetailsBackend::refreshNow()
 
 void SystemDetailsBackend::refresh()
 {
+    // Other subscribers may run this collector faster than kRefreshIntervalMs,
+    // so rates use the time actually elapsed since the previous pass.
+    // The interval is 0 on the first pass and after a suspend; rates are
+    // then left alone and only the baselines move.
+    m_sampleIntervalSec = m_sampleClock.restart();
+
     readOverview();
     readMemoryDetails();
     readNetworkSpeeds();
@@ -260,26 +294,58 @@ void SystemDetailsBackend::refresh()
 
 void SystemDetailsBackend::resetSamplingState()
 {
-    m_prevProcessCpuTimes.clear();
+    m_processTable.clear();
+    m_cpuFreqTable.resetResidency();
     m_prevTotalCpuTime = 0;
-    m_prevNetCounters.clear();
-    m_prevDiskIoCounters.clear();
+    m_netRates.clear();
+    m_diskStatsTable.clear();
+    m_sampleClock.invalidate();
     m_topProcesses.clear();
+    m_recentExits.clear();
     m_thermalSensors.clear();
     m_networkSpeeds.clear();
     m_memoryDetails.clear();
     m_diskIoSpeeds.clear();
 }
 
+void SystemDetailsBackend::handleProcessExit(int pid)
+{
+    ProcessTable::Process process;
+    if (!m_processTable.take(pid, process) || process.sampled) {
+        return;
+    }
+
+    static const long clockTicks = std::max(1L, ::sysconf(_SC_CLK_TCK));
+    timespec now {};
+    ::clock_gettime(CLOCK_BOOTTIME, &now);
+    const double startedSec = static_cast<double>(process.startTime) / clockTicks;
+    const double lifetimeSec = std::max(0.0, now.tv_sec + now.tv_nsec / 1e9 - startedSec);
+    const double cpuMs = static_cast<double>(process.cpuTime) * 1000.0 / clockTicks;
+
+    QVariantMap map;
+    map[QStringLiteral("pid")] = process.pid;
+    map[QStringLiteral("name")] = process.name.isEmpty() ? QStringLiteral("unknown") : process.name;
+    map[QStringLiteral("lifetimeMs")] = lifetimeSec * 1000.0;
+    map[QStringLiteral("displayLifetime")] = lifetimeSec >= 1.0
+                                                 ? QStringLiteral("%1 s").arg(QString::number(lifetimeSec, 'f', 1))
+                                                 : QStringLiteral("%1 ms").arg(qRound(lifetimeSec * 1000.0));
+    map[QStringLiteral("displayCpu")] = QStringLiteral("%1 ms").arg(qRound(cpuMs));
+
+    m_recentExits.prepend(map);
+    while (m_recentExits.size() > kRecentExitLimit) {
+        m_recentExits.removeLast();
+    }
+}
+
 void SystemDetailsBackend::readOverview()
 {
-    QString nextHostname = Backend::readTextFile(QStringLiteral("/proc/sys/kernel/hostname"));
+    QString nextHostname = Backend::readTextFile(Backend::procPath(QStringLiteral("/sys/kernel/hostname")));
     if (nextHostname.isEmpty()) {
         nextHostname = QStringLiteral("Unknown");
     }
     m_hostname = nextHostname;
 
-    const QString uptimeRaw = Backend::readTextFile(QStringLiteral("/proc/uptime"));
+    const QString uptimeRaw = Backend::readTextFile(Backend::procPath(QStringLiteral("/uptime")));
     const QStringList uptimeParts = uptimeRaw.split(QLatin1Char(' '), Qt::SkipEmptyParts);
     if (!uptimeParts.isEmpty()) {
         m_uptime = formatUptimeString(uptimeParts.first().toDouble());
@@ -287,38 +353,17 @@ void SystemDetailsBackend::readOverview()
         m_uptime = QStringLiteral("--");
     }
 
-    // Find the default route interface from /proc/net/route
-    QString defaultRouteIface;
-    QFile routeFile(QStringLiteral("/proc/net/route"));
-    if (routeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream stream(&routeFile);
-        stream.readLine(); // skip header
-        while (!stream.atEnd()) {
-            const QString line = stream.readLine();
-            const QStringList fields = line.split(QLatin1Char('\t'), Qt::SkipEmptyParts);
-            // fields[1] is destination, fields[3] is flags; destination 00000000 = default route
-            if (fields.size() >= 4 && fields[1] == QLatin1String("00000000")) {
-                const bool hasGateway = fields[3].toUInt(nullptr, 16) & 0x2; // RTF_GATEWAY
-                if (hasGateway) {
-                    defaultRouteIface = fields[0];
-                    break;
-                }
-            }
-        }
-    }
+    const QString defaultRouteIface = m_netlink->defaultRouteInterface();
 
     QVariantList addresses;
     QString primaryAddress;
-    const QList<QNetworkInterface> interfaces = QNetworkInterface::allInterfaces();
-    for (const QNetworkInterface &interface : interfaces) {
-        if (!interface.isValid() || !interface.flags().testFlag(QNetworkInterface::IsUp)
-            || !interface.flags().testFlag(QNetworkInterface::IsRunning)
-            || interface.flags().testFlag(QNetworkInterface::IsLoopBack)) {
+    for (const NetlinkMonitor::Link &link : m_netlink->links()) {
+        if (!link.up || !link.running || link.loopback) {
             continue;
         }
 
-        for (const QNetworkAddressEntry &entry : interface.addressEntries()) {
-            const QHostAddress ip = entry.ip();
+        for (const NetlinkMonitor::Address &entry : m_netlink->addresses(link.index)) {
+            const QHostAddress &ip = entry.ip;
             if (ip.isNull() || ip.isLoopback() || ip.isMulticast()) {
                 continue;
             }
@@ -330,13 +375,13 @@ void SystemDetailsBackend::readOverview()
 
             const QString addressText = ip.toString();
             QVariantMap item;
-            item[QStringLiteral("interface")] = interface.name();
+            item[QStringLiteral("interface")] = link.name;
             item[QStringLiteral("address")] = addressText;
             item[QStringLiteral("family")] = addressFamilyLabel(protocol);
             addresses.append(item);
 
             if (protocol == QAbstractSocket::IPv4Protocol
-                && interface.name() == defaultRouteIface
+                && link.name == defaultRouteIface
                 && primaryAddress.isEmpty()) {
                 primaryAddress = addressText;
             }
@@ -363,38 +408,27 @@ void SystemDetailsBackend::readOverview()
 
 void SystemDetailsBackend::readCpuFrequencies()
 {
-    struct CpuEntry {
-        int core = 0;
-        CpuFrequencySample sample;
-    };
-
-    QVector<CpuEntry> entries;
-    const QDir cpuDir(QStringLiteral("/sys/devices/system/cpu"));
-    const QStringList cpuEntries = cpuDir.entryList(QStringList() << QStringLiteral("cpu[0-9]*"),
-                                                    QDir::Dirs | QDir::NoDotAndDotDot,
-                                                    QDir::Name);
-    entries.reserve(cpuEntries.size());
-
-    for (const QString &entryName : cpuEntries) {
-        const QString coreText = entryName.mid(3);
-        bool ok = false;
-        const int core = coreText.toInt(&ok);
-        if (!ok) {
-            continue;
-        }
+    if (m_presentCpus.isEmpty()) {
+        m_presentCpus = Backend::parseCpuList(
+            Backend::readTextFile(Backend::sysPath(QStringLiteral("/devices/system/cpu/present"))));
+    }
 
-        const QString cpuPath = cpuDir.filePath(entryName);
-        const QString onlineText = Backend::readTextFile(cpuPath + QStringLiteral("/online"));
-        const bool online = onlineText.isEmpty() || onlineText != QStringLiteral("0");
+    m_cpuFreqTable.refresh();
+    const QVector<CpuFreqTable::Policy> &policies = m_cpuFreqTable.policies();
+    const QVector<int> onlineCpus = Backend::parseCpuList(
+        Backend::readTextFile(Backend::sysPath(QStringLiteral("/devices/system/cpu/online"))));
 
-        qint64 currentKhz = Backend::readTextFile(cpuPath + QStringLiteral("/cpufreq/scaling_cur_freq")).toLongLong();
-        if (currentKhz <= 0) {
-            currentKhz = Backend::readTextFile(cpuPath + QStringLiteral("/cpufreq/cpuinfo_cur_freq")).toLongLong();
-        }
-
-        qint64 maxKhz = Backend::readTextFile(cpuPath + QStringLiteral("/cpufreq/scaling_max_freq")).toLongLong();
-        if (maxKhz <= 0) {
-            maxKhz = Backend::readTextFile(cpuPath + QStringLiteral("/cpufreq/cpuinfo_max_freq")).toLongLong();
+    QVariantList frequencies;
+    frequencies.reserve(m_presentCpus.size());
+    for (int core : std::as_const(m_presentCpus)) {
+        const auto policy = std::find_if(policies.cbegin(), policies.cend(), [core](const CpuFreqTable::Policy &entry) {
+            return entry.cpus.contains(core);
+        });
+        const bool online = onlineCpus.isEmpty() || onlineCpus.contains(core);
+        const qint64 currentKhz = policy != policies.cend() ? policy->currentKhz : 0;
+        qint64 maxKhz = policy != policies.cend() ? policy->scalingMaxKhz : 0;
+        if (maxKhz <= 0 && policy != policies.cend()) {
+            maxKhz = policy->hardwareMaxKhz;
         }
 
         CpuFrequencySample sample;
@@ -408,26 +442,94 @@ void SystemDetailsBackend::readCpuFrequencies()
                                  : QStringLiteral("Offline");
         const double ratio = (currentKhz > 0 && maxKhz > 0) ? (static_cast<double>(currentKhz) / maxKhz) : 0.0;
         sample.color = cpuFrequencyColor(ratio, online);
-        entries.append({core, sample});
+
+        QVariantMap map;
+        map[QStringLiteral("core")] = sample.core;
+        map[QStringLiteral("label")] = QStringLiteral("Core %1").arg(sample.core);
+        map[QStringLiteral("freqMHz")] = sample.freqMHz;
+        map[QStringLiteral("displayFreq")] = sample.displayFreq;
+        map[QStringLiteral("online")] = sample.online;
+        map[QStringLiteral("color")] = sample.color;
+        frequencies.append(map);
     }
 
-    std::sort(entries.begin(), entries.end(), [](const CpuEntry &left, const CpuEntry &right) {
-        return left.core < right.core;
-    });
+    QVariantList policyRows;
+    policyRows.reserve(policies.size());
+    for (const CpuFreqTable::Policy &policy : policies) {
+        // Cooling devices lower scaling_max_freq themselves, so a thermal
+        // cap shows up in both; a cap without cooling comes from userspace.
+        int coolingState = 0;
+        int coolingMax = 0;
+        for (const CpuFreqTable::CoolingDevice &device : policy.cooling) {
+            coolingState += device.state;
+            coolingMax += device.maxState;
+        }
 
-    QVariantList frequencies;
-    for (const CpuEntry &entry : entries) {
+        const bool limited = policy.hardwareMaxKhz > 0 && policy.scalingMaxKhz > 0
+                             && policy.scalingMaxKhz < policy.hardwareMaxKhz;
+        QString capReason;
+        if (coolingState > 0) {
+            capReason = QStringLiteral("thermal");
+        } else if (limited) {
+            capReason = QStringLiteral("limit");
+        }
+
+        quint64 intervalTotal = 0;
+        quint64 cumulativeTotal = 0;
+        for (const CpuFreqTable::OperatingPoint &point : policy.points) {
+            intervalTotal += point.time - point.previousTime;
+            cumulativeTotal += point.time - point.baselineTime;
+        }
+
+        QVariantList residency;
+        residency.reserve(policy.points.size());
+        double topShare = 0.0;
+        qint64 topKhz = 0;
+        for (const CpuFreqTable::OperatingPoint &point : policy.points) {
+            const double share = policy.hasPrevious && intervalTotal > 0
+                                     ? static_cast<double>(point.time - point.previousTime) / intervalTotal
+                                     : 0.0;
+            const double totalShare = cumulativeTotal > 0
+                                          ? static_cast<double>(point.time - point.baselineTime) / cumulativeTotal
+                                          : 0.0;
+            if (point.khz >= topKhz) {
+                topKhz = point.khz;
+                topShare = totalShare;
+            }
+
+            QVariantMap entry;
+            entry[QStringLiteral("freqMHz")] = point.khz / 1000.0;
+            entry[QStringLiteral("displayFreq")] = QStringLiteral("%1").arg(qRound(point.khz / 1000.0));
+            entry[QStringLiteral("share")] = share;
+            entry[QStringLiteral("totalShare")] = totalShare;
+            residency.append(entry);
+        }
+
+        const int firstCpu = policy.cpus.first();
+        const int lastCpu = policy.cpus.last();
         QVariantMap map;
-        map[QStringLiteral("core")] = entry.sample.core;
-        map[QStringLiteral("label")] = QStringLiteral("Core %1").arg(entry.sample.core);
-        map[QStringLiteral("freqMHz")] = entry.sample.freqMHz;
-        map[QStringLiteral("displayFreq")] = entry.sample.displayFreq;
-        map[QStringLiteral("online")] = entry.sample.online;
-        map[QStringLiteral("color")] = entry.sample.color;
-        frequencies.append(map);
+        map[QStringLiteral("name")] = policy.name;
+        map[QStringLiteral("label")] = firstCpu == lastCpu ? QStringLiteral("CPU %1").arg(firstCpu)
+                                                           : QStringLiteral("CPU %1-%2").arg(firstCpu).arg(lastCpu);
+        map[QStringLiteral("displayFreq")] = policy.currentKhz > 0
+                                                 ? QStringLiteral("%1 MHz").arg(qRound(policy.currentKhz / 1000.0))
+                                                 : QStringLiteral("--");
+        map[QStringLiteral("displayMax")] = policy.scalingMaxKhz > 0
+                                                ? QStringLiteral("%1 MHz").arg(qRound(policy.scalingMaxKhz / 1000.0))
+                                                : QStringLiteral("--");
+        map[QStringLiteral("hardwareMaxMHz")] = policy.hardwareMaxKhz / 1000.0;
+        map[QStringLiteral("capped")] = !capReason.isEmpty();
+        map[QStringLiteral("capReason")] = capReason;
+        map[QStringLiteral("coolingState")] = coolingState;
+        map[QStringLiteral("coolingMax")] = coolingMax;
+        map[QStringLiteral("residency")] = residency;
+        map[QStringLiteral("topShare")] = topShare;
+        map[QStringLiteral("displayTopShare")] = QStringLiteral("%1%").arg(QString::number(topShare * 100.0, 'f', 1));
+        policyRows.append(map);
     }
 
     m_cpuFrequencies = frequencies;
+    m_cpuPolicies = policyRows;
 }
 
 void SystemDetailsBackend::readTopProcesses()
@@ -436,50 +538,75 @@ void SystemDetailsBackend::readTopProcesses()
         m_totalMemoryKb = readTotalMemoryKb();
     }
 
+    // CPU shares are ratios of jiffies; a pass across suspend only rebases.
     const quint64 totalCpuTime = readTotalCpuTime();
-    const double totalCpuDiff = totalCpuTime >= m_prevTotalCpuTime
-                                    ? static_cast<double>(totalCpuTime - m_prevTotalCpuTime)
-                                    : 0.0;
+    quint64 totalCpuDelta = 0;
+    const double totalCpuDiff = m_sampleIntervalSec > 0.0
+            && CounterRate::counterDelta(totalCpuTime, m_prevTotalCpuTime, CounterRate::Bits64, totalCpuDelta)
+        ? static_cast<double>(totalCpuDelta)
+        : 0.0;
+
+    m_processTable.refresh();
+    const auto &processes = m_processTable.processes();
+    const ProcessTable::Counters counters = m_processTable.counters();
+    const bool memoryKey = m_processSortKey == QLatin1String("memory");
+    const bool readKey = m_processSortKey == QLatin1String("read");
 
     QVector<RankedProcess> ranked;
-    QHash<int, quint64> processTimes;
-
-    const QDir procDir(QStringLiteral("/proc"));
-    const QStringList procEntries = procDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    ranked.reserve(procEntries.size());
-
-    for (const QString &entryName : procEntries) {
-        if (!numericName(entryName)) {
-            continue;
-        }
-
-        ProcessSample sample;
-        if (!readProcessSample(entryName, sample)) {
+    ranked.reserve(static_cast<int>(processes.size()));
+    for (const auto &entry : processes) {
+        const ProcessTable::Process &sample = entry.second;
+        if (sample.state == 'Z') {
             continue;
         }
 
-        processTimes.insert(sample.pid, sample.totalCpuTime);
-
         RankedProcess process;
         process.pid = sample.pid;
-        process.name = sample.name;
-        process.rssBytes = sample.rssBytes;
+        process.name = sample.name.isEmpty() ? QStringLiteral("unknown") : sample.name;
+        process.rssBytes = std::max<qint64>(0, sample.rssPages) * m_pageSizeBytes;
         process.memPercent = m_totalMemoryKb > 0
-                                 ? (sample.rssBytes / 1024.0) * 100.0 / m_totalMemoryKb
+                                 ? (process.rssBytes / 1024.0) * 100.0 / m_totalMemoryKb
                                  : 0.0;
 
-        if (totalCpuDiff > 0.0) {
-            const quint64 previousProcessTime = m_prevProcessCpuTimes.value(sample.pid, sample.totalCpuTime);
-            const quint64 processDiff = sample.totalCpuTime >= previousProcessTime
-                                            ? (sample.totalCpuTime - previousProcessTime)
-                                            : 0;
-            process.cpuPercent = static_cast<double>(processDiff) * 100.0 / totalCpuDiff;
+        if (totalCpuDiff > 0.0 && sample.hasPrevious && sample.cpuTime >= sample.previousCpuTime) {
+            process.cpuPercent = static_cast<double>(sample.cpuTime - sample.previousCpuTime) * 100.0 / totalCpuDiff;
+        }
+
+        if (sample.hasPreviousCounters) {
+            process.readRate = CounterRate::rateOver(sample.readBytes, sample.previousReadBytes, m_sampleIntervalSec);
+            process.writeRate = CounterRate::rateOver(sample.writeBytes, sample.previousWriteBytes,
+                                                      m_sampleIntervalSec);
+            process.switchRate = CounterRate::rateOver(sample.voluntarySwitches, sample.previousVoluntarySwitches,
+                                                       m_sampleIntervalSec)
+                                 + CounterRate::rateOver(sample.involuntarySwitches,
+                                                         sample.previousInvoluntarySwitches, m_sampleIntervalSec);
+        }
+
+        switch (counters) {
+        case ProcessTable::Counters::Io:
+            process.rankValue = readKey ? process.readRate : process.writeRate;
+            break;
+        case ProcessTable::Counters::ContextSwitches:
+            process.rankValue = process.switchRate;
+            break;
+        case ProcessTable::Counters::None:
+            process.rankValue = memoryKey ? static_cast<double>(process.rssBytes) : process.cpuPercent;
+            break;
         }
 
         ranked.append(process);
     }
 
-    std::sort(ranked.begin(), ranked.end(), [](const RankedProcess &left, const RankedProcess &right) {
+    // Only the first kTopProcessLimit rows are shown, so there is no point in
+    // ordering the other thousand. CPU percentages jitter, hence the slack.
+    const double tolerance = counters == ProcessTable::Counters::None && !memoryKey ? 0.05 : 0.0;
+    const int count = std::min(kTopProcessLimit, static_cast<int>(ranked.size()));
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                      [tolerance](const RankedProcess &left, const RankedProcess &right) {
+        if (std::abs(left.rankValue - right.rankValue) > tolerance) {
+            return left.rankValue > right.rankValue;
+        }
+
         if (std::abs(left.cpuPercent - right.cpuPercent) > 0.05) {
             return left.cpuPercent > right.cpuPercent;
         }
@@ -492,7 +619,6 @@ void SystemDetailsBackend::readTopProcesses()
     });
 
     QVariantList topProcesses;
-    const int count = std::min(kTopProcessLimit, static_cast<int>(ranked.size()));
     topProcesses.reserve(count);
     for (int index = 0; index < count; ++index) {
         const RankedProcess &process = ranked.at(index);
@@ -504,119 +630,66 @@ void SystemDetailsBackend::readTopProcesses()
             QStringLiteral("%1%").arg(QString::number(process.cpuPercent, 'f', process.cpuPercent >= 10.0 ? 0 : 1));
         map[QStringLiteral("memoryPercent")] = process.memPercent;
         map[QStringLiteral("displayMemory")] = Backend::formatSize(process.rssBytes);
+        map[QStringLiteral("readRate")] = process.readRate;
+        map[QStringLiteral("displayRead")] = Backend::formatSpeed(static_cast<quint64>(process.readRate));
+        map[QStringLiteral("writeRate")] = process.writeRate;
+        map[QStringLiteral("displayWrite")] = Backend::formatSpeed(static_cast<quint64>(process.writeRate));
+        map[QStringLiteral("switchRate")] = process.switchRate;
+        map[QStringLiteral("displaySwitches")] = QStringLiteral("%1/s").arg(qRound(process.switchRate));
         topProcesses.append(map);
     }
 
     m_topProcesses = topProcesses;
-    m_prevProcessCpuTimes = processTimes;
     m_prevTotalCpuTime = totalCpuTime;
 }
 
 void SystemDetailsBackend::readThermalSensors()
 {
-    struct RawThermalEntry {
-        QString key;
-        QString name;
-        double tempC = 0.0;
-    };
-
-    auto tempToCelsius = [](qint64 tempRaw) {
-        return std::abs(tempRaw) >= 1000 ? (tempRaw / 1000.0) : static_cast<double>(tempRaw);
-    };
+    m_thermalTable.refresh();
 
-    QVector<RawThermalEntry> rawEntries;
-    QHash<QString, int> nameCounts;
-
-    const QDir hwmonDir(QStringLiteral("/sys/class/hwmon"));
-    const QStringList hwmonEntries = hwmonDir.entryList(QStringList() << QStringLiteral("hwmon*"),
-                                                        QDir::Dirs | QDir::NoDotAndDotDot,
-                                                        QDir::Name);
-    rawEntries.reserve(hwmonEntries.size());
-
-    for (const QString &entryName : hwmonEntries) {
-        const QString hwmonPath = hwmonDir.filePath(entryName);
-        const QString baseName = Backend::readTextFile(hwmonPath + QStringLiteral("/name")).trimmed();
-        if (baseName.isEmpty()) {
+    QVariantList thermalSensors;
+    for (const ThermalSensorTable::Sensor &sensor : m_thermalTable.sensors()) {
+        if (!sensor.valid) {
             continue;
         }
 
-        const QDir sensorDir(hwmonPath);
-        const QStringList tempInputs = sensorDir.entryList(QStringList() << QStringLiteral("temp*_input"),
-                                                           QDir::Files,
-                                                           QDir::Name);
-        for (const QString &tempInput : tempInputs) {
-            const qint64 tempRaw = Backend::readTextFile(sensorDir.filePath(tempInput)).toLongLong();
-            if (tempRaw <= 0) {
-                continue;
-            }
-
-            const double tempC = tempToCelsius(tempRaw);
-            if (tempC <= 0.0) {
-                continue;
-            }
+        QVariantMap map;
+        map[QStringLiteral("key")] = sensor.key;
+        map[QStringLiteral("name")] = sensor.name;
+        map[QStringLiteral("tempC")] = sensor.tempC;
+        map[QStringLiteral("displayTemp")] = QStringLiteral("%1 °C").arg(QString::number(sensor.tempC, 'f', 1));
+        map[QStringLiteral("color")] = sensor.color;
 
-            QString displayName = baseName;
-            const QString sensorIndex = tempInput.mid(4, tempInput.size() - 10);
-            const QString label = Backend::readTextFile(sensorDir.filePath(QStringLiteral("temp%1_label").arg(sensorIndex))).trimmed();
-            if (!label.isEmpty()) {
-                displayName = QStringLiteral("%1 / %2").arg(baseName, label);
+        // Passive and hot trips are where the kernel starts throttling; a
+        // sensor without them is measured against its lowest trip instead.
+        const ThermalSensorTable::TripPoint *throttle = nullptr;
+        QVariantList trips;
+        for (const ThermalSensorTable::TripPoint &trip : sensor.trips) {
+            if (!throttle && (trip.type == QLatin1String("passive") || trip.type == QLatin1String("hot"))) {
+                throttle = &trip;
             }
 
-            rawEntries.append({QStringLiteral("%1:%2").arg(entryName, tempInput), displayName, tempC});
-            nameCounts[displayName] += 1;
+            QVariantMap tripMap;
+            tripMap[QStringLiteral("type")] = trip.type;
+            tripMap[QStringLiteral("tempC")] = trip.tempC;
+            trips.append(tripMap);
         }
-    }
-
-    if (rawEntries.isEmpty()) {
-        const QDir thermalDir(QStringLiteral("/sys/class/thermal"));
-        const QStringList thermalEntries = thermalDir.entryList(QStringList() << QStringLiteral("thermal_zone*"),
-                                                                QDir::Dirs | QDir::NoDotAndDotDot,
-                                                                QDir::Name);
-        rawEntries.reserve(thermalEntries.size());
-
-        for (const QString &entryName : thermalEntries) {
-            const QString zonePath = thermalDir.filePath(entryName);
-            const QString type = Backend::readTextFile(zonePath + QStringLiteral("/type")).trimmed();
-            const qint64 tempRaw = Backend::readTextFile(zonePath + QStringLiteral("/temp")).toLongLong();
-            if (type.isEmpty() || tempRaw <= 0) {
-                continue;
-            }
-
-            const double tempC = tempToCelsius(tempRaw);
-            if (tempC <= 0.0) {
-                continue;
-            }
 
-            rawEntries.append({entryName, type, tempC});
-            nameCounts[type] += 1;
+        if (!throttle && !sensor.trips.isEmpty()) {
+            throttle = &sensor.trips.first();
         }
-    }
 
-    QVector<ThermalSample> sensors;
-    sensors.reserve(rawEntries.size());
-    for (const RawThermalEntry &entry : rawEntries) {
-        QString displayName = entry.name;
-        if (nameCounts.value(entry.name) > 1) {
-            displayName = QStringLiteral("%1 (%2)").arg(entry.name, entry.key);
+        map[QStringLiteral("tripPoints")] = trips;
+        map[QStringLiteral("hasTrip")] = throttle != nullptr;
+        if (throttle) {
+            map[QStringLiteral("tripType")] = throttle->type;
+            map[QStringLiteral("tripC")] = throttle->tempC;
+            map[QStringLiteral("headroomC")] = throttle->tempC - sensor.tempC;
+            map[QStringLiteral("tripRatio")] = std::clamp(sensor.tempC / throttle->tempC, 0.0, 1.0);
+            map[QStringLiteral("displayTrip")] =
+                QStringLiteral("%1 °C %2").arg(QString::number(throttle->tempC, 'f', 0), throttle->type);
         }
 
-        sensors.append({entry.key, displayName, entry.tempC, thermalColorForName(entry.name)});
-    }
-
-    std::sort(sensors.begin(), sensors.end(), [](const ThermalSample &left, const ThermalSample &right) {
-        return left.name < right.name;
-    });
-
-    QVariantList thermalSensors;
-    thermalSensors.reserve(sensors.size());
-
-    for (const ThermalSample &sensor : sensors) {
-        QVariantMap map;
-        map[QStringLiteral("key")] = sensor.key;
-        map[QStringLiteral("name")] = sensor.name;
-        map[QStringLiteral("tempC")] = sensor.tempC;
-        map[QStringLiteral("displayTemp")] = QStringLiteral("%1 °C").arg(QString::number(sensor.tempC, 'f', 1));
-        map[QStringLiteral("color")] = sensor.color;
         thermalSensors.append(map);
     }
 
@@ -625,19 +698,13 @@ void SystemDetailsBackend::readThermalSensors()
 
 qint64 SystemDetailsBackend::readTotalMemoryKb() const
 {
-    QFile memInfo(QStringLiteral("/proc/meminfo"));
-    if (!memInfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return 0;
-    }
-
-    QTextStream stream(&memInfo);
-    while (!stream.atEnd()) {
-        const QString line = stream.readLine();
-        if (!line.startsWith(QStringLiteral("MemTotal:"))) {
+    const QByteArray content = m_cache->read(Backend::procPath(QStringLiteral("/meminfo")));
+    for (const QByteArray &line : content.split('\n')) {
+        if (!line.startsWith("MemTotal:")) {
             continue;
         }
 
-        const QStringList parts = line.simplified().split(QLatin1Char(' '));
+        const QList<QByteArray> parts = line.simplified().split(' ');
         if (parts.size() >= 2) {
             return parts.at(1).toLongLong();
         }
@@ -648,121 +715,59 @@ qint64 SystemDetailsBackend::readTotalMemoryKb() const
 
 quint64 SystemDetailsBackend::readTotalCpuTime() const
 {
-    QFile statFile(QStringLiteral("/proc/stat"));
-    if (!statFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return 0;
-    }
-
-    const QString firstLine = QString::fromUtf8(statFile.readLine()).simplified();
-    const QStringList parts = firstLine.split(QLatin1Char(' '), Qt::SkipEmptyParts);
-    if (parts.size() < 2 || parts.first() != QStringLiteral("cpu")) {
+    const QByteArray content = m_cache->read(Backend::procPath(QStringLiteral("/stat")));
+    const QList<QByteArray> parts = content.left(content.indexOf('\n')).simplified().split(' ');
+    if (parts.size() < 2 || parts.first() != "cpu") {
         return 0;
     }
 
+    // user .. steal; guest and guest_nice are already counted in user and nice.
+    constexpr int kAccountedFields = 8;
     quint64 total = 0;
-    for (int index = 1; index < parts.size(); ++index) {
+    for (int index = 1; index < parts.size() && index <= kAccountedFields; ++index) {
         total += parts.at(index).toULongLong();
     }
 
     return total;
 }
 
-bool SystemDetailsBackend::readProcessSample(const QString &pidText, ProcessSample &sample) const
-{
-    QFile statFile(QStringLiteral("/proc/%1/stat").arg(pidText));
-    if (!statFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return false;
-    }
-
-    const QString statLine = QString::fromUtf8(statFile.readLine()).trimmed();
-    const int openParen = statLine.indexOf(QLatin1Char('('));
-    const int closeParen = statLine.lastIndexOf(QLatin1Char(')'));
-    if (openParen < 0 || closeParen <= openParen) {
-        return false;
-    }
-
-    const QString name = statLine.mid(openParen + 1, closeParen - openParen - 1);
-    const QString remainder = statLine.mid(closeParen + 2);
-    const QStringList fields = remainder.split(QLatin1Char(' '), Qt::SkipEmptyParts);
-    if (fields.size() < 22 || fields.first() == QStringLiteral("Z")) {
-        return false;
-    }
-
-    bool okPid = false;
-    const int pid = pidText.toInt(&okPid);
-    if (!okPid) {
-        return false;
-    }
-
-    bool okUser = false;
-    bool okSystem = false;
-    bool okRss = false;
-    const quint64 userTime = fields.at(11).toULongLong(&okUser);
-    const quint64 systemTime = fields.at(12).toULongLong(&okSystem);
-    const qint64 rssPages = fields.at(21).toLongLong(&okRss);
-    if (!okUser || !okSystem || !okRss) {
-        return false;
-    }
-
-    sample.pid = pid;
-    sample.name = name.isEmpty() ? QStringLiteral("unknown") : name;
-    sample.totalCpuTime = userTime + systemTime;
-    sample.rssBytes = std::max<qint64>(0, rssPages) * m_pageSizeBytes;
-    return true;
-}
-
 void SystemDetailsBackend::readNetworkSpeeds()
 {
-    const double intervalSec = kRefreshIntervalMs / 1000.0;
+    const RateStamp stamp = m_sampleClock.last();
     QVariantList speeds;
-    QHash<QString, NetCounter> currentCounters;
-
-    const QDir netDir(QStringLiteral("/sys/class/net"));
-    const QStringList interfaces = netDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QString &iface : interfaces) {
-        if (iface == QLatin1String("lo")) {
-            continue;
-        }
+    QHash<QString, NetRates> currentRates;
 
-        const QString basePath = QStringLiteral("/sys/class/net/%1/").arg(iface);
-
-        const QString operstate = Backend::readTextFile(basePath + QStringLiteral("operstate")).trimmed();
-        if (operstate != QLatin1String("up")) {
-            continue;
-        }
-
-        bool okRx = false;
-        bool okTx = false;
-        const quint64 rx = Backend::readTextFile(basePath + QStringLiteral("statistics/rx_bytes")).trimmed().toULongLong(&okRx);
-        const quint64 tx = Backend::readTextFile(basePath + QStringLiteral("statistics/tx_bytes")).trimmed().toULongLong(&okTx);
-        if (!okRx || !okTx) {
+    m_cache->refreshNetCounters();
+    for (const NetlinkMonitor::Link &link : m_netlink->links()) {
+        if (link.loopback || !link.operUp) {
             continue;
         }
 
-        currentCounters[iface] = {rx, tx};
-
-        if (m_prevNetCounters.contains(iface)) {
-            const NetCounter &prev = m_prevNetCounters[iface];
-            const quint64 rxDelta = rx >= prev.rx ? rx - prev.rx : 0;
-            const quint64 txDelta = tx >= prev.tx ? tx - prev.tx : 0;
-            const quint64 rxSpeed = static_cast<quint64>(rxDelta / intervalSec);
-            const quint64 txSpeed = static_cast<quint64>(txDelta / intervalSec);
+        const QString &iface = link.name;
+        NetRates rates = m_netRates.value(iface);
+        const bool rxValid = rates.rx.sample(link.rxBytes, stamp);
+        const bool txValid = rates.tx.sample(link.txBytes, stamp);
+        currentRates.insert(iface, rates);
 
+        if (rxValid && txValid) {
             QVariantMap item;
             item[QStringLiteral("interface")] = iface;
-            item[QStringLiteral("rxSpeed")] = Backend::formatSpeed(rxSpeed);
-            item[QStringLiteral("txSpeed")] = Backend::formatSpeed(txSpeed);
+            item[QStringLiteral("rxSpeed")] = Backend::formatSpeed(static_cast<quint64>(rates.rx.rate()));
+            item[QStringLiteral("txSpeed")] = Backend::formatSpeed(static_cast<quint64>(rates.tx.rate()));
             speeds.append(item);
         }
     }
 
-    m_prevNetCounters = currentCounters;
-    m_networkSpeeds = speeds;
+    m_netRates = currentRates;
+    // A pass that only rebased (first one, after suspend) keeps the last rows.
+    if (m_sampleIntervalSec > 0.0) {
+        m_networkSpeeds = speeds;
+    }
 }
 
 void SystemDetailsBackend::readMemoryDetails()
 {
-    const QString content = Backend::readTextFile(QStringLiteral("/proc/meminfo"));
+    const QString content = QString::fromLatin1(m_cache->read(Backend::procPath(QStringLiteral("/meminfo"))));
     if (content.isEmpty()) {
         return;
     }
@@ -819,62 +824,71 @@ void SystemDetailsBackend::readMemoryDetails()
 
 void SystemDetailsBackend::readDiskIoSpeeds()
 {
-    const double intervalSec = kRefreshIntervalMs / 1000.0;
-    QVariantList speeds;
-    QHash<QString, DiskIoCounter> currentCounters;
-
-    const QString content = Backend::readTextFile(QStringLiteral("/proc/diskstats"));
+    const double intervalSec = m_sampleIntervalSec;
+    const double intervalMs = intervalSec * 1000.0;
+    const QByteArray content = m_cache->read(Backend::procPath(QStringLiteral("/diskstats")));
     if (content.isEmpty()) {
         return;
     }
 
-    const QStringList rawLines = content.split(QLatin1Char('\n'), Qt::SkipEmptyParts);
-    for (const QString &rawLine : rawLines) {
-        const QString line = rawLine.trimmed();
-        const QStringList fields = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
-        if (fields.size() < 14) {
-            continue;
-        }
-
-        const QString device = fields[2];
+    m_diskStatsTable.update(content);
+    if (intervalSec <= 0.0) {
+        return;
+    }
 
-        // Skip partitions (e.g. sda1) and loop/ram devices — only whole disks
-        if (device.startsWith(QLatin1String("loop")) || device.startsWith(QLatin1String("ram"))) {
-            continue;
+    // Per-op latency is the time spent on the completed requests divided by
+    // their count, as iostat's r_await / w_await.
+    const auto latency = [](quint64 ms, quint64 ops) {
+        return ops > 0 ? static_cast<double>(ms) / ops : -1.0;
+    };
+    const auto formatLatency = [](double ms) {
+        if (ms < 0.0) {
+            return QStringLiteral("--");
         }
+        return ms < 10.0 ? QStringLiteral("%1 ms").arg(ms, 0, 'f', 1) : QStringLiteral("%1 ms").arg(qRound(ms));
+    };
 
-        // Skip partitions: if removing trailing digits yields a different device that also exists,
-        // this is a partition. Simpler heuristic: skip if name ends with a digit and contains
-        // a letter followed by digits (e.g. sda1, nvme0n1p1, mmcblk0p1).
-        // We only want whole devices: sda, nvme0n1, mmcblk0
-        static const QRegularExpression partitionRe(QStringLiteral("^(sd[a-z]+|nvme\\d+n\\d+|mmcblk\\d+)p?\\d+$"));
-        static const QRegularExpression wholeDeviceRe(QStringLiteral("^(sd[a-z]+|nvme\\d+n\\d+|mmcblk\\d+|vd[a-z]+)$"));
-        if (!wholeDeviceRe.match(device).hasMatch()) {
+    QVariantList speeds;
+    for (const DiskStatsTable::Device &device : m_diskStatsTable.devices()) {
+        if (!device.wholeDisk || !device.hasPrevious) {
             continue;
         }
 
-        // fields[5] = sectors read, fields[9] = sectors written
-        const quint64 readSectors = fields[5].toULongLong();
-        const quint64 writeSectors = fields[9].toULongLong();
-
-        currentCounters[device] = {readSectors, writeSectors};
+        const DiskStatsTable::Counters &now = device.current;
+        const DiskStatsTable::Counters &prev = device.previous;
+        const auto delta = [](quint64 current, quint64 previous) {
+            quint64 value = 0;
+            CounterRate::counterDelta(current, previous, CounterRate::Bits64, value);
+            return value;
+        };
+
+        // Sectors are always 512 bytes in diskstats, whatever the device uses.
+        const quint64 readSpeed = static_cast<quint64>((delta(now.readSectors, prev.readSectors) * 512) / intervalSec);
+        const quint64 writeSpeed = static_cast<quint64>((delta(now.writeSectors, prev.writeSectors) * 512) / intervalSec);
+        const quint64 discardSpeed = static_cast<quint64>((delta(now.discardSectors, prev.discardSectors) * 512) / intervalSec);
+        const double readLatencyMs = latency(delta(now.readMs, prev.readMs), delta(now.reads, prev.reads));
+        const double writeLatencyMs = latency(delta(now.writeMs, prev.writeMs), delta(now.writes, prev.writes));
+        const double utilization = qBound(0.0, delta(now.ioTicksMs, prev.ioTicksMs) / intervalMs, 1.0);
+        const double queueDepth = delta(now.queueMs, prev.queueMs) / intervalMs;
 
-        if (m_prevDiskIoCounters.contains(device)) {
-            const DiskIoCounter &prev = m_prevDiskIoCounters[device];
-            const quint64 readDelta = readSectors >= prev.readSectors ? readSectors - prev.readSectors : 0;
-            const quint64 writeDelta = writeSectors >= prev.writeSectors ? writeSectors - prev.writeSectors : 0;
-            // Sector size is typically 512 bytes
-            const quint64 readSpeed = static_cast<quint64>((readDelta * 512) / intervalSec);
-            const quint64 writeSpeed = static_cast<quint64>((writeDelta * 512) / intervalSec);
-
-            QVariantMap item;
-            item[QStringLiteral("device")] = device;
-            item[QStringLiteral("readSpeed")] = Backend::formatSpeed(readSpeed);
-            item[QStringLiteral("writeSpeed")] = Backend::formatSpeed(writeSpeed);
-            speeds.append(item);
-        }
+        QVariantMap item;
+        item[QStringLiteral("device")] = device.name;
+        item[QStringLiteral("readSpeed")] = Backend::formatSpeed(readSpeed);
+        item[QStringLiteral("writeSpeed")] = Backend::formatSpeed(writeSpeed);
+        item[QStringLiteral("readLatencyMs")] = readLatencyMs;
+        item[QStringLiteral("writeLatencyMs")] = writeLatencyMs;
+        item[QStringLiteral("readLatency")] = formatLatency(readLatencyMs);
+        item[QStringLiteral("writeLatency")] = formatLatency(writeLatencyMs);
+        item[QStringLiteral("utilization")] = utilization;
+        item[QStringLiteral("displayUtilization")] = QStringLiteral("%1%").arg(qRound(utilization * 100.0));
+        item[QStringLiteral("inFlight")] = static_cast<int>(now.inFlight);
+        item[QStringLiteral("queueDepth")] = queueDepth;
+        item[QStringLiteral("displayQueueDepth")] = QString::number(queueDepth, 'f', 2);
+        item[QStringLiteral("discardSpeed")] = Backend::formatSpeed(discardSpeed);
+        item[QStringLiteral("discardOps")] = delta(now.discards, prev.discards) / intervalSec;
+        item[QStringLiteral("hasDiscards")] = now.discards > 0;
+        speeds.append(item);
     }
 
-    m_prevDiskIoCounters = currentCounters;
     m_diskIoSpeeds = speeds;
 }
@@ -5,7 +5,17 @@
 #include <QVariantList>
 #include <QVector>
 
-class QTimer;
+#include "CounterRate.h"
+#include "CpuFreqTable.h"
+#include "DiskStatsTable.h"
+#include "ProcessTable.h"
+#include "ThermalSensorTable.h"
+
+class MetricScheduler;
+class NetlinkMonitor;
+class ProcConnector;
+class SampleCache;
+class UeventMonitor;
 
 class SystemDetailsBackend : public QObject
 {
@@ -16,7 +26,16 @@ class SystemDetailsBackend : public QObject
     Q_PROPERTY(QString primaryIp READ primaryIp NOTIFY dataChanged)
     Q_PROPERTY(QVariantList ipAddresses READ ipAddresses NOTIFY dataChanged)
     Q_PROPERTY(QVariantList cpuFrequencies READ cpuFrequencies NOTIFY dataChanged)
+    // One row per cpufreq policy (cluster): current and capped maximum
+    // frequency, cap reason and the time_in_state residency histogram.
+    Q_PROPERTY(QVariantList cpuPolicies READ cpuPolicies NOTIFY dataChanged)
     Q_PROPERTY(QVariantList topProcesses READ topProcesses NOTIFY dataChanged)
+    // "cpu", "memory", "read", "write" or "switches". Disk and context
+    // switch counters are only sampled while their key is selected.
+    Q_PROPERTY(QString processSortKey READ processSortKey WRITE setProcessSortKey NOTIFY processSortKeyChanged)
+    // Processes that started and exited between two samples; only filled
+    // while the proc connector is running.
+    Q_PROPERTY(QVariantList recentExits READ recentExits NOTIFY dataChanged)
     Q_PROPERTY(QVariantList thermalSensors READ thermalSensors NOTIFY dataChanged)
     Q_PROPERTY(QVariantList networkSpeeds READ networkSpeeds NOTIFY dataChanged)
     Q_PROPERTY(QVariantList memoryDetails READ memoryDetails NOTIFY dataChanged)
@@ -24,7 +43,8 @@ class SystemDetailsBackend : public QObject
     Q_PROPERTY(int topProcessLimit READ topProcessLimit CONSTANT)
 
 public:
-    explicit SystemDetailsBackend(QObject *parent = nullptr);
+    SystemDetailsBackend(MetricScheduler *scheduler, NetlinkMonitor *netlink, UeventMonitor *uevent,
+                         SampleCache *cache, QObject *parent = nullptr);
 
     bool active() const;
     void setActive(bool active);
@@ -34,7 +54,11 @@ public:
     QString primaryIp() const;
     QVariantList ipAddresses() const;
     QVariantList cpuFrequencies() const;
+    QVariantList cpuPolicies() const;
     QVariantList topProcesses() const;
+    QString processSortKey() const;
+    void setProcessSortKey(const QString &key);
+    QVariantList recentExits() const;
     QVariantList thermalSensors() const;
     QVariantList networkSpeeds() const;
     QVariantList memoryDetails() const;
@@ -46,19 +70,17 @@ public:
 signals:
     void activeChanged();
     void dataChanged();
+    void processSortKeyChanged();
 
 private slots:
     void refresh();
 
 private:
-    struct ProcessSample {
-        int pid = 0;
-        QString name;
-        quint64 totalCpuTime = 0;
-        qint64 rssBytes = 0;
-    };
+    // bench/collector_bench.cpp times the individual read* passes.
+    friend class CollectorBench;
 
     void resetSamplingState();
+    void handleProcessExit(int pid);
     void readOverview();
     void readCpuFrequencies();
     void readTopProcesses();
@@ -69,25 +91,35 @@ private:
 
     qint64 readTotalMemoryKb() const;
     quint64 readTotalCpuTime() const;
-    bool readProcessSample(const QString &pidText, ProcessSample &sample) const;
 
-    QTimer *m_timer = nullptr;
+    MetricScheduler *m_scheduler = nullptr;
+    NetlinkMonitor *m_netlink = nullptr;
+    SampleCache *m_cache = nullptr;
+    ProcConnector *m_procConnector = nullptr;
+    int m_subscription = 0;
     bool m_active = false;
+    RateClock m_sampleClock;
+    double m_sampleIntervalSec = 0.0;
     QString m_hostname;
     QString m_uptime;
     QString m_primaryIp;
     QVariantList m_ipAddresses;
     QVariantList m_cpuFrequencies;
+    QVariantList m_cpuPolicies;
+    QVector<int> m_presentCpus;
     QVariantList m_topProcesses;
+    QString m_processSortKey = QStringLiteral("cpu");
+    QVariantList m_recentExits;
     QVariantList m_thermalSensors;
     QVariantList m_networkSpeeds;
     QVariantList m_memoryDetails;
     QVariantList m_diskIoSpeeds;
-    struct NetCounter { quint64 rx = 0; quint64 tx = 0; };
-    QHash<QString, NetCounter> m_prevNetCounters;
-    struct DiskIoCounter { quint64 readSectors = 0; quint64 writeSectors = 0; };
-    QHash<QString, DiskIoCounter> m_prevDiskIoCounters;
-    QHash<int, quint64> m_prevProcessCpuTimes;
+    struct NetRates { CounterRate rx; CounterRate tx; };
+    QHash<QString, NetRates> m_netRates;
+    ProcessTable m_processTable;
+    CpuFreqTable m_cpuFreqTable;
+    DiskStatsTable m_diskStatsTable;
+    ThermalSensorTable m_thermalTable;
     quint64 m_prevTotalCpuTime = 0;
     qint64 m_totalMemoryKb = 0;
     qint64 m_pageSizeBytes = 4096;
@@ -6,10 +6,20 @@
 #include <QFileInfo>
 #include <QString>
 #include <QTextStream>
+#include <QVariant>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
 #include <QtGlobal>
 
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
 #include <pwd.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 namespace Backend {
 
@@ -35,6 +45,105 @@ inline bool writeTextFile(const QString &path, const QString &value)
     return true;
 }
 
+// Single write(2) to a sysfs attribute. Unlike writeTextFile(), a value
+// the kernel rejects (EINVAL, EBUSY, ...) is reported as a failure.
+inline bool writeSysfsValue(const QString &path, const QByteArray &value, QString *error = nullptr)
+{
+    const QByteArray encoded = QFile::encodeName(path);
+    const int fd = ::open(encoded.constData(), O_WRONLY | O_CLOEXEC);
+    ssize_t written = -1;
+    int savedErrno = errno;
+    if (fd >= 0) {
+        written = ::write(fd, value.constData(), static_cast<size_t>(value.size()));
+        savedErrno = errno;
+        ::close(fd);
+    }
+
+    if (written != value.size()) {
+        if (error) {
+            *error = QStringLiteral("%1: %2").arg(path, QString::fromLocal8Bit(std::strerror(savedErrno)));
+        }
+        return false;
+    }
+
+    return true;
+}
+
+// Tolerance used when deciding whether a sampled value changed enough to be
+// worth a change notification. Percentages are stored as 0..1 fractions, so
+// 1e-3 is a tenth of a percent.
+constexpr double kChangeTolerance = 1e-3;
+
+inline bool nearlyEqual(double left, double right, double tolerance = kChangeTolerance)
+{
+    return std::abs(left - right) <= tolerance;
+}
+
+// Deep comparison of sampled QVariant trees where floating-point leaves are
+// compared with a tolerance instead of bit-for-bit.
+inline bool variantsNearlyEqual(const QVariant &left, const QVariant &right,
+                                double tolerance = kChangeTolerance)
+{
+    const int leftType = left.typeId();
+    const int rightType = right.typeId();
+
+    if ((leftType == QMetaType::Double || leftType == QMetaType::Float)
+        && (rightType == QMetaType::Double || rightType == QMetaType::Float)) {
+        return nearlyEqual(left.toDouble(), right.toDouble(), tolerance);
+    }
+
+    if (leftType != rightType) {
+        return false;
+    }
+
+    if (leftType == QMetaType::QVariantList) {
+        const QVariantList leftList = left.toList();
+        const QVariantList rightList = right.toList();
+        if (leftList.size() != rightList.size()) {
+            return false;
+        }
+
+        for (int index = 0; index < leftList.size(); ++index) {
+            if (!variantsNearlyEqual(leftList.at(index), rightList.at(index), tolerance)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    if (leftType == QMetaType::QVariantMap) {
+        const QVariantMap leftMap = left.toMap();
+        const QVariantMap rightMap = right.toMap();
+        if (leftMap.size() != rightMap.size()) {
+            return false;
+        }
+
+        for (auto it = leftMap.cbegin(); it != leftMap.cend(); ++it) {
+            const auto other = rightMap.constFind(it.key());
+            if (other == rightMap.cend() || !variantsNearlyEqual(it.value(), other.value(), tolerance)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    return left == right;
+}
+
+inline bool variantsNearlyEqual(const QVariantList &left, const QVariantList &right,
+                                double tolerance = kChangeTolerance)
+{
+    return variantsNearlyEqual(QVariant(left), QVariant(right), tolerance);
+}
+
+inline bool variantsNearlyEqual(const QVariantMap &left, const QVariantMap &right,
+                                double tolerance = kChangeTolerance)
+{
+    return variantsNearlyEqual(QVariant(left), QVariant(right), tolerance);
+}
+
 inline QString formatSize(qint64 bytes)
 {
     if (bytes < 1024) {
@@ -69,6 +178,17 @@ inline QString formatSpeed(quint64 bytes)
     return QString::number(bytes / 1024.0 / 1024.0 / 1024.0, 'f', 1) + " GB/s";
 }
 
+// Events per second: "0.4/s", "37/s", "12.5k/s".
+inline QString formatRate(double perSecond)
+{
+    if (perSecond >= 10000.0) {
+        return QStringLiteral("%1k/s").arg(perSecond / 1000.0, 0, 'f', 1);
+    }
+
+    return perSecond >= 10.0 ? QStringLiteral("%1/s").arg(qRound(perSecond))
+                             : QStringLiteral("%1/s").arg(perSecond, 0, 'f', 1);
+}
+
 inline QString readOsVersion()
 {
     const QString content = readTextFile("/etc/os-release");
@@ -217,6 +337,86 @@ inline QString screenshotDirectory()
     return QDir::cleanPath(baseHome + QStringLiteral("/Pictures/Orbital/Screenshots"));
 }
 
+// Number of samples the in-memory history charts keep (ORBITAL_HISTORY_SAMPLES).
+inline int historyCapacity()
+{
+    constexpr int kDefaultHistorySamples = 60;
+    bool ok = false;
+    const int configured = readEnvironmentValue("ORBITAL_HISTORY_SAMPLES").toInt(&ok);
+    return (ok && configured > 1) ? configured : kDefaultHistorySamples;
+}
+
+// Roots of the procfs and sysfs trees the collectors read. ORBITAL_PROC_ROOT
+// and ORBITAL_SYS_ROOT point them at a fixture tree instead; both are read
+// once, so they must be set before the first sample.
+inline const QString &procRoot()
+{
+    static const QString root = [] {
+        const QString configured = readEnvironmentValue("ORBITAL_PROC_ROOT");
+        return configured.isEmpty() ? QStringLiteral("/proc") : QDir::cleanPath(configured);
+    }();
+    return root;
+}
+
+inline const QString &sysRoot()
+{
+    static const QString root = [] {
+        const QString configured = readEnvironmentValue("ORBITAL_SYS_ROOT");
+        return configured.isEmpty() ? QStringLiteral("/sys") : QDir::cleanPath(configured);
+    }();
+    return root;
+}
+
+// `relative` starts with a slash, e.g. procPath(QStringLiteral("/meminfo")).
+inline QString procPath(const QString &relative)
+{
+    return procRoot() + relative;
+}
+
+inline QString sysPath(const QString &relative)
+{
+    return sysRoot() + relative;
+}
+
+// CPU lists as sysfs prints them: ranges ("0-3,6" in cpu/online) or
+// space separated ("0 1 2 3" in cpufreq related_cpus).
+inline QVector<int> parseCpuList(QString text)
+{
+    text.replace(QLatin1Char(' '), QLatin1Char(','));
+    QVector<int> cpus;
+    for (const QString &part : text.trimmed().split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        const int dash = part.indexOf(QLatin1Char('-'));
+        bool firstOk = false;
+        bool lastOk = false;
+        const int first = part.left(dash < 0 ? part.size() : dash).toInt(&firstOk);
+        const int last = dash < 0 ? first : part.mid(dash + 1).toInt(&lastOk);
+        if (!firstOk || (dash >= 0 && !lastOk)) {
+            continue;
+        }
+
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.append(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+inline QString stateDirectory()
+{
+    const QString configuredDir = readEnvironmentValue("ORBITAL_STATE_DIR");
+    if (!configuredDir.isEmpty()) {
+        return QDir::cleanPath(configuredDir);
+    }
+
+    const QString xdgStateHome = readEnvironmentValue("XDG_STATE_HOME");
+    if (!xdgStateHome.isEmpty()) {
+        return QDir::cleanPath(xdgStateHome + QStringLiteral("/Orbital"));
+    }
+
+    return QDir::cleanPath(QDir::homePath() + QStringLiteral("/.local/state/Orbital"));
+}
+
 inline QString nextScreenshotFilePath()
 {
     const QString dirPath = screenshotDirectory();
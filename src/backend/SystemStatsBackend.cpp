@@ -1,48 +1,177 @@
 #include "SystemStatsBackend.h"
 
+#include "CounterRate.h"
+#include "DiskUsageSampler.h"
+#include "HistorySeries.h"
+#include "MetricScheduler.h"
+#include "MountTable.h"
+#include "NetlinkMonitor.h"
+#include "SampleCache.h"
 #include "SystemHelpers.h"
+#include "UeventMonitor.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
-#include <QNetworkAddressEntry>
-#include <QNetworkInterface>
-#include <QStorageInfo>
-#include <QTextStream>
-#include <QThread>
 
-SystemStatsBackend::SystemStatsBackend(QObject *parent)
+#include <cmath>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Time constant of the power-draw moving average.
+constexpr double kPowerSmoothingSec = 30.0;
+// Below this draw a time estimate would be meaningless.
+constexpr double kMinEstimatePowerW = 0.05;
+
+QString formatDuration(double hours)
+{
+    const int totalMinutes = static_cast<int>(std::lround(hours * 60.0));
+    return QStringLiteral("%1h %2m").arg(totalMinutes / 60).arg(totalMinutes % 60, 2, 10, QLatin1Char('0'));
+}
+
+} // namespace
+
+SystemStatsBackend::SystemStatsBackend(NetlinkMonitor *netlink, UeventMonitor *uevent, SampleCache *cache,
+                                       QObject *parent)
     : QObject(parent)
+    , m_cpuStats(Backend::historyCapacity())
+    , m_netlink(netlink)
+    , m_cache(cache)
+{
+    const int samples = Backend::historyCapacity();
+    m_cpuHistory = new HistorySeries(samples, this);
+    m_memHistory = new HistorySeries(samples, this);
+    m_netRxHistory = new HistorySeries(samples, this);
+    m_netTxHistory = new HistorySeries(samples, this);
+
+    m_mountTable = new MountTable(this);
+    m_diskSampler = new DiskUsageSampler(this);
+    connect(m_mountTable, &MountTable::mountsChanged, this, &SystemStatsBackend::updateMountPoints);
+    connect(m_diskSampler, &DiskUsageSampler::usageUpdated, this, [this]() {
+        if (readDiskInfo()) {
+            emit diskChanged();
+        }
+    });
+    updateMountPoints();
+
+    connect(m_netlink, &NetlinkMonitor::interfacesChanged, this, [this]() {
+        if (readNetworkInterfaceDetails()) {
+            emit netInterfacesChanged();
+        }
+    });
+    readNetworkInterfaceDetails();
+
+    // Status changes (charger plugged, battery full) arrive as power_supply
+    // uevents, so they show up immediately rather than on the next sample.
+    connect(uevent, &UeventMonitor::eventReceived, this, [this](const UeventMonitor::Event &event) {
+        if (event.subsystem != QLatin1String("power_supply")) {
+            return;
+        }
+
+        if (event.action == QLatin1String("add") || event.action == QLatin1String("remove")) {
+            closeBatteryFile();
+            m_batteryPath.clear();
+        }
+
+        if (readBatteryInfo()) {
+            emit batteryChanged();
+        }
+    });
+}
+
+SystemStatsBackend::~SystemStatsBackend()
 {
-    int coreCount = QThread::idealThreadCount();
-    if (coreCount < 1) {
-        coreCount = 1;
+    closeBatteryFile();
+}
+
+void SystemStatsBackend::registerCollectors(MetricScheduler *scheduler)
+{
+    scheduler->registerCollector(QStringLiteral("cpu"), [this]() { sampleCpu(); });
+    scheduler->registerCollector(QStringLiteral("memory"), [this]() { sampleMemory(); });
+    // Usage arrives asynchronously through DiskUsageSampler::usageUpdated.
+    scheduler->registerCollector(QStringLiteral("disk"), [this]() { m_diskSampler->sampleIfDue(); });
+    scheduler->registerCollector(QStringLiteral("battery"), [this]() {
+        if (readBatteryInfo()) {
+            emit batteryChanged();
+        }
+    });
+    scheduler->registerCollector(QStringLiteral("network"), [this]() { sampleNetwork(); });
+    scheduler->registerCollector(QStringLiteral("load"), [this]() {
+        if (readLoadAverage()) {
+            emit loadAverageChanged();
+        }
+    });
+}
+
+void SystemStatsBackend::sampleCpu()
+{
+    bool sampled = false;
+    const bool changed = readCpuInfo(&sampled);
+    // A baseline-only pass (first one, or across suspend) has no value of
+    // its own; repeating the old one would date it after the resume.
+    if (sampled) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        m_cpuHistory->append(static_cast<float>(m_cpuTotal * 100.0), now);
+        emit historySampled(QStringLiteral("cpu"), m_cpuTotal * 100.0, now);
     }
 
-    m_prevTotal.resize(coreCount + 1);
-    m_prevIdle.resize(coreCount + 1);
-    m_prevTotal.fill(0);
-    m_prevIdle.fill(0);
+    if (changed) {
+        emit cpuChanged();
+    }
+}
 
-    for (int i = 0; i < 60; ++i) {
-        m_cpuHistory.append(0.0);
-        m_memHistory.append(0.0);
-        m_netRxHistory.append(0.0);
-        m_netTxHistory.append(0.0);
+void SystemStatsBackend::sampleMemory()
+{
+    bool sampled = false;
+    const bool changed = readMemInfo(&sampled);
+    if (sampled) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        m_memHistory->append(static_cast<float>(m_memPercent * 100.0), now);
+        emit historySampled(QStringLiteral("mem"), m_memPercent * 100.0, now);
+    }
+
+    if (changed) {
+        emit memoryChanged();
     }
 }
 
-void SystemStatsBackend::update()
+void SystemStatsBackend::sampleNetwork()
 {
-    readMemInfo();
-    readCpuInfo();
-    readDiskInfo();
-    readBatteryInfo();
-    appendHistory(m_cpuHistory, m_cpuTotal * 100.0);
-    appendHistory(m_memHistory, m_memPercent * 100.0);
-    readNetworkInfo();
-    readLoadAverage();
-    readNetworkInterfaceDetails();
-    emit statsUpdated();
+    quint64 rxRate = 0;
+    quint64 txRate = 0;
+    if (!readNetworkInfo(rxRate, txRate)) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_netRxHistory->append(static_cast<float>(rxRate / 1024.0), now);
+    m_netTxHistory->append(static_cast<float>(txRate / 1024.0), now);
+    emit historySampled(QStringLiteral("netRx"), rxRate / 1024.0, now);
+    emit historySampled(QStringLiteral("netTx"), txRate / 1024.0, now);
+
+    const QString rxSpeed = Backend::formatSpeed(rxRate);
+    const QString txSpeed = Backend::formatSpeed(txRate);
+    if (rxSpeed == m_netRxSpeed && txSpeed == m_netTxSpeed) {
+        return;
+    }
+
+    m_netRxSpeed = rxSpeed;
+    m_netTxSpeed = txSpeed;
+    emit netSpeedChanged();
+}
+
+void SystemStatsBackend::updateMountPoints()
+{
+    QStringList mountPoints;
+    for (const MountTable::Entry &mount : m_mountTable->mounts()) {
+        mountPoints.append(mount.mountPoint);
+    }
+
+    m_diskSampler->setMountPoints(mountPoints);
 }
 
 double SystemStatsBackend::cpuTotal() const
@@ -55,6 +184,67 @@ QVariantList SystemStatsBackend::cpuCores() const
     return m_cpuCores;
 }
 
+QVector<double> SystemStatsBackend::cpuCoreUsage() const
+{
+    QVector<double> usage;
+    usage.reserve(m_cpuStats.cores().size());
+    for (const CpuStatTable::Cpu &cpu : m_cpuStats.cores()) {
+        usage.append(cpu.usage);
+    }
+    return usage;
+}
+
+QVariantMap SystemStatsBackend::cpuStates() const
+{
+    const double *shares = m_cpuStats.total().shares;
+    QVariantMap states;
+    states[QStringLiteral("user")] = shares[CpuStatTable::User];
+    states[QStringLiteral("nice")] = shares[CpuStatTable::Nice];
+    states[QStringLiteral("system")] = shares[CpuStatTable::System];
+    states[QStringLiteral("idle")] = shares[CpuStatTable::Idle];
+    states[QStringLiteral("iowait")] = shares[CpuStatTable::IoWait];
+    states[QStringLiteral("irq")] = shares[CpuStatTable::Irq];
+    states[QStringLiteral("softirq")] = shares[CpuStatTable::SoftIrq];
+    states[QStringLiteral("steal")] = shares[CpuStatTable::Steal];
+    states[QStringLiteral("guest")] = shares[CpuStatTable::Guest] + shares[CpuStatTable::GuestNice];
+    return states;
+}
+
+QVariantList SystemStatsBackend::cpuCoreStates() const
+{
+    // Built on demand: only the CPU details popup reads it.
+    QVariantList cores;
+    for (int core = 0; core < m_cpuStats.cores().size(); ++core) {
+        const CpuStatTable::Cpu &cpu = m_cpuStats.cores().at(core);
+        QVariantMap map;
+        map[QStringLiteral("core")] = core;
+        map[QStringLiteral("online")] = cpu.online;
+        map[QStringLiteral("usage")] = cpu.usage;
+        map[QStringLiteral("user")] = cpu.shares[CpuStatTable::User] + cpu.shares[CpuStatTable::Nice];
+        map[QStringLiteral("system")] = cpu.shares[CpuStatTable::System];
+        map[QStringLiteral("iowait")] = cpu.shares[CpuStatTable::IoWait];
+        map[QStringLiteral("irq")] = cpu.shares[CpuStatTable::Irq] + cpu.shares[CpuStatTable::SoftIrq];
+        map[QStringLiteral("steal")] = cpu.shares[CpuStatTable::Steal];
+        cores.append(map);
+    }
+    return cores;
+}
+
+QVariantList SystemStatsBackend::cpuHeatmap() const
+{
+    const int samples = m_cpuStats.historySize();
+    QVariantList rows;
+    for (int core = 0; core < m_cpuStats.cores().size(); ++core) {
+        QVariantList row;
+        row.reserve(samples);
+        for (int age = samples - 1; age >= 0; --age) {
+            row.append(m_cpuStats.historyAt(core, age));
+        }
+        rows.append(QVariant(row));
+    }
+    return rows;
+}
+
 double SystemStatsBackend::memPercent() const
 {
     return m_memPercent;
@@ -65,6 +255,16 @@ QString SystemStatsBackend::memDetail() const
     return m_memDetail;
 }
 
+qint64 SystemStatsBackend::memTotalBytes() const
+{
+    return m_memTotalBytes;
+}
+
+qint64 SystemStatsBackend::memAvailableBytes() const
+{
+    return m_memAvailableBytes;
+}
+
 double SystemStatsBackend::diskPercent() const
 {
     return m_diskPercent;
@@ -95,22 +295,27 @@ QVariantMap SystemStatsBackend::batDetails() const
     return m_batDetails;
 }
 
-QVariantList SystemStatsBackend::cpuHistory() const
+double SystemStatsBackend::batPowerWatts() const
+{
+    return m_smoothedPowerW;
+}
+
+HistorySeries *SystemStatsBackend::cpuHistory() const
 {
     return m_cpuHistory;
 }
 
-QVariantList SystemStatsBackend::memHistory() const
+HistorySeries *SystemStatsBackend::memHistory() const
 {
     return m_memHistory;
 }
 
-QVariantList SystemStatsBackend::netRxHistory() const
+HistorySeries *SystemStatsBackend::netRxHistory() const
 {
     return m_netRxHistory;
 }
 
-QVariantList SystemStatsBackend::netTxHistory() const
+HistorySeries *SystemStatsBackend::netTxHistory() const
 {
     return m_netTxHistory;
 }
@@ -130,37 +335,23 @@ QString SystemStatsBackend::loadAverage() const
     return m_loadAverage;
 }
 
-QVariantList SystemStatsBackend::netInterfaces() const
+QVector<double> SystemStatsBackend::loadAverages() const
 {
-    return m_netInterfaces;
+    return m_loadAverages;
 }
 
-void SystemStatsBackend::appendHistory(QVariantList &list, double newValue)
+QVariantList SystemStatsBackend::netInterfaces() const
 {
-    if (list.size() >= 60) {
-        list.removeFirst();
-    }
-
-    list.append(newValue);
+    return m_netInterfaces;
 }
 
-void SystemStatsBackend::readMemInfo()
+bool SystemStatsBackend::readMemInfo(bool *sampled)
 {
-    QFile file("/proc/meminfo");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return;
-    }
-
-    QTextStream in(&file);
+    const QByteArray content = m_cache->read(Backend::procPath(QStringLiteral("/meminfo")));
     long total = 0;
     long available = 0;
 
-    while (true) {
-        const QString line = in.readLine();
-        if (line.isNull()) {
-            break;
-        }
-
+    for (const QByteArray &line : content.split('\n')) {
         if (line.startsWith("MemTotal:")) {
             total = parseMemValue(line);
         } else if (line.startsWith("MemAvailable:")) {
@@ -168,18 +359,35 @@ void SystemStatsBackend::readMemInfo()
         }
     }
 
-    if (total > 0) {
-        const long used = total - available;
-        m_memPercent = static_cast<double>(used) / total;
-        m_memDetail = QString("%1 / %2 GB")
-                          .arg(QString::number(used / 1024.0 / 1024.0, 'f', 1))
-                          .arg(QString::number(total / 1024.0 / 1024.0, 'f', 1));
+    if (total <= 0) {
+        return false;
     }
+
+    if (sampled) {
+        *sampled = true;
+    }
+
+    m_memTotalBytes = static_cast<qint64>(total) * 1024;
+    m_memAvailableBytes = static_cast<qint64>(available) * 1024;
+
+    const long used = total - available;
+    const double memPercent = static_cast<double>(used) / total;
+    const QString memDetail = QString("%1 / %2 GB")
+                                  .arg(QString::number(used / 1024.0 / 1024.0, 'f', 1))
+                                  .arg(QString::number(total / 1024.0 / 1024.0, 'f', 1));
+
+    if (Backend::nearlyEqual(memPercent, m_memPercent) && memDetail == m_memDetail) {
+        return false;
+    }
+
+    m_memPercent = memPercent;
+    m_memDetail = memDetail;
+    return true;
 }
 
-long SystemStatsBackend::parseMemValue(const QString &line) const
+long SystemStatsBackend::parseMemValue(const QByteArray &line) const
 {
-    const QStringList parts = line.simplified().split(' ');
+    const QList<QByteArray> parts = line.simplified().split(' ');
     if (parts.size() >= 2) {
         return parts[1].toLong();
     }
@@ -187,108 +395,100 @@ long SystemStatsBackend::parseMemValue(const QString &line) const
     return 0;
 }
 
-void SystemStatsBackend::readCpuInfo()
+bool SystemStatsBackend::readCpuInfo(bool *sampled)
 {
-    QFile file("/proc/stat");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return;
+    const QByteArray content = m_cache->read(Backend::procPath(QStringLiteral("/stat")));
+    if (content.isEmpty()) {
+        return false;
     }
 
-    QTextStream in(&file);
-    QVariantList coresList;
-    int coreIndex = 0;
-
-    while (true) {
-        const QString line = in.readLine();
-        if (line.isNull()) {
-            break;
-        }
-
-        if (!line.startsWith("cpu")) {
-            break;
-        }
-
-        if (coreIndex >= m_prevTotal.size()) {
-            break;
-        }
-
-        const QStringList parts = line.simplified().split(' ');
-        if (parts.size() < 5) {
-            continue;
-        }
-
-        const long user = parts[1].toLong();
-        const long nice = parts[2].toLong();
-        const long system = parts[3].toLong();
-        const long idle = parts[4].toLong();
-        const long total = user + nice + system + idle;
-
-        const long diffTotal = total - m_prevTotal[coreIndex];
-        const long diffIdle = idle - m_prevIdle[coreIndex];
+    // Usage is a ratio of jiffies, but a pass across suspend would still
+    // average over time the user never saw; such a pass only rebases.
+    const bool hasInterval = m_cpuClock.restart() > 0.0;
+    if (!m_cpuStats.update(content, hasInterval)) {
+        return false;
+    }
 
-        double usage = 0.0;
-        if (diffTotal > 0) {
-            usage = static_cast<double>(diffTotal - diffIdle) / diffTotal;
-        }
+    if (sampled) {
+        *sampled = true;
+    }
 
-        m_prevTotal[coreIndex] = total;
-        m_prevIdle[coreIndex] = idle;
+    emit cpuDetailsChanged();
 
-        if (coreIndex == 0) {
-            m_cpuTotal = usage;
-        } else {
-            coresList.append(usage);
-        }
+    const double cpuTotal = m_cpuStats.total().usage;
+    // A short average steadies the per-core bars without hiding a core
+    // that stays pegged.
+    constexpr int kCoreSmoothingSamples = 3;
+    QVariantList coresList;
+    const int coreCount = m_cpuStats.cores().size();
+    coresList.reserve(coreCount);
+    for (int core = 0; core < coreCount; ++core) {
+        coresList.append(m_cpuStats.smoothedUsage(core, kCoreSmoothingSamples));
+    }
 
-        ++coreIndex;
+    if (Backend::nearlyEqual(cpuTotal, m_cpuTotal) && Backend::variantsNearlyEqual(coresList, m_cpuCores)) {
+        return false;
     }
 
+    m_cpuTotal = cpuTotal;
     m_cpuCores = coresList;
+    return true;
 }
 
-void SystemStatsBackend::readDiskInfo()
+bool SystemStatsBackend::readDiskInfo()
 {
     QVariantList partitions;
+    double diskPercent = m_diskPercent;
+    QString diskRootUsage = m_diskRootUsage;
 
-    for (const QStorageInfo &storage : QStorageInfo::mountedVolumes()) {
-        if (!storage.isValid() || !storage.isReady()) {
+    for (const MountTable::Entry &mount : m_mountTable->mounts()) {
+        if (!m_diskSampler->hasUsage(mount.mountPoint)) {
             continue;
         }
 
-        const QString fsType = QString::fromUtf8(storage.fileSystemType());
-        if (fsType.contains("tmpfs") || fsType.contains("proc") ||
-            fsType.contains("sysfs") || fsType.contains("overlay") ||
-            storage.bytesTotal() == 0) {
+        const DiskUsageSampler::Usage usage = m_diskSampler->usage(mount.mountPoint);
+        if (usage.totalBytes == 0 && !usage.stale) {
             continue;
         }
 
-        const double total = storage.bytesTotal();
-        const double avail = storage.bytesAvailable();
+        const double total = usage.totalBytes;
+        const double avail = usage.availableBytes;
         const double used = total - avail;
         const double percent = total > 0 ? (used / total) : 0.0;
 
         QVariantMap part;
-        part["device"] = QString::fromUtf8(storage.device());
-        part["mount"] = storage.rootPath();
-        part["type"] = fsType;
+        part["device"] = mount.device;
+        part["mount"] = mount.mountPoint;
+        part["type"] = mount.fsType;
         part["size"] = Backend::formatSize(total);
         part["used"] = Backend::formatSize(used);
         part["percent"] = percent;
+        part["totalBytes"] = static_cast<qint64>(usage.totalBytes);
+        part["availableBytes"] = static_cast<qint64>(usage.availableBytes);
+        part["stale"] = usage.stale;
         partitions.append(part);
 
-        if (storage.rootPath() == "/") {
-            m_diskPercent = percent;
-            m_diskRootUsage = Backend::formatSize(used) + " / " + Backend::formatSize(total);
+        if (mount.mountPoint == QLatin1String("/") && !usage.stale) {
+            diskPercent = percent;
+            diskRootUsage = Backend::formatSize(used) + " / " + Backend::formatSize(total);
         }
     }
 
+    if (Backend::nearlyEqual(diskPercent, m_diskPercent) && diskRootUsage == m_diskRootUsage
+        && Backend::variantsNearlyEqual(partitions, m_diskPartitions)) {
+        return false;
+    }
+
+    m_diskPercent = diskPercent;
+    m_diskRootUsage = diskRootUsage;
     m_diskPartitions = partitions;
+    return true;
 }
 
-void SystemStatsBackend::readBatteryInfo()
+bool SystemStatsBackend::readBatteryInfo()
 {
     if (m_batteryPath.isEmpty()) {
-        QDir dir("/sys/class/power_supply/");
+        QDir dir(Backend::sysPath(QStringLiteral("/class/power_supply")));
         const QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
         for (const QString &entry : entries) {
             const QString type = Backend::readTextFile(dir.filePath(entry) + "/type");
@@ -300,26 +500,30 @@ void SystemStatsBackend::readBatteryInfo()
     }
 
     if (m_batteryPath.isEmpty()) {
+        if (m_batState == QLatin1String("No Battery")) {
+            return false;
+        }
+
         m_batState = "No Battery";
-        return;
+        return true;
     }
 
-    const long capacity = Backend::readTextFile(m_batteryPath + "/capacity").toLong();
-    const QString status = Backend::readTextFile(m_batteryPath + "/status").trimmed();
-    const long voltageUv = Backend::readTextFile(m_batteryPath + "/voltage_now").toLong();
-    const long tempDeci = Backend::readTextFile(m_batteryPath + "/temp").toLong();
-    long energyFull = Backend::readTextFile(m_batteryPath + "/energy_full").toLong();
-    if (energyFull == 0) {
-        energyFull = Backend::readTextFile(m_batteryPath + "/charge_full").toLong();
+    const QHash<QString, QString> values = readBatteryUevent();
+    if (values.isEmpty()) {
+        return false;
     }
 
-    long energyDesign = Backend::readTextFile(m_batteryPath + "/energy_full_design").toLong();
-    if (energyDesign == 0) {
-        energyDesign = Backend::readTextFile(m_batteryPath + "/charge_full_design").toLong();
-    }
+    auto number = [&values](const char *key) {
+        return values.value(QLatin1String("POWER_SUPPLY_") + QLatin1String(key)).toLongLong();
+    };
 
-    m_batPercent = capacity;
-    m_batState = status;
+    const long capacity = static_cast<long>(number("CAPACITY"));
+    const QString status = values.value(QStringLiteral("POWER_SUPPLY_STATUS")).trimmed();
+    const qint64 voltageUv = number("VOLTAGE_NOW");
+    const qint64 tempDeci = number("TEMP");
+    const bool energyBased = values.contains(QStringLiteral("POWER_SUPPLY_ENERGY_FULL"));
+    const qint64 energyFull = energyBased ? number("ENERGY_FULL") : number("CHARGE_FULL");
+    const qint64 energyDesign = energyBased ? number("ENERGY_FULL_DESIGN") : number("CHARGE_FULL_DESIGN");
 
     QVariantMap details;
     details["Voltage"] = QString::number(voltageUv / 1000000.0, 'f', 2) + " V";
@@ -334,110 +538,176 @@ void SystemStatsBackend::readBatteryInfo()
         details["Health"] = "Unknown";
     }
 
-    details["Path"] = m_batteryPath;
-    m_batDetails = details;
-}
+    // Prefer the driver's own power reading; otherwise derive it from current
+    // and voltage. Drivers disagree on the sign of current while discharging.
+    qint64 powerUw = std::abs(number("POWER_NOW"));
+    if (powerUw == 0) {
+        powerUw = std::abs(number("CURRENT_NOW")) * voltageUv / 1000000;
+    }
 
-void SystemStatsBackend::readNetworkInfo()
-{
-    QFile file("/proc/net/dev");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return;
+    if (powerUw > 0) {
+        const double powerW = smoothedPowerWatts(powerUw / 1000000.0, status);
+        details["Power"] = QString::number(powerW, 'f', 2) + " W";
+
+        const double volts = voltageUv / 1000000.0;
+        const double nowWh = energyBased ? number("ENERGY_NOW") / 1000000.0
+                                         : number("CHARGE_NOW") / 1000000.0 * volts;
+        const double fullWh = energyBased ? energyFull / 1000000.0 : energyFull / 1000000.0 * volts;
+        if (powerW >= kMinEstimatePowerW && nowWh > 0.0) {
+            if (status == QLatin1String("Discharging")) {
+                details["Time to Empty"] = formatDuration(nowWh / powerW);
+            } else if (status == QLatin1String("Charging") && fullWh > nowWh) {
+                details["Time to Full"] = formatDuration((fullWh - nowWh) / powerW);
+            }
+        }
+    } else {
+        m_smoothedPowerW = -1.0;
     }
 
-    QTextStream in(&file);
-    in.readLine();
-    in.readLine();
+    details["Path"] = m_batteryPath;
 
-    quint64 totalRx = 0;
-    quint64 totalTx = 0;
+    if (capacity == m_batPercent && status == m_batState && details == m_batDetails) {
+        return false;
+    }
 
-    while (!in.atEnd()) {
-        const QString line = in.readLine().simplified();
-        const QStringList parts = line.split(' ');
-        if (parts.size() < 10) {
-            continue;
-        }
+    m_batPercent = capacity;
+    m_batState = status;
+    m_batDetails = details;
+    return true;
+}
 
-        const QString iface = parts[0];
-        if (iface.startsWith("lo") || iface.startsWith("tun") || iface.startsWith("bond")) {
-            continue;
+QHash<QString, QString> SystemStatsBackend::readBatteryUevent()
+{
+    // sysfs regenerates an attribute on every read from offset 0, so one
+    // cached fd and a single pread replace opening eight files per sample.
+    if (m_batteryFd < 0) {
+        m_batteryFd = ::open(QFile::encodeName(m_batteryPath + QStringLiteral("/uevent")).constData(),
+                             O_RDONLY | O_CLOEXEC);
+        if (m_batteryFd < 0) {
+            return {};
         }
+    }
 
-        QStringList cleanParts;
-        for (const QString &part : parts) {
-            if (part.contains(":") && part.length() > 1) {
-                const QStringList splitParts = part.split(":");
-                if (!splitParts[0].isEmpty()) {
-                    cleanParts.append(splitParts[0] + ":");
-                }
-
-                if (splitParts.size() > 1 && !splitParts[1].isEmpty()) {
-                    cleanParts.append(splitParts[1]);
-                }
-            } else {
-                cleanParts.append(part);
-            }
-        }
+    char buffer[4096];
+    const ssize_t bytes = ::pread(m_batteryFd, buffer, sizeof(buffer), 0);
+    if (bytes <= 0) {
+        // The supply went away underneath us; rediscover on the next sample.
+        closeBatteryFile();
+        m_batteryPath.clear();
+        return {};
+    }
 
-        if (cleanParts.size() > 9) {
-            totalRx += cleanParts[1].toULongLong();
-            totalTx += cleanParts[9].toULongLong();
+    QHash<QString, QString> values;
+    const QByteArray content(buffer, static_cast<int>(bytes));
+    for (const QByteArray &line : content.split('\n')) {
+        const int separator = line.indexOf('=');
+        if (separator > 0) {
+            values.insert(QString::fromLatin1(line.left(separator)), QString::fromUtf8(line.mid(separator + 1)));
         }
     }
 
-    if (m_prevTotalRx > 0) {
-        const quint64 diffRx = totalRx >= m_prevTotalRx ? (totalRx - m_prevTotalRx) : 0;
-        const quint64 diffTx = totalTx >= m_prevTotalTx ? (totalTx - m_prevTotalTx) : 0;
+    return values;
+}
 
-        appendHistory(m_netRxHistory, diffRx / 1024.0);
-        appendHistory(m_netTxHistory, diffTx / 1024.0);
+void SystemStatsBackend::closeBatteryFile()
+{
+    if (m_batteryFd >= 0) {
+        ::close(m_batteryFd);
+        m_batteryFd = -1;
+    }
+}
 
-        m_netRxSpeed = Backend::formatSpeed(diffRx);
-        m_netTxSpeed = Backend::formatSpeed(diffTx);
+double SystemStatsBackend::smoothedPowerWatts(double sampleWatts, const QString &status)
+{
+    // Exponential moving average with a time-based weight, so the estimate
+    // behaves the same whatever the battery collector's interval is. A status
+    // change restarts it since charge and discharge draws are unrelated.
+    if (m_smoothedPowerW < 0.0 || status != m_powerStatus || !m_powerClock.isValid()) {
+        m_smoothedPowerW = sampleWatts;
+        m_powerStatus = status;
+        m_powerClock.start();
+        return m_smoothedPowerW;
     }
 
-    m_prevTotalRx = totalRx;
-    m_prevTotalTx = totalTx;
+    const double elapsedSec = m_powerClock.restart() / 1000.0;
+    const double alpha = 1.0 - std::exp(-elapsedSec / kPowerSmoothingSec);
+    m_smoothedPowerW += alpha * (sampleWatts - m_smoothedPowerW);
+    return m_smoothedPowerW;
 }
 
-void SystemStatsBackend::readNetworkInterfaceDetails()
+bool SystemStatsBackend::readNetworkInfo(quint64 &rxRate, quint64 &txRate)
 {
-    QVariantList list;
-    const QList<QNetworkInterface> interfaces = QNetworkInterface::allInterfaces();
+    if (!m_cache->refreshNetCounters()) {
+        return false;
+    }
 
-    for (const QNetworkInterface &interface : interfaces) {
-        if (!interface.isValid()) {
+    quint64 totalRx = 0;
+    quint64 totalTx = 0;
+    for (const NetlinkMonitor::Link &link : m_netlink->links()) {
+        if (link.name.startsWith(QLatin1String("lo")) || link.name.startsWith(QLatin1String("tun"))
+            || link.name.startsWith(QLatin1String("bond"))) {
             continue;
         }
 
-        QVariantMap map;
-        map["name"] = interface.name();
-        map["mac"] = interface.hardwareAddress();
+        totalRx += link.rxBytes;
+        totalTx += link.txBytes;
+    }
+
+    // Rates are per second of monotonic time since the previous sample, since
+    // the collector interval depends on who is subscribed. A link going away
+    // lowers the totals; that pass only sets a new baseline.
+    const RateStamp stamp = RateStamp::now();
+    const bool rxSampled = m_netRxRate.sample(totalRx, stamp);
+    const bool sampled = m_netTxRate.sample(totalTx, stamp) && rxSampled;
+    if (sampled) {
+        rxRate = static_cast<quint64>(m_netRxRate.rate());
+        txRate = static_cast<quint64>(m_netTxRate.rate());
+    }
+
+    return sampled;
+}
 
-        const bool isUp = interface.flags().testFlag(QNetworkInterface::IsUp);
-        const bool isRunning = interface.flags().testFlag(QNetworkInterface::IsRunning);
-        map["state"] = (isUp && isRunning) ? "UP" : "DOWN";
+bool SystemStatsBackend::readNetworkInterfaceDetails()
+{
+    QVariantList list;
+    for (const NetlinkMonitor::Link &link : m_netlink->links()) {
+        QVariantMap map;
+        map["name"] = link.name;
+        map["mac"] = link.mac;
+        map["state"] = (link.up && link.running) ? "UP" : "DOWN";
 
         QStringList ipList;
-        for (const QNetworkAddressEntry &entry : interface.addressEntries()) {
-            ipList.append(entry.ip().toString());
+        for (const NetlinkMonitor::Address &address : m_netlink->addresses(link.index)) {
+            ipList.append(address.ip.toString());
         }
 
         map["ips"] = ipList;
         list.append(map);
     }
 
+    if (list == m_netInterfaces) {
+        return false;
+    }
+
     m_netInterfaces = list;
+    return true;
 }
 
-void SystemStatsBackend::readLoadAverage()
+bool SystemStatsBackend::readLoadAverage()
 {
-    const QString loadAvgRaw = Backend::readTextFile(QStringLiteral("/proc/loadavg"));
+    const QString loadAvgRaw = QString::fromLatin1(m_cache->read(Backend::procPath(QStringLiteral("/loadavg")))).trimmed();
     const QStringList parts = loadAvgRaw.split(QLatin1Char(' '), Qt::SkipEmptyParts);
     if (parts.size() < 3) {
-        return;
+        return false;
+    }
+
+    m_loadAverages = { parts.at(0).toDouble(), parts.at(1).toDouble(), parts.at(2).toDouble() };
+
+    const QString loadAverage = QStringLiteral("%1 / %2 / %3").arg(parts.at(0), parts.at(1), parts.at(2));
+    if (loadAverage == m_loadAverage) {
+        return false;
     }
 
-    m_loadAverage = QStringLiteral("%1 / %2 / %3").arg(parts.at(0), parts.at(1), parts.at(2));
+    m_loadAverage = loadAverage;
+    return true;
 }
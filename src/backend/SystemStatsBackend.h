@@ -1,56 +1,116 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QVariantList>
 #include <QVariantMap>
 #include <QVector>
 
+#include "CounterRate.h"
+#include "CpuStatTable.h"
+
+class DiskUsageSampler;
+class HistorySeries;
+class MetricScheduler;
+class MountTable;
+class NetlinkMonitor;
+class SampleCache;
+class UeventMonitor;
+
 class SystemStatsBackend : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit SystemStatsBackend(QObject *parent = nullptr);
+    SystemStatsBackend(NetlinkMonitor *netlink, UeventMonitor *uevent, SampleCache *cache,
+                       QObject *parent = nullptr);
+    ~SystemStatsBackend() override;
 
-    void update();
+    // Registers one collector per metric group ("cpu", "memory", "disk",
+    // "battery", "network", "load"). The interface list is event-driven.
+    void registerCollectors(MetricScheduler *scheduler);
 
     double cpuTotal() const;
+    // Busy fraction per core, averaged over the last few samples.
     QVariantList cpuCores() const;
+    // Busy fraction per core over the last interval only.
+    QVector<double> cpuCoreUsage() const;
+    // Share of all CPU time per state over the last interval: user, nice,
+    // system, idle, iowait, irq, softirq, steal, guest.
+    QVariantMap cpuStates() const;
+    // Per core: { core, online, usage, user, system, iowait, irq, steal },
+    // where irq includes softirq.
+    QVariantList cpuCoreStates() const;
+    // Per core, the recent busy percentages (0-100), oldest first.
+    QVariantList cpuHeatmap() const;
     double memPercent() const;
     QString memDetail() const;
+    qint64 memTotalBytes() const;
+    qint64 memAvailableBytes() const;
     double diskPercent() const;
     QString diskRootUsage() const;
     QVariantList diskPartitions() const;
     int batPercent() const;
     QString batState() const;
     QVariantMap batDetails() const;
-    QVariantList cpuHistory() const;
-    QVariantList memHistory() const;
-    QVariantList netRxHistory() const;
-    QVariantList netTxHistory() const;
+    // Smoothed draw in watts, or a negative value when unknown.
+    double batPowerWatts() const;
+    HistorySeries *cpuHistory() const;
+    HistorySeries *memHistory() const;
+    HistorySeries *netRxHistory() const;
+    HistorySeries *netTxHistory() const;
     QString netRxSpeed() const;
     QString netTxSpeed() const;
     QString loadAverage() const;
+    // 1, 5 and 15 minute load; empty until the "load" collector ran.
+    QVector<double> loadAverages() const;
     QVariantList netInterfaces() const;
 
 signals:
-    void statsUpdated();
+    void cpuChanged();
+    // Every sample; cpuChanged() is only emitted on visible change.
+    void cpuDetailsChanged();
+    // A new value was added to one of the history series ("cpu", "mem",
+    // "netRx", "netTx"). Passes that only set a baseline add nothing.
+    void historySampled(const QString &metric, double value, qint64 timestampMs);
+    void memoryChanged();
+    void diskChanged();
+    void batteryChanged();
+    void netSpeedChanged();
+    void loadAverageChanged();
+    void netInterfacesChanged();
 
 private:
-    void appendHistory(QVariantList &list, double newValue);
-    void readMemInfo();
-    long parseMemValue(const QString &line) const;
-    void readCpuInfo();
-    void readDiskInfo();
-    void readBatteryInfo();
-    void readNetworkInfo();
-    void readNetworkInterfaceDetails();
-    void readLoadAverage();
+    // bench/collector_bench.cpp times the individual read* passes.
+    friend class CollectorBench;
+
+    void sampleCpu();
+    void sampleMemory();
+    void sampleNetwork();
+    void updateMountPoints();
+
+    // `sampled` is set when /proc/meminfo yielded a usable MemTotal.
+    bool readMemInfo(bool *sampled = nullptr);
+    long parseMemValue(const QByteArray &line) const;
+    // `sampled` is set when the pass produced a new usage value rather than
+    // only a baseline.
+    bool readCpuInfo(bool *sampled = nullptr);
+    bool readDiskInfo();
+    bool readBatteryInfo();
+    QHash<QString, QString> readBatteryUevent();
+    void closeBatteryFile();
+    double smoothedPowerWatts(double sampleWatts, const QString &status);
+    bool readNetworkInfo(quint64 &rxRate, quint64 &txRate);
+    bool readNetworkInterfaceDetails();
+    bool readLoadAverage();
 
     double m_cpuTotal = 0;
     QVariantList m_cpuCores;
     double m_memPercent = 0;
     QString m_memDetail;
+    qint64 m_memTotalBytes = 0;
+    qint64 m_memAvailableBytes = 0;
     double m_diskPercent = 0;
     QString m_diskRootUsage;
     QVariantList m_diskPartitions;
@@ -58,18 +118,28 @@ private:
     QString m_batState = "Unknown";
     QVariantMap m_batDetails;
 
-    QVector<long> m_prevTotal;
-    QVector<long> m_prevIdle;
-    quint64 m_prevTotalRx = 0;
-    quint64 m_prevTotalTx = 0;
+    CpuStatTable m_cpuStats;
+    RateClock m_cpuClock;
+    NetlinkMonitor *m_netlink = nullptr;
+    SampleCache *m_cache = nullptr;
+    MountTable *m_mountTable = nullptr;
+    DiskUsageSampler *m_diskSampler = nullptr;
+
+    CounterRate m_netRxRate;
+    CounterRate m_netTxRate;
 
-    QVariantList m_cpuHistory;
-    QVariantList m_memHistory;
-    QVariantList m_netRxHistory;
-    QVariantList m_netTxHistory;
+    HistorySeries *m_cpuHistory = nullptr;
+    HistorySeries *m_memHistory = nullptr;
+    HistorySeries *m_netRxHistory = nullptr;
+    HistorySeries *m_netTxHistory = nullptr;
     QString m_netRxSpeed = "0 B/s";
     QString m_netTxSpeed = "0 B/s";
     QString m_loadAverage = "0.00 / 0.00 / 0.00";
+    QVector<double> m_loadAverages;
     QVariantList m_netInterfaces;
     QString m_batteryPath;
+    int m_batteryFd = -1;
+    double m_smoothedPowerW = -1.0;
+    QString m_powerStatus;
+    QElapsedTimer m_powerClock;
 };
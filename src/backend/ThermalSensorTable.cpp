@@ -0,0 +1,238 @@
+#include "ThermalSensorTable.h"
+
+#include "SystemHelpers.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+double tempToCelsius(qint64 tempRaw)
+{
+    return std::llabs(tempRaw) >= 1000 ? (tempRaw / 1000.0) : static_cast<double>(tempRaw);
+}
+
+QString thermalColorForName(const QString &name)
+{
+    const QString lower = name.toLower();
+    if (lower.contains(QStringLiteral("cpu"))) {
+        return QStringLiteral("#7FB59A");
+    }
+
+    if (lower.contains(QStringLiteral("gpu"))) {
+        return QStringLiteral("#A893CC");
+    }
+
+    if (lower.contains(QStringLiteral("mem")) || lower.contains(QStringLiteral("ebi"))) {
+        return QStringLiteral("#7FAACC");
+    }
+
+    if (lower.contains(QStringLiteral("wlan")) || lower.contains(QStringLiteral("modem"))
+        || lower.contains(QStringLiteral("q6"))) {
+        return QStringLiteral("#7FB7B5");
+    }
+
+    if (lower.contains(QStringLiteral("camera")) || lower.contains(QStringLiteral("video"))) {
+        return QStringLiteral("#C7A784");
+    }
+
+    if (lower.contains(QStringLiteral("charger")) || lower.contains(QStringLiteral("battery"))
+        || lower.contains(QStringLiteral("pm"))) {
+        return QStringLiteral("#CBB07E");
+    }
+
+    return QStringLiteral("#B9A98E");
+}
+
+void appendTrip(QVector<ThermalSensorTable::TripPoint> &trips, const QString &type, const QString &path)
+{
+    const qint64 tempRaw = Backend::readTextFile(path).toLongLong();
+    if (tempRaw > 0) {
+        trips.append({ type, tempToCelsius(tempRaw) });
+    }
+}
+
+QVector<ThermalSensorTable::TripPoint> readZoneTrips(const QString &zonePath)
+{
+    QVector<ThermalSensorTable::TripPoint> trips;
+    for (int index = 0;; ++index) {
+        const QString prefix = QStringLiteral("%1/trip_point_%2_").arg(zonePath).arg(index);
+        const QString type = Backend::readTextFile(prefix + QStringLiteral("type"));
+        if (type.isEmpty()) {
+            break;
+        }
+
+        appendTrip(trips, type, prefix + QStringLiteral("temp"));
+    }
+
+    return trips;
+}
+
+struct Candidate {
+    QString key;
+    QString name;
+    QString inputPath;
+    QVector<ThermalSensorTable::TripPoint> trips;
+};
+
+} // namespace
+
+ThermalSensorTable::~ThermalSensorTable()
+{
+    closeAll();
+}
+
+void ThermalSensorTable::refresh()
+{
+    if (!m_discovered) {
+        discover();
+    }
+
+    char buffer[32];
+    for (Sensor &sensor : m_sensors) {
+        sensor.valid = false;
+        if (sensor.fd < 0) {
+            continue;
+        }
+
+        const ssize_t length = ::pread(sensor.fd, buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0) {
+            continue;
+        }
+
+        buffer[length] = '\0';
+        const qint64 tempRaw = std::strtoll(buffer, nullptr, 10);
+        if (tempRaw <= 0) {
+            continue;
+        }
+
+        sensor.tempC = tempToCelsius(tempRaw);
+        sensor.valid = sensor.tempC > 0.0;
+    }
+}
+
+void ThermalSensorTable::invalidate()
+{
+    m_discovered = false;
+}
+
+const QVector<ThermalSensorTable::Sensor> &ThermalSensorTable::sensors() const
+{
+    return m_sensors;
+}
+
+void ThermalSensorTable::discover()
+{
+    closeAll();
+    m_discovered = true;
+
+    // Thermal zones carry the trip points; a zone whose type matches a hwmon
+    // name (thermal_hwmon exports them that way) lends them to its sensor.
+    QVector<Candidate> zones;
+    QHash<QString, QVector<TripPoint>> zoneTrips;
+    const QDir thermalDir(Backend::sysPath(QStringLiteral("/class/thermal")));
+    const QStringList thermalEntries = thermalDir.entryList(QStringList() << QStringLiteral("thermal_zone*"),
+                                                            QDir::Dirs | QDir::NoDotAndDotDot,
+                                                            QDir::Name);
+    for (const QString &entryName : thermalEntries) {
+        const QString zonePath = thermalDir.filePath(entryName);
+        const QString type = Backend::readTextFile(zonePath + QStringLiteral("/type"));
+        if (type.isEmpty()) {
+            continue;
+        }
+
+        const QVector<TripPoint> trips = readZoneTrips(zonePath);
+        zones.append({ entryName, type, zonePath + QStringLiteral("/temp"), trips });
+        if (!zoneTrips.contains(type)) {
+            zoneTrips.insert(type, trips);
+        }
+    }
+
+    QVector<Candidate> candidates;
+    const QDir hwmonDir(Backend::sysPath(QStringLiteral("/class/hwmon")));
+    const QStringList hwmonEntries = hwmonDir.entryList(QStringList() << QStringLiteral("hwmon*"),
+                                                        QDir::Dirs | QDir::NoDotAndDotDot,
+                                                        QDir::Name);
+    for (const QString &entryName : hwmonEntries) {
+        const QString hwmonPath = hwmonDir.filePath(entryName);
+        const QString baseName = Backend::readTextFile(hwmonPath + QStringLiteral("/name"));
+        if (baseName.isEmpty()) {
+            continue;
+        }
+
+        const QDir sensorDir(hwmonPath);
+        const QStringList tempInputs = sensorDir.entryList(QStringList() << QStringLiteral("temp*_input"),
+                                                           QDir::Files,
+                                                           QDir::Name);
+        for (const QString &tempInput : tempInputs) {
+            const QString sensorIndex = tempInput.mid(4, tempInput.size() - 10);
+            const QString prefix = sensorDir.filePath(QStringLiteral("temp%1_").arg(sensorIndex));
+
+            QString displayName = baseName;
+            const QString label = Backend::readTextFile(prefix + QStringLiteral("label"));
+            if (!label.isEmpty()) {
+                displayName = QStringLiteral("%1 / %2").arg(baseName, label);
+            }
+
+            QVector<TripPoint> trips = zoneTrips.value(baseName);
+            appendTrip(trips, QStringLiteral("max"), prefix + QStringLiteral("max"));
+            appendTrip(trips, QStringLiteral("critical"), prefix + QStringLiteral("crit"));
+            candidates.append({ QStringLiteral("%1:%2").arg(entryName, tempInput), displayName,
+                                sensorDir.filePath(tempInput), trips });
+        }
+    }
+
+    if (candidates.isEmpty()) {
+        candidates = zones;
+    }
+
+    QHash<QString, int> nameCounts;
+    for (const Candidate &candidate : std::as_const(candidates)) {
+        nameCounts[candidate.name] += 1;
+    }
+
+    m_sensors.reserve(candidates.size());
+    for (Candidate &candidate : candidates) {
+        const QByteArray path = QFile::encodeName(candidate.inputPath);
+        const int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+
+        Sensor sensor;
+        sensor.key = candidate.key;
+        sensor.name = nameCounts.value(candidate.name) > 1
+                          ? QStringLiteral("%1 (%2)").arg(candidate.name, candidate.key)
+                          : candidate.name;
+        sensor.color = thermalColorForName(candidate.name);
+        sensor.trips = std::move(candidate.trips);
+        std::sort(sensor.trips.begin(), sensor.trips.end(), [](const TripPoint &left, const TripPoint &right) {
+            return left.tempC < right.tempC;
+        });
+        sensor.fd = fd;
+        m_sensors.append(sensor);
+    }
+
+    std::sort(m_sensors.begin(), m_sensors.end(), [](const Sensor &left, const Sensor &right) {
+        return left.name < right.name;
+    });
+}
+
+void ThermalSensorTable::closeAll()
+{
+    for (Sensor &sensor : m_sensors) {
+        if (sensor.fd >= 0) {
+            ::close(sensor.fd);
+        }
+    }
+
+    m_sensors.clear();
+}
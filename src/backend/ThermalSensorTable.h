@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// Temperature sensors discovered once from /sys/class/hwmon (or the thermal
+// zones when no hwmon device reports a temperature). Discovery resolves
+// labels, display names and colours and keeps each input file open; later
+// refreshes only pread the raw values. Call invalidate() when hwmon or
+// thermal devices change and the next refresh rediscovers.
+class ThermalSensorTable
+{
+public:
+    struct TripPoint {
+        QString type;
+        double tempC = 0.0;
+    };
+
+    struct Sensor {
+        QString key;
+        QString name;
+        QString color;
+        // Sorted by temperature; from the matching thermal zone and the
+        // hwmon max/crit attributes.
+        QVector<TripPoint> trips;
+        double tempC = 0.0;
+        bool valid = false;
+
+        int fd = -1;
+    };
+
+    ThermalSensorTable() = default;
+    ~ThermalSensorTable();
+
+    ThermalSensorTable(const ThermalSensorTable &) = delete;
+    ThermalSensorTable &operator=(const ThermalSensorTable &) = delete;
+
+    void refresh();
+    void invalidate();
+
+    const QVector<Sensor> &sensors() const;
+
+private:
+    void discover();
+    void closeAll();
+
+    QVector<Sensor> m_sensors;
+    bool m_discovered = false;
+};
@@ -0,0 +1,353 @@
+#include "ThreadPolicy.h"
+
+#include "SystemHelpers.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QQuickWindow>
+#include <QTimer>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+// Catches threads started or replaced after the last scan.
+constexpr int kRescanIntervalMs = 10000;
+// Thread names are cut to 15 bytes by the kernel.
+constexpr int kThreadNameLength = 15;
+
+QString roleSetting(const QString &role, const char *key, const QString &fallback)
+{
+    const QByteArray name = "ORBITAL_THREAD_" + role.toUpper().toLatin1() + '_' + key;
+    const QString value = Backend::readEnvironmentValue(name.constData());
+    return value.isEmpty() ? fallback : value;
+}
+
+int schedPolicyFromName(const QString &name)
+{
+    if (name == QLatin1String("idle")) {
+        return SCHED_IDLE;
+    }
+    if (name == QLatin1String("batch")) {
+        return SCHED_BATCH;
+    }
+    if (name == QLatin1String("other")) {
+        return SCHED_OTHER;
+    }
+
+    return -1;
+}
+
+QString schedPolicyName(int policy)
+{
+    switch (policy) {
+    case SCHED_OTHER:
+        return QStringLiteral("other");
+    case SCHED_BATCH:
+        return QStringLiteral("batch");
+    case SCHED_IDLE:
+        return QStringLiteral("idle");
+    case SCHED_FIFO:
+        return QStringLiteral("fifo");
+    case SCHED_RR:
+        return QStringLiteral("rr");
+    default:
+        return QStringLiteral("?");
+    }
+}
+
+// "0-3,6" style, as the kernel prints CPU lists.
+QString formatCpuList(const QVector<int> &cpus)
+{
+    QStringList parts;
+    for (int index = 0; index < cpus.size();) {
+        int end = index;
+        while (end + 1 < cpus.size() && cpus.at(end + 1) == cpus.at(end) + 1) {
+            ++end;
+        }
+
+        parts.append(end == index ? QString::number(cpus.at(index))
+                                  : QStringLiteral("%1-%2").arg(cpus.at(index)).arg(cpus.at(end)));
+        index = end + 1;
+    }
+
+    return parts.join(QLatin1Char(','));
+}
+
+QString threadName(int tid)
+{
+    return Backend::readTextFile(QStringLiteral("/proc/self/task/%1/comm").arg(tid));
+}
+
+} // namespace
+
+ThreadPolicy::ThreadPolicy(QObject *parent)
+    : QObject(parent)
+    , m_rescanTimer(new QTimer(this))
+{
+    m_enabled = Backend::readEnvironmentValue("ORBITAL_THREAD_POLICY") != QLatin1String("0");
+    discoverTopology();
+    configureRoles();
+
+    if (!m_enabled) {
+        return;
+    }
+
+    m_rescanTimer->setInterval(kRescanIntervalMs);
+    connect(m_rescanTimer, &QTimer::timeout, this, &ThreadPolicy::rescan);
+    m_rescanTimer->start();
+    rescan();
+}
+
+bool ThreadPolicy::enabled() const
+{
+    return m_enabled;
+}
+
+bool ThreadPolicy::heterogeneous() const
+{
+    return m_heterogeneous;
+}
+
+QVariantList ThreadPolicy::topology() const
+{
+    QVariantList cores;
+    for (const Core &core : m_cores) {
+        QVariantMap map;
+        map[QStringLiteral("cpu")] = core.cpu;
+        map[QStringLiteral("capacity")] = core.capacity;
+        map[QStringLiteral("big")] = core.big;
+        cores.append(map);
+    }
+
+    return cores;
+}
+
+QVariantList ThreadPolicy::placements() const
+{
+    QVector<Placement> sorted = m_placements.values();
+    std::sort(sorted.begin(), sorted.end(), [](const Placement &left, const Placement &right) {
+        return left.role != right.role ? left.role < right.role : left.tid < right.tid;
+    });
+
+    QVariantList placements;
+    for (const Placement &placement : std::as_const(sorted)) {
+        QVariantMap map;
+        map[QStringLiteral("role")] = placement.role;
+        map[QStringLiteral("tid")] = placement.tid;
+        map[QStringLiteral("name")] = placement.name;
+        map[QStringLiteral("cpus")] = placement.cpus;
+        map[QStringLiteral("policy")] = placement.policy;
+        map[QStringLiteral("nice")] = placement.nice;
+        map[QStringLiteral("error")] = placement.error;
+        placements.append(map);
+    }
+
+    return placements;
+}
+
+void ThreadPolicy::trackWindow(QObject *window)
+{
+    auto *quickWindow = qobject_cast<QQuickWindow *>(window);
+    if (!quickWindow || !m_enabled) {
+        return;
+    }
+
+    // Emitted on the render thread; the scan itself runs here.
+    connect(quickWindow, &QQuickWindow::sceneGraphInitialized, this, &ThreadPolicy::rescan,
+            Qt::QueuedConnection);
+}
+
+void ThreadPolicy::rescan()
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    const QDir taskDir(QStringLiteral("/proc/self/task"));
+    QHash<int, Placement> placements;
+    bool changed = false;
+    for (const QString &entry : taskDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        bool ok = false;
+        const int tid = entry.toInt(&ok);
+        if (!ok) {
+            continue;
+        }
+
+        const QString name = threadName(tid);
+        const auto known = m_placements.constFind(tid);
+        // The same name under a known tid is the same thread.
+        if (known != m_placements.constEnd() && known->name == name) {
+            placements.insert(tid, *known);
+            continue;
+        }
+
+        const Role *role = roleForThread(tid, name);
+        if (!role) {
+            continue;
+        }
+
+        const Placement placement = place(*role, tid, name);
+        if (placement.error.isEmpty()) {
+            qDebug() << "Thread policy:" << placement.role << placement.name << "tid" << tid
+                     << "cpus" << placement.cpus << placement.policy << "nice" << placement.nice;
+        } else {
+            qWarning() << "Thread policy:" << placement.role << placement.name << "tid" << tid
+                       << placement.error;
+        }
+        placements.insert(tid, placement);
+        changed = true;
+    }
+
+    if (changed || placements.size() != m_placements.size()) {
+        m_placements = placements;
+        emit placementsChanged();
+    }
+}
+
+void ThreadPolicy::discoverTopology()
+{
+    const QVector<int> present = Backend::parseCpuList(
+        Backend::readTextFile(Backend::sysPath(QStringLiteral("/devices/system/cpu/present"))));
+
+    int minCapacity = 0;
+    int maxCapacity = 0;
+    for (int cpu : present) {
+        Core core;
+        core.cpu = cpu;
+        // Only present on asymmetric (and some DT based) systems.
+        core.capacity = Backend::readTextFile(
+            Backend::sysPath(QStringLiteral("/devices/system/cpu/cpu%1/cpu_capacity").arg(cpu))).toInt();
+        minCapacity = m_cores.isEmpty() ? core.capacity : std::min(minCapacity, core.capacity);
+        maxCapacity = std::max(maxCapacity, core.capacity);
+        m_cores.append(core);
+    }
+
+    // With three tiers (prime, big, little) both upper tiers count as big.
+    m_heterogeneous = minCapacity > 0 && maxCapacity > minCapacity;
+    for (Core &core : m_cores) {
+        core.big = !m_heterogeneous || core.capacity > minCapacity;
+    }
+}
+
+void ThreadPolicy::configureRoles()
+{
+    const auto makeRole = [this](const QString &name, const QString &threadNames, const QString &cpus,
+                                 const QString &nice, const QString &sched) {
+        Role role;
+        role.name = name;
+        role.threadNames = roleSetting(name, "NAMES", threadNames).split(QLatin1Char(','), Qt::SkipEmptyParts);
+        for (QString &pattern : role.threadNames) {
+            pattern = pattern.trimmed().left(kThreadNameLength);
+        }
+
+        role.cpus = resolveCpus(roleSetting(name, "CPUS", cpus));
+        role.nice = std::clamp(roleSetting(name, "NICE", nice).toInt(&role.changeNice), -20, 19);
+        role.schedPolicy = schedPolicyFromName(roleSetting(name, "SCHED", sched));
+        return role;
+    };
+
+    m_roles = {
+        makeRole(QStringLiteral("gui"), QString(), QString(), QString(), QString()),
+        makeRole(QStringLiteral("render"), QStringLiteral("QSGRenderThread"), QStringLiteral("big"),
+                 QString(), QString()),
+        makeRole(QStringLiteral("sampler"), QStringLiteral("DiskUsageSampler"), QStringLiteral("little"),
+                 QStringLiteral("10"), QStringLiteral("idle")),
+    };
+}
+
+QVector<int> ThreadPolicy::resolveCpus(const QString &setting) const
+{
+    QVector<int> cpus;
+    if (setting.isEmpty()) {
+        return cpus;
+    }
+
+    if (setting == QLatin1String("big") || setting == QLatin1String("little") || setting == QLatin1String("all")) {
+        const bool wantBig = setting == QLatin1String("big");
+        for (const Core &core : m_cores) {
+            if (setting == QLatin1String("all") || !m_heterogeneous || core.big == wantBig) {
+                cpus.append(core.cpu);
+            }
+        }
+        return cpus;
+    }
+
+    return Backend::parseCpuList(setting);
+}
+
+const ThreadPolicy::Role *ThreadPolicy::roleForThread(int tid, const QString &name) const
+{
+    for (const Role &role : m_roles) {
+        if (role.name == QLatin1String("gui")) {
+            if (tid == ::getpid()) {
+                return &role;
+            }
+            continue;
+        }
+
+        for (const QString &pattern : role.threadNames) {
+            if (name.startsWith(pattern)) {
+                return &role;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+ThreadPolicy::Placement ThreadPolicy::place(const Role &role, int tid, const QString &name) const
+{
+    Placement placement;
+    placement.role = role.name;
+    placement.tid = tid;
+    placement.name = name;
+
+    QStringList errors;
+    if (!role.cpus.isEmpty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : role.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (::sched_setaffinity(tid, sizeof(set), &set) != 0) {
+            errors.append(QStringLiteral("affinity: %1").arg(QString::fromLocal8Bit(std::strerror(errno))));
+        }
+    }
+
+    if (role.schedPolicy >= 0) {
+        sched_param param {};
+        if (::sched_setscheduler(tid, role.schedPolicy, &param) != 0) {
+            errors.append(QStringLiteral("policy: %1").arg(QString::fromLocal8Bit(std::strerror(errno))));
+        }
+    }
+
+    if (role.changeNice && ::setpriority(PRIO_PROCESS, static_cast<id_t>(tid), role.nice) != 0) {
+        errors.append(QStringLiteral("nice: %1").arg(QString::fromLocal8Bit(std::strerror(errno))));
+    }
+
+    // Report what the kernel ended up with, not what was asked for.
+    cpu_set_t applied;
+    CPU_ZERO(&applied);
+    if (::sched_getaffinity(tid, sizeof(applied), &applied) == 0) {
+        QVector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &applied)) {
+                cpus.append(cpu);
+            }
+        }
+        placement.cpus = formatCpuList(cpus);
+    }
+
+    placement.policy = schedPolicyName(::sched_getscheduler(tid));
+    errno = 0;
+    placement.nice = ::getpriority(PRIO_PROCESS, static_cast<id_t>(tid));
+    placement.error = errors.join(QStringLiteral("; "));
+    return placement;
+}
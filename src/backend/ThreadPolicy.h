@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+class QTimer;
+
+// Places Orbital's threads on the CPU topology. Core capacities come from
+// /sys/devices/system/cpu/cpu*/cpu_capacity: cores above the smallest
+// capacity count as big, the rest as little. Threads are found by name in
+// /proc/self/task, so threads created later (or restarted, like the disk
+// sampler after a hung statvfs) are picked up on the next scan.
+//
+// Roles and their defaults, each overridable from the environment:
+//   render   QSGRenderThread        big cores   (ORBITAL_THREAD_RENDER_CPUS)
+//   gui      the main thread        untouched   (ORBITAL_THREAD_GUI_CPUS)
+//   sampler  DiskUsageSampler, ...  little cores, nice 10, SCHED_IDLE
+//            (ORBITAL_THREAD_SAMPLER_CPUS, _NICE, _SCHED, _NAMES)
+// A CPU setting is "big", "little", "all" or a list such as "4-7".
+// ORBITAL_THREAD_POLICY=0 leaves every thread alone.
+class ThreadPolicy : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ enabled CONSTANT)
+    // False on symmetric systems; big/little settings then mean all cores.
+    Q_PROPERTY(bool heterogeneous READ heterogeneous CONSTANT)
+    Q_PROPERTY(QVariantList topology READ topology CONSTANT)
+    // One entry per placed thread: role, tid, name, cpus, policy, nice, error.
+    Q_PROPERTY(QVariantList placements READ placements NOTIFY placementsChanged)
+
+public:
+    explicit ThreadPolicy(QObject *parent = nullptr);
+
+    bool enabled() const;
+    bool heterogeneous() const;
+    QVariantList topology() const;
+    QVariantList placements() const;
+
+    // Rescans once the scene graph of `window` (a QQuickWindow) is up, which
+    // is when the threaded render loop has started its render thread.
+    Q_INVOKABLE void trackWindow(QObject *window);
+
+public slots:
+    void rescan();
+
+signals:
+    void placementsChanged();
+
+private:
+    struct Core {
+        int cpu = 0;
+        int capacity = 0;
+        bool big = false;
+    };
+
+    struct Role {
+        QString name;
+        QStringList threadNames;
+        // Empty leaves the affinity alone.
+        QVector<int> cpus;
+        // Only applied when changeNice is set.
+        int nice = 0;
+        bool changeNice = false;
+        // SCHED_OTHER, SCHED_BATCH or SCHED_IDLE; -1 leaves it alone.
+        int schedPolicy = -1;
+    };
+
+    struct Placement {
+        QString role;
+        int tid = 0;
+        QString name;
+        QString cpus;
+        QString policy;
+        int nice = 0;
+        QString error;
+    };
+
+    void discoverTopology();
+    void configureRoles();
+    QVector<int> resolveCpus(const QString &setting) const;
+    const Role *roleForThread(int tid, const QString &name) const;
+    Placement place(const Role &role, int tid, const QString &name) const;
+
+    QVector<Core> m_cores;
+    QVector<Role> m_roles;
+    // tid -> placement; tids of exited threads are dropped on each scan.
+    QHash<int, Placement> m_placements;
+    QTimer *m_rescanTimer = nullptr;
+    bool m_enabled = true;
+    bool m_heterogeneous = false;
+};
@@ -0,0 +1,556 @@
+#include "TimeSeriesStore.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kRingMagic[8] = { 'O', 'R', 'B', 'T', 'S', 'R', '1', '\0' };
+constexpr quint32 kRingVersion = 1;
+
+constexpr qint64 kMinuteMs = 60 * 1000;
+constexpr qint64 kHourMs = 60 * kMinuteMs;
+
+// Raw 1 s samples for 6 hours, minute rollups for 7 days, hourly rollups
+// for 180 days. Roughly 1.4 MB per metric on disk.
+constexpr quint32 kRawCapacity = 6 * 3600;
+constexpr quint32 kMinuteCapacity = 7 * 24 * 60;
+constexpr quint32 kHourCapacity = 180 * 24;
+
+// A ring is picked for a query if it needs at most this many buckets per
+// requested point; the result is then merged down to maxPoints.
+constexpr int kMaxMergeFactor = 8;
+
+struct RingHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 recordSize;
+    quint32 capacity;
+    quint32 resolutionSec;
+    quint64 nextSeq;
+    quint8 reserved[32];
+};
+static_assert(sizeof(RingHeader) == 64, "ring header layout changed");
+
+struct RingRecord
+{
+    qint64 timestampMs;
+    quint64 seq; // 1-based, 0 marks a slot that was never written
+    float min;
+    float avg;
+    float max;
+    quint32 count;
+    quint32 checksum;
+    quint32 reserved;
+};
+static_assert(sizeof(RingRecord) == 40, "ring record layout changed");
+
+quint32 recordChecksum(const RingRecord &record)
+{
+    // FNV-1a over every field that precedes the checksum.
+    const auto *bytes = reinterpret_cast<const unsigned char *>(&record);
+    quint32 hash = 2166136261u;
+    for (size_t index = 0; index < offsetof(RingRecord, checksum); ++index) {
+        hash ^= bytes[index];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+bool recordValid(const RingRecord &record, quint64 expectedSeq)
+{
+    return record.seq == expectedSeq && record.checksum == recordChecksum(record);
+}
+
+QString sanitizedMetricName(const QString &metric)
+{
+    static const QRegularExpression invalid(QStringLiteral("[^A-Za-z0-9_.-]"));
+    QString name = metric;
+    name.replace(invalid, QStringLiteral("_"));
+    return name;
+}
+
+} // namespace
+
+class TimeSeriesStore::RingFile
+{
+public:
+    RingFile(const QString &path, quint32 capacity, quint32 resolutionSec)
+        : m_path(path)
+        , m_capacity(capacity)
+        , m_resolutionSec(resolutionSec)
+    {
+        open();
+    }
+
+    ~RingFile()
+    {
+        if (m_map) {
+            ::msync(m_map, m_mapSize, MS_SYNC);
+            ::munmap(m_map, m_mapSize);
+        }
+
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    bool isOpen() const
+    {
+        return m_map != nullptr;
+    }
+
+    quint32 resolutionSec() const
+    {
+        return m_resolutionSec;
+    }
+
+    void append(const Point &point)
+    {
+        if (!isOpen()) {
+            return;
+        }
+
+        RingRecord record {};
+        record.timestampMs = point.timestampMs;
+        record.seq = m_nextSeq;
+        record.min = point.min;
+        record.avg = point.avg;
+        record.max = point.max;
+        record.count = point.count;
+        record.checksum = recordChecksum(record);
+
+        // The record is complete before the header advances; a crash in
+        // between leaves either the old slot or a checksum mismatch.
+        std::memcpy(&m_records[slotFor(m_nextSeq)], &record, sizeof(record));
+        ++m_nextSeq;
+        m_header->nextSeq = m_nextSeq;
+    }
+
+    QVector<Point> read(qint64 fromMs, qint64 toMs) const
+    {
+        QVector<Point> result;
+        if (!isOpen()) {
+            return result;
+        }
+
+        for (quint64 seq = firstSeq(); seq < m_nextSeq; ++seq) {
+            const RingRecord &record = m_records[slotFor(seq)];
+            if (!recordValid(record, seq)) {
+                continue;
+            }
+
+            if (record.timestampMs < fromMs) {
+                continue;
+            }
+
+            if (record.timestampMs > toMs) {
+                continue;
+            }
+
+            result.append(Point { record.timestampMs, record.min, record.avg, record.max, record.count });
+        }
+
+        return result;
+    }
+
+    bool last(Point &out) const
+    {
+        if (!isOpen()) {
+            return false;
+        }
+
+        for (quint64 seq = m_nextSeq; seq > firstSeq(); --seq) {
+            const RingRecord &record = m_records[slotFor(seq - 1)];
+            if (recordValid(record, seq - 1)) {
+                out = Point { record.timestampMs, record.min, record.avg, record.max, record.count };
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    qint64 oldestTimestamp() const
+    {
+        if (!isOpen()) {
+            return -1;
+        }
+
+        for (quint64 seq = firstSeq(); seq < m_nextSeq; ++seq) {
+            const RingRecord &record = m_records[slotFor(seq)];
+            if (recordValid(record, seq)) {
+                return record.timestampMs;
+            }
+        }
+
+        return -1;
+    }
+
+    void sync()
+    {
+        if (m_map) {
+            ::msync(m_map, m_mapSize, MS_ASYNC);
+        }
+    }
+
+private:
+    quint64 firstSeq() const
+    {
+        return m_nextSeq > m_capacity ? m_nextSeq - m_capacity : 1;
+    }
+
+    quint64 slotFor(quint64 seq) const
+    {
+        return (seq - 1) % m_capacity;
+    }
+
+    void open()
+    {
+        m_fd = ::open(m_path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            qWarning() << "TimeSeriesStore: cannot open" << m_path << "-" << std::strerror(errno);
+            return;
+        }
+
+        m_mapSize = sizeof(RingHeader) + static_cast<size_t>(m_capacity) * sizeof(RingRecord);
+
+        struct stat info {};
+        const bool sized = ::fstat(m_fd, &info) == 0 && static_cast<size_t>(info.st_size) == m_mapSize;
+        if (!sized && (::ftruncate(m_fd, 0) != 0 || ::ftruncate(m_fd, static_cast<off_t>(m_mapSize)) != 0)) {
+            qWarning() << "TimeSeriesStore: cannot size" << m_path << "-" << std::strerror(errno);
+            return;
+        }
+
+        void *map = ::mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (map == MAP_FAILED) {
+            qWarning() << "TimeSeriesStore: cannot map" << m_path << "-" << std::strerror(errno);
+            return;
+        }
+
+        m_map = map;
+        m_header = static_cast<RingHeader *>(map);
+        m_records = reinterpret_cast<RingRecord *>(static_cast<char *>(map) + sizeof(RingHeader));
+
+        const bool compatible = sized
+                                && std::memcmp(m_header->magic, kRingMagic, sizeof(kRingMagic)) == 0
+                                && m_header->version == kRingVersion
+                                && m_header->recordSize == sizeof(RingRecord)
+                                && m_header->capacity == m_capacity
+                                && m_header->resolutionSec == m_resolutionSec;
+        if (!compatible) {
+            std::memset(map, 0, m_mapSize);
+            std::memcpy(m_header->magic, kRingMagic, sizeof(kRingMagic));
+            m_header->version = kRingVersion;
+            m_header->recordSize = sizeof(RingRecord);
+            m_header->capacity = m_capacity;
+            m_header->resolutionSec = m_resolutionSec;
+            m_header->nextSeq = 1;
+            m_nextSeq = 1;
+            return;
+        }
+
+        // The header's sequence is only a hint: recover the real write
+        // position from the newest record whose checksum is intact.
+        quint64 newest = 0;
+        for (quint32 slot = 0; slot < m_capacity; ++slot) {
+            const RingRecord &record = m_records[slot];
+            if (record.seq != 0 && record.seq > newest && slotFor(record.seq) == slot
+                && record.checksum == recordChecksum(record)) {
+                newest = record.seq;
+            }
+        }
+
+        m_nextSeq = newest + 1;
+        m_header->nextSeq = m_nextSeq;
+    }
+
+    QString m_path;
+    quint32 m_capacity = 0;
+    quint32 m_resolutionSec = 0;
+    int m_fd = -1;
+    void *m_map = nullptr;
+    size_t m_mapSize = 0;
+    RingHeader *m_header = nullptr;
+    RingRecord *m_records = nullptr;
+    quint64 m_nextSeq = 1;
+};
+
+void TimeSeriesStore::Accumulator::add(const Point &point)
+{
+    if (count == 0) {
+        min = point.min;
+        max = point.max;
+    } else {
+        min = std::min(min, point.min);
+        max = std::max(max, point.max);
+    }
+
+    sum += static_cast<double>(point.avg) * point.count;
+    count += point.count;
+}
+
+TimeSeriesStore::Point TimeSeriesStore::Accumulator::toPoint() const
+{
+    const float avg = count > 0 ? static_cast<float>(sum / count) : 0.0f;
+    return Point { bucketStartMs, min, avg, max, count };
+}
+
+TimeSeriesStore::TimeSeriesStore(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_directory(directory)
+{
+    if (m_directory.isEmpty()) {
+        return;
+    }
+
+    if (!QDir().mkpath(m_directory)) {
+        qWarning() << "TimeSeriesStore: cannot create" << m_directory;
+        return;
+    }
+
+    m_enabled = true;
+}
+
+TimeSeriesStore::~TimeSeriesStore()
+{
+    qDeleteAll(m_series);
+}
+
+bool TimeSeriesStore::enabled() const
+{
+    return m_enabled;
+}
+
+QString TimeSeriesStore::directory() const
+{
+    return m_directory;
+}
+
+void TimeSeriesStore::append(const QString &metric, double value, qint64 timestampMs)
+{
+    Series *series = seriesFor(metric);
+    if (!series) {
+        return;
+    }
+
+    // Samples carry wall-clock time, which steps back after a reboot of a
+    // board without RTC or an NTP correction. The rings must stay in time
+    // order, so anything older than the last sample is dropped until the
+    // clock has caught up again.
+    if (timestampMs < series->lastTimestampMs) {
+        return;
+    }
+    series->lastTimestampMs = timestampMs;
+
+    const float sample = static_cast<float>(value);
+    const Point point { timestampMs, sample, sample, sample, 1 };
+    series->raw->append(point);
+    rollupMinute(*series, point);
+}
+
+void TimeSeriesStore::sync()
+{
+    for (Series *series : std::as_const(m_series)) {
+        series->raw->sync();
+        series->minute->sync();
+        series->hour->sync();
+    }
+}
+
+QVector<TimeSeriesStore::Point> TimeSeriesStore::points(const QString &metric, qint64 fromMs, qint64 toMs,
+                                                        int maxPoints, int *resolutionSec) const
+{
+    const Series *series = m_series.value(metric);
+    if (!series || toMs <= fromMs) {
+        return {};
+    }
+
+    maxPoints = std::max(1, maxPoints);
+    const RingFile *rings[] = { series->raw.get(), series->minute.get(), series->hour.get() };
+    const Accumulator *pending[] = { nullptr, &series->minuteAcc, &series->hourAcc };
+    const qint64 rangeSec = (toMs - fromMs) / 1000;
+
+    int chosen = 2;
+    for (int index = 0; index < 2; ++index) {
+        if (rangeSec / rings[index]->resolutionSec() <= static_cast<qint64>(maxPoints) * kMaxMergeFactor) {
+            chosen = index;
+            break;
+        }
+    }
+
+    // Step up to a coarser ring when the chosen one has already wrapped past
+    // the start of the range but the coarser one still reaches further back.
+    while (chosen < 2) {
+        const qint64 oldest = rings[chosen]->oldestTimestamp();
+        const qint64 coarserOldest = rings[chosen + 1]->oldestTimestamp();
+        if (oldest <= fromMs || coarserOldest < 0
+            || coarserOldest + static_cast<qint64>(rings[chosen + 1]->resolutionSec()) * 1000 >= oldest) {
+            break;
+        }
+        ++chosen;
+    }
+
+    QVector<Point> raw = rings[chosen]->read(fromMs, toMs);
+    if (pending[chosen] && pending[chosen]->count > 0
+        && pending[chosen]->bucketStartMs >= fromMs && pending[chosen]->bucketStartMs <= toMs) {
+        raw.append(pending[chosen]->toPoint());
+    }
+
+    if (resolutionSec) {
+        *resolutionSec = static_cast<int>(rings[chosen]->resolutionSec());
+    }
+
+    if (raw.size() <= maxPoints) {
+        return raw;
+    }
+
+    const int group = static_cast<int>((raw.size() + maxPoints - 1) / maxPoints);
+    if (resolutionSec) {
+        *resolutionSec *= group;
+    }
+
+    QVector<Point> merged;
+    merged.reserve(maxPoints);
+    for (int start = 0; start < raw.size(); start += group) {
+        Accumulator acc;
+        acc.bucketStartMs = raw.at(start).timestampMs;
+        const int end = std::min(static_cast<int>(raw.size()), start + group);
+        for (int index = start; index < end; ++index) {
+            acc.add(raw.at(index));
+        }
+        merged.append(acc.toPoint());
+    }
+
+    return merged;
+}
+
+QStringList TimeSeriesStore::metrics() const
+{
+    QStringList names = m_series.keys();
+    names.sort();
+    return names;
+}
+
+QVariantMap TimeSeriesStore::query(const QString &metric, qint64 fromMs, qint64 toMs, int maxPoints) const
+{
+    int resolution = 0;
+    const QVector<Point> result = points(metric, fromMs, toMs, maxPoints, &resolution);
+
+    QVariantList list;
+    QVariantList values;
+    list.reserve(result.size());
+    values.reserve(result.size());
+    for (const Point &point : result) {
+        QVariantMap item;
+        item[QStringLiteral("t")] = point.timestampMs;
+        item[QStringLiteral("min")] = point.min;
+        item[QStringLiteral("avg")] = point.avg;
+        item[QStringLiteral("max")] = point.max;
+        list.append(item);
+        values.append(point.avg);
+    }
+
+    QVariantMap map;
+    map[QStringLiteral("resolution")] = resolution;
+    map[QStringLiteral("points")] = list;
+    map[QStringLiteral("values")] = values;
+    return map;
+}
+
+QVariantMap TimeSeriesStore::queryRecent(const QString &metric, int rangeSeconds, int maxPoints) const
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    return query(metric, now - static_cast<qint64>(std::max(1, rangeSeconds)) * 1000, now, maxPoints);
+}
+
+TimeSeriesStore::Series *TimeSeriesStore::seriesFor(const QString &metric)
+{
+    if (!m_enabled) {
+        return nullptr;
+    }
+
+    auto it = m_series.constFind(metric);
+    if (it != m_series.constEnd()) {
+        return it.value();
+    }
+
+    const QString base = QDir(m_directory).filePath(sanitizedMetricName(metric));
+    auto *series = new Series;
+    series->raw = std::make_unique<RingFile>(base + QStringLiteral(".raw.ring"), kRawCapacity, 1);
+    series->minute = std::make_unique<RingFile>(base + QStringLiteral(".1m.ring"), kMinuteCapacity, 60);
+    series->hour = std::make_unique<RingFile>(base + QStringLiteral(".1h.ring"), kHourCapacity, 3600);
+    restoreAccumulators(*series);
+
+    Point last;
+    if (series->raw->last(last)) {
+        series->lastTimestampMs = last.timestampMs;
+    }
+
+    m_series.insert(metric, series);
+    return series;
+}
+
+void TimeSeriesStore::restoreAccumulators(Series &series)
+{
+    // Rebuild the in-progress buckets from whatever finer data outlived the
+    // previous run, so a restart does not leave holes in the rollups.
+    Point lastHour;
+    const qint64 minuteFrom = series.hour->last(lastHour) ? lastHour.timestampMs + kHourMs : 0;
+    for (const Point &minute : series.minute->read(minuteFrom, std::numeric_limits<qint64>::max())) {
+        rollupHour(series, minute);
+    }
+
+    Point lastMinute;
+    const qint64 rawFrom = series.minute->last(lastMinute) ? lastMinute.timestampMs + kMinuteMs : 0;
+    for (const Point &sample : series.raw->read(rawFrom, std::numeric_limits<qint64>::max())) {
+        rollupMinute(series, sample);
+    }
+}
+
+void TimeSeriesStore::rollupMinute(Series &series, const Point &sample)
+{
+    const qint64 bucket = sample.timestampMs - (sample.timestampMs % kMinuteMs);
+    Accumulator &acc = series.minuteAcc;
+    if (acc.count > 0 && acc.bucketStartMs != bucket) {
+        const Point minute = acc.toPoint();
+        series.minute->append(minute);
+        rollupHour(series, minute);
+        acc = Accumulator();
+
+        series.raw->sync();
+        series.minute->sync();
+    }
+
+    acc.bucketStartMs = bucket;
+    acc.add(sample);
+}
+
+void TimeSeriesStore::rollupHour(Series &series, const Point &minute)
+{
+    const qint64 bucket = minute.timestampMs - (minute.timestampMs % kHourMs);
+    Accumulator &acc = series.hourAcc;
+    if (acc.count > 0 && acc.bucketStartMs != bucket) {
+        series.hour->append(acc.toPoint());
+        series.hour->sync();
+        acc = Accumulator();
+    }
+
+    acc.bucketStartMs = bucket;
+    acc.add(minute);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+#include <memory>
+
+// Embedded on-disk time-series store. Each metric keeps three fixed-size,
+// memory-mapped ring files under the state directory: raw 1 s samples and
+// 1 min / 1 h rollups carrying min/avg/max. Records are checksummed and
+// carry a sequence number, so a torn write after a crash is simply skipped
+// when the ring is reopened.
+class TimeSeriesStore : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ enabled CONSTANT)
+    Q_PROPERTY(QString directory READ directory CONSTANT)
+
+public:
+    struct Point {
+        qint64 timestampMs = 0;
+        float min = 0.0f;
+        float avg = 0.0f;
+        float max = 0.0f;
+        quint32 count = 0;
+    };
+
+    explicit TimeSeriesStore(const QString &directory, QObject *parent = nullptr);
+    ~TimeSeriesStore() override;
+
+    bool enabled() const;
+    QString directory() const;
+
+    void append(const QString &metric, double value, qint64 timestampMs);
+    // Flushes dirty pages of every ring to disk.
+    void sync();
+
+    QVector<Point> points(const QString &metric, qint64 fromMs, qint64 toMs,
+                          int maxPoints, int *resolutionSec = nullptr) const;
+
+    Q_INVOKABLE QStringList metrics() const;
+    // Returns { resolution: <seconds>, points: [{ t, min, avg, max }, ...] }
+    // using the finest resolution that covers [fromMs, toMs] in at most
+    // maxPoints buckets.
+    Q_INVOKABLE QVariantMap query(const QString &metric, qint64 fromMs, qint64 toMs,
+                                  int maxPoints = 240) const;
+    // Convenience for charts: the last `rangeSeconds` ending now.
+    Q_INVOKABLE QVariantMap queryRecent(const QString &metric, int rangeSeconds,
+                                        int maxPoints = 240) const;
+
+private:
+    class RingFile;
+
+    struct Accumulator {
+        qint64 bucketStartMs = -1;
+        float min = 0.0f;
+        float max = 0.0f;
+        double sum = 0.0;
+        quint32 count = 0;
+
+        void add(const Point &point);
+        Point toPoint() const;
+    };
+
+    struct Series {
+        std::unique_ptr<RingFile> raw;
+        std::unique_ptr<RingFile> minute;
+        std::unique_ptr<RingFile> hour;
+        Accumulator minuteAcc;
+        Accumulator hourAcc;
+        // Newest timestamp in the rings; older samples are dropped.
+        qint64 lastTimestampMs = -1;
+    };
+
+    Series *seriesFor(const QString &metric);
+    void restoreAccumulators(Series &series);
+    void rollupMinute(Series &series, const Point &sample);
+    void rollupHour(Series &series, const Point &minute);
+
+    QString m_directory;
+    bool m_enabled = false;
+    QHash<QString, Series *> m_series;
+};
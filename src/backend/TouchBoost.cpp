@@ -0,0 +1,428 @@
+#include "TouchBoost.h"
+
+#include "SystemHelpers.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QMutexLocker>
+#include <QQuickWindow>
+#include <QSettings>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <unistd.h>
+
+namespace {
+
+const char kEnabledKey[] = "performance/touchBoost";
+constexpr int kDefaultBoostPercent = 60;
+constexpr int kDefaultWindowMs = 800;
+// The floor comes down in a few steps instead of dropping at once, so a
+// scroll that coasts past the window does not hit the slowest OPP.
+constexpr int kDecaySteps = 3;
+constexpr int kDecayStepMs = 100;
+constexpr int kFrameSampleLimit = 256;
+// A gap this long means the scene was idle, not that a frame was slow.
+constexpr double kMaxFrameIntervalMs = 250.0;
+
+qint64 monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int environmentInt(const char *name, int fallback, int minimum, int maximum)
+{
+    bool ok = false;
+    const int configured = Backend::readEnvironmentValue(name).toInt(&ok);
+    return ok ? std::clamp(configured, minimum, maximum) : fallback;
+}
+
+qint64 readKhz(const QString &path)
+{
+    return Backend::readTextFile(path).toLongLong();
+}
+
+// Smallest listed frequency at or above `khz`.
+qint64 snapUp(const QVector<qint64> &frequencies, qint64 khz)
+{
+    const auto it = std::lower_bound(frequencies.cbegin(), frequencies.cend(), khz);
+    if (it == frequencies.cend()) {
+        return frequencies.isEmpty() ? khz : frequencies.last();
+    }
+
+    return *it;
+}
+
+double percentile(QVector<double> samples, double fraction)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const int index = std::min(static_cast<int>(samples.size()) - 1,
+                               static_cast<int>(fraction * (samples.size() - 1) + 0.5));
+    return samples.at(index);
+}
+
+double mean(const QVector<double> &samples)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+
+    double sum = 0.0;
+    for (double value : samples) {
+        sum += value;
+    }
+
+    return sum / samples.size();
+}
+
+} // namespace
+
+TouchBoost::TouchBoost(QObject *parent)
+    : QObject(parent)
+    , m_windowTimer(new QTimer(this))
+    , m_decayTimer(new QTimer(this))
+    , m_statsTimer(new QTimer(this))
+{
+    m_boostPercent = environmentInt("ORBITAL_TOUCH_BOOST_PERCENT", kDefaultBoostPercent, 0, 100);
+    m_windowMs = environmentInt("ORBITAL_TOUCH_BOOST_MS", kDefaultWindowMs, 50, 10000);
+    m_abMode = Backend::readEnvironmentValue("ORBITAL_TOUCH_BOOST_AB") == QLatin1String("1");
+
+    QSettings settings;
+    m_enabled = settings.value(QLatin1String(kEnabledKey), true).toBool();
+
+    m_windowTimer->setSingleShot(true);
+    connect(m_windowTimer, &QTimer::timeout, this, [this]() {
+        m_decayStep = 1;
+        applyFloor(m_decayStep);
+        m_decayTimer->start();
+    });
+
+    m_decayTimer->setInterval(kDecayStepMs);
+    connect(m_decayTimer, &QTimer::timeout, this, [this]() {
+        ++m_decayStep;
+        applyFloor(m_decayStep);
+        if (m_decayStep >= kDecaySteps) {
+            m_decayTimer->stop();
+            setBoosting(false);
+        }
+    });
+
+    m_statsTimer->setInterval(1000);
+    connect(m_statsTimer, &QTimer::timeout, this, [this]() {
+        if (m_framesDirty.exchange(false)) {
+            emit frameStatsChanged();
+        }
+    });
+    m_statsTimer->start();
+
+    if (Backend::readEnvironmentValue("ORBITAL_TOUCH_BOOST") != QLatin1String("0")) {
+        discover();
+        openTouchDevice();
+    }
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &TouchBoost::release);
+    }
+}
+
+TouchBoost::~TouchBoost()
+{
+    release();
+    if (m_touchFd >= 0) {
+        ::close(m_touchFd);
+    }
+}
+
+bool TouchBoost::available() const
+{
+    return m_available;
+}
+
+bool TouchBoost::enabled() const
+{
+    return m_enabled;
+}
+
+void TouchBoost::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+
+    m_enabled = enabled;
+    if (!m_enabled) {
+        release();
+    }
+
+    QSettings settings;
+    settings.setValue(QLatin1String(kEnabledKey), m_enabled);
+    emit enabledChanged();
+}
+
+bool TouchBoost::boosting() const
+{
+    return m_boosting;
+}
+
+QVariantMap TouchBoost::frameStats() const
+{
+    const auto describe = [](const FrameSamples &samples) {
+        QVariantMap map;
+        map[QStringLiteral("frames")] = samples.frames;
+        map[QStringLiteral("interactions")] = samples.interactions;
+        map[QStringLiteral("meanFrameMs")] = mean(samples.intervals);
+        map[QStringLiteral("p95FrameMs")] = percentile(samples.intervals, 0.95);
+        map[QStringLiteral("meanLatencyMs")] = mean(samples.latencies);
+        map[QStringLiteral("p95LatencyMs")] = percentile(samples.latencies, 0.95);
+        return map;
+    };
+
+    QMutexLocker locker(&m_frameMutex);
+    QVariantMap stats;
+    stats[QStringLiteral("boosted")] = describe(m_boostedFrames);
+    stats[QStringLiteral("plain")] = describe(m_plainFrames);
+
+    // Positive when boosted interactions render faster at the 95th percentile.
+    const double boostedP95 = percentile(m_boostedFrames.intervals, 0.95);
+    const double plainP95 = percentile(m_plainFrames.intervals, 0.95);
+    stats[QStringLiteral("hasComparison")] = boostedP95 > 0.0 && plainP95 > 0.0;
+    stats[QStringLiteral("p95Improvement")] = plainP95 > 0.0 ? (plainP95 - boostedP95) / plainP95 : 0.0;
+    return stats;
+}
+
+void TouchBoost::trackWindow(QObject *window)
+{
+    auto *quickWindow = qobject_cast<QQuickWindow *>(window);
+    if (!quickWindow) {
+        return;
+    }
+
+    // frameSwapped comes from the render thread; only the sample rings are
+    // touched there.
+    connect(quickWindow, &QQuickWindow::frameSwapped, this, [this]() {
+        onFrameSwapped();
+    }, Qt::DirectConnection);
+}
+
+void TouchBoost::resetFrameStats()
+{
+    {
+        QMutexLocker locker(&m_frameMutex);
+        m_boostedFrames = FrameSamples();
+        m_plainFrames = FrameSamples();
+    }
+
+    emit frameStatsChanged();
+}
+
+void TouchBoost::poke()
+{
+    const qint64 now = monotonicNs();
+    const bool boostAllowed = m_available && m_enabled;
+
+    QMutexLocker locker(&m_frameMutex);
+    if (now > m_interactionEndNs) {
+        bool boostThis = boostAllowed;
+        if (boostThis && m_abMode) {
+            boostThis = !m_skipNext;
+            m_skipNext = !m_skipNext;
+        }
+
+        m_inputNs = now;
+        m_awaitingFirstFrame = true;
+        m_interactionBoosted = boostThis;
+        ++(boostThis ? m_boostedFrames : m_plainFrames).interactions;
+    }
+    m_interactionEndNs = now + static_cast<qint64>(m_windowMs + kDecaySteps * kDecayStepMs) * 1000000;
+    const bool boostThis = m_interactionBoosted;
+    locker.unlock();
+
+    if (!boostThis || !boostAllowed) {
+        return;
+    }
+
+    // Already at the full floor: a moving finger only extends the window.
+    // applyFloor() reads every policy's cap, which is too much for ~100 Hz.
+    if (m_boosting && m_decayStep == 0) {
+        m_windowTimer->start(m_windowMs);
+        return;
+    }
+
+    if (!m_boosting) {
+        for (Policy &policy : m_policies) {
+            policy.baselineKhz = readKhz(policy.minPath);
+            policy.writtenKhz = policy.baselineKhz;
+        }
+        setBoosting(true);
+    }
+
+    m_decayTimer->stop();
+    m_decayStep = 0;
+    applyFloor(0);
+    m_windowTimer->start(m_windowMs);
+}
+
+void TouchBoost::release()
+{
+    if (!m_boosting) {
+        return;
+    }
+
+    m_windowTimer->stop();
+    m_decayTimer->stop();
+    applyFloor(kDecaySteps);
+    setBoosting(false);
+}
+
+void TouchBoost::onTouchInput()
+{
+    bool touched = false;
+    struct input_event ev;
+    while (::read(m_touchFd, &ev, sizeof(ev)) > 0) {
+        if (ev.type == EV_ABS || ev.type == EV_KEY) {
+            touched = true;
+        }
+    }
+
+    // One poke per read batch; a finger on the panel reports ~100 Hz.
+    if (touched) {
+        poke();
+    }
+}
+
+void TouchBoost::discover()
+{
+    const QDir cpufreqDir(Backend::sysPath(QStringLiteral("/devices/system/cpu/cpufreq")));
+    const QStringList policyEntries = cpufreqDir.entryList(QStringList() << QStringLiteral("policy*"),
+                                                           QDir::Dirs | QDir::NoDotAndDotDot,
+                                                           QDir::Name);
+    for (const QString &entryName : policyEntries) {
+        const QString policyPath = cpufreqDir.filePath(entryName);
+
+        Policy policy;
+        policy.minPath = policyPath + QStringLiteral("/scaling_min_freq");
+        policy.maxPath = policyPath + QStringLiteral("/scaling_max_freq");
+        policy.hardwareMaxKhz = readKhz(policyPath + QStringLiteral("/cpuinfo_max_freq"));
+        if (policy.hardwareMaxKhz <= 0
+            || ::access(QFile::encodeName(policy.minPath).constData(), W_OK) != 0) {
+            continue;
+        }
+
+        const QStringList frequencies = Backend::readTextFile(
+            policyPath + QStringLiteral("/scaling_available_frequencies")).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        for (const QString &frequency : frequencies) {
+            policy.frequencies.append(frequency.toLongLong());
+        }
+        std::sort(policy.frequencies.begin(), policy.frequencies.end());
+
+        m_policies.append(policy);
+    }
+
+    m_available = !m_policies.isEmpty() && m_boostPercent > 0;
+}
+
+void TouchBoost::openTouchDevice()
+{
+    const QString path = Backend::readEnvironmentValue("ORBITAL_TOUCH_INPUT_PATH");
+    if (path.isEmpty() || !m_available) {
+        return;
+    }
+
+    // Not grabbed: the evdevtouch plugin reads the same device.
+    m_touchFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (m_touchFd < 0) {
+        qWarning() << "Touch boost: cannot open touch input device:" << path;
+        return;
+    }
+
+    m_touchNotifier = new QSocketNotifier(m_touchFd, QSocketNotifier::Read, this);
+    connect(m_touchNotifier, &QSocketNotifier::activated, this, &TouchBoost::onTouchInput);
+}
+
+void TouchBoost::applyFloor(int step)
+{
+    for (Policy &policy : m_policies) {
+        qint64 target = policy.baselineKhz;
+        if (step < kDecaySteps) {
+            const qint64 boostKhz = policy.hardwareMaxKhz * m_boostPercent / 100;
+            const qint64 floorKhz = std::max(policy.baselineKhz, snapUp(policy.frequencies, boostKhz));
+            target = policy.baselineKhz + (floorKhz - policy.baselineKhz) * (kDecaySteps - step) / kDecaySteps;
+            target = std::max(policy.baselineKhz, snapUp(policy.frequencies, target));
+
+            // A thermal or profile cap wins over the boost.
+            const qint64 maxKhz = readKhz(policy.maxPath);
+            if (maxKhz > 0) {
+                target = std::max(policy.baselineKhz, std::min(target, maxKhz));
+            }
+        }
+
+        if (target == policy.writtenKhz) {
+            continue;
+        }
+
+        QString error;
+        if (Backend::writeSysfsValue(policy.minPath, QByteArray::number(target), &error)) {
+            policy.writtenKhz = target;
+        } else {
+            qWarning() << "Touch boost:" << error;
+        }
+    }
+}
+
+void TouchBoost::setBoosting(bool boosting)
+{
+    if (m_boosting == boosting) {
+        return;
+    }
+
+    m_boosting = boosting;
+    emit boostingChanged();
+}
+
+void TouchBoost::onFrameSwapped()
+{
+    const qint64 now = monotonicNs();
+
+    QMutexLocker locker(&m_frameMutex);
+    const qint64 previous = m_lastFrameNs;
+    m_lastFrameNs = now;
+    if (now > m_interactionEndNs || m_inputNs == 0) {
+        return;
+    }
+
+    FrameSamples &samples = m_interactionBoosted ? m_boostedFrames : m_plainFrames;
+    ++samples.frames;
+    if (m_awaitingFirstFrame) {
+        m_awaitingFirstFrame = false;
+        appendSample(samples.latencies, samples.latencyCursor, (now - m_inputNs) / 1e6);
+    } else if (previous >= m_inputNs) {
+        const double intervalMs = (now - previous) / 1e6;
+        if (intervalMs < kMaxFrameIntervalMs) {
+            appendSample(samples.intervals, samples.intervalCursor, intervalMs);
+        }
+    }
+
+    m_framesDirty = true;
+}
+
+void TouchBoost::appendSample(QVector<double> &samples, int &cursor, double value)
+{
+    if (samples.size() < kFrameSampleLimit) {
+        samples.append(value);
+        return;
+    }
+
+    samples[cursor] = value;
+    cursor = (cursor + 1) % kFrameSampleLimit;
+}
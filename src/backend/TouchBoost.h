@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+#include <atomic>
+
+class QSocketNotifier;
+class QTimer;
+
+// Raises the cpufreq floor while the user interacts. Touch events come from
+// the evdev device in ORBITAL_TOUCH_INPUT_PATH, hardware keys arrive through
+// poke(). Each policy's scaling_min_freq is lifted to a share of its
+// hardware maximum for a short window and then stepped back down to the
+// value found before the boost.
+//
+// Frame intervals of a tracked window are recorded while an interaction is
+// in progress, split by whether the floor was raised, so the effect can be
+// read from frameStats. ORBITAL_TOUCH_BOOST_AB=1 boosts only every other
+// interaction to get both sides on the same device.
+class TouchBoost : public QObject
+{
+    Q_OBJECT
+    // False when no policy floor can be written (usually not root).
+    Q_PROPERTY(bool available READ available CONSTANT)
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool boosting READ boosting NOTIFY boostingChanged)
+    Q_PROPERTY(QVariantMap frameStats READ frameStats NOTIFY frameStatsChanged)
+
+public:
+    explicit TouchBoost(QObject *parent = nullptr);
+    ~TouchBoost() override;
+
+    bool available() const;
+    bool enabled() const;
+    void setEnabled(bool enabled);
+    bool boosting() const;
+    QVariantMap frameStats() const;
+
+    // Records frames of a QQuickWindow; other objects are ignored.
+    Q_INVOKABLE void trackWindow(QObject *window);
+    Q_INVOKABLE void resetFrameStats();
+
+public slots:
+    // Starts or extends an interaction window.
+    void poke();
+    // Puts the floors back immediately. Anything about to write cpufreq
+    // limits itself must call this first so it sees the unboosted values.
+    void release();
+
+signals:
+    void enabledChanged();
+    void boostingChanged();
+    void frameStatsChanged();
+
+private slots:
+    void onTouchInput();
+
+private:
+    struct Policy {
+        QString minPath;
+        QString maxPath;
+        // Ascending; empty when the driver does not list them.
+        QVector<qint64> frequencies;
+        qint64 hardwareMaxKhz = 0;
+        // scaling_min_freq before the boost.
+        qint64 baselineKhz = 0;
+        qint64 writtenKhz = 0;
+    };
+
+    // Frame intervals and input-to-frame latencies in ms, bounded rings.
+    struct FrameSamples {
+        QVector<double> intervals;
+        QVector<double> latencies;
+        int intervalCursor = 0;
+        int latencyCursor = 0;
+        qint64 frames = 0;
+        qint64 interactions = 0;
+    };
+
+    void discover();
+    void openTouchDevice();
+    void applyFloor(int step);
+    void setBoosting(bool boosting);
+    void onFrameSwapped();
+    static void appendSample(QVector<double> &samples, int &cursor, double value);
+
+    QVector<Policy> m_policies;
+    int m_touchFd = -1;
+    QSocketNotifier *m_touchNotifier = nullptr;
+    QTimer *m_windowTimer = nullptr;
+    QTimer *m_decayTimer = nullptr;
+    QTimer *m_statsTimer = nullptr;
+    int m_boostPercent = 60;
+    int m_windowMs = 800;
+    int m_decayStep = 0;
+    bool m_available = false;
+    bool m_enabled = true;
+    bool m_boosting = false;
+    bool m_abMode = false;
+    bool m_skipNext = false;
+
+    // Shared with the render thread.
+    mutable QMutex m_frameMutex;
+    FrameSamples m_boostedFrames;
+    FrameSamples m_plainFrames;
+    qint64 m_lastFrameNs = 0;
+    qint64 m_inputNs = 0;
+    qint64 m_interactionEndNs = 0;
+    bool m_interactionBoosted = false;
+    bool m_awaitingFirstFrame = false;
+    std::atomic_bool m_framesDirty { false };
+};
@@ -0,0 +1,103 @@
+#include "UeventMonitor.h"
+
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Multicast group of raw kernel events, as opposed to udev's re-broadcasts.
+constexpr unsigned int kKernelEventGroup = 1;
+constexpr int kMessageBufferSize = 8192;
+
+} // namespace
+
+UeventMonitor::UeventMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (m_fd < 0) {
+        qWarning() << "UeventMonitor: cannot open uevent socket:" << std::strerror(errno);
+        return;
+    }
+
+    sockaddr_nl address {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = kKernelEventGroup;
+    if (::bind(m_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        qWarning() << "UeventMonitor: cannot bind uevent socket:" << std::strerror(errno);
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &UeventMonitor::readEvents);
+}
+
+UeventMonitor::~UeventMonitor()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool UeventMonitor::isValid() const
+{
+    return m_fd >= 0;
+}
+
+void UeventMonitor::readEvents()
+{
+    char buffer[kMessageBufferSize];
+    while (true) {
+        const ssize_t received = ::recv(m_fd, buffer, sizeof(buffer) - 1, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received <= 0) {
+            break;
+        }
+
+        buffer[received] = '\0';
+
+        // "action@devpath\0KEY=value\0KEY=value\0..."
+        Event event;
+        const char *cursor = buffer;
+        const char *end = buffer + received;
+        bool header = true;
+        while (cursor < end) {
+            const size_t length = std::strlen(cursor);
+            const QString field = QString::fromUtf8(cursor, static_cast<int>(length));
+            cursor += length + 1;
+
+            if (header) {
+                header = false;
+                if (field.contains(QLatin1Char('@'))) {
+                    continue;
+                }
+            }
+
+            const int separator = field.indexOf(QLatin1Char('='));
+            if (separator <= 0) {
+                continue;
+            }
+
+            event.properties.insert(field.left(separator), field.mid(separator + 1));
+        }
+
+        event.action = event.properties.value(QStringLiteral("ACTION"));
+        event.devpath = event.properties.value(QStringLiteral("DEVPATH"));
+        event.subsystem = event.properties.value(QStringLiteral("SUBSYSTEM"));
+        if (!event.action.isEmpty()) {
+            emit eventReceived(event);
+        }
+    }
+}
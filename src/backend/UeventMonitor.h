@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+// Listens for kernel kobject uevents (NETLINK_KOBJECT_UEVENT) so backends can
+// react to device changes - a charger being plugged in, a thermal zone
+// crossing a trip point - instead of polling sysfs for them.
+class UeventMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Event {
+        QString action;
+        QString devpath;
+        QString subsystem;
+        QHash<QString, QString> properties;
+    };
+
+    explicit UeventMonitor(QObject *parent = nullptr);
+    ~UeventMonitor() override;
+
+    bool isValid() const;
+
+signals:
+    void eventReceived(const UeventMonitor::Event &event);
+
+private:
+    void readEvents();
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+};
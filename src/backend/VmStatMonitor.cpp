@@ -0,0 +1,289 @@
+#include "VmStatMonitor.h"
+
+#include "MetricScheduler.h"
+#include "SystemHelpers.h"
+#include "UeventMonitor.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// /proc/vmstat is 5-8 KiB on current kernels.
+constexpr int kVmstatBufferSize = 16384;
+// After a longer gap (collector unsubscribed) the average would be stale.
+constexpr qint64 kMaxRateIntervalMs = 30000;
+
+struct CounterKey {
+    const char *name;
+    // Index into VmStatMonitor's counters; -1 skips the line.
+    int counter;
+    // Prefix keys sum every matching line: pgscan_kswapd_{dma,normal,...}
+    // before 4.8 and workingset_refault_{anon,file} since 5.9.
+    bool prefix;
+};
+
+// pgscan_direct_throttle shares the pgscan_direct prefix but counts
+// throttling events, not pages; it is listed first so it never matches.
+const CounterKey kCounterKeys[] = {
+    { "pgscan_direct_throttle", -1, false },
+    { "pgmajfault", 0, false },
+    { "pswpin", 1, false },
+    { "pswpout", 2, false },
+    { "pgscan_kswapd", 3, true },
+    { "pgscan_direct", 4, true },
+    { "pgsteal_kswapd", 5, true },
+    { "pgsteal_direct", 6, true },
+    { "workingset_refault", 7, true },
+};
+
+// "[lzo] lz4 zstd" -> "lzo"
+QString selectedAlgorithm(const QString &text)
+{
+    const int open = text.indexOf(QLatin1Char('['));
+    const int close = text.indexOf(QLatin1Char(']'), open + 1);
+    return open >= 0 && close > open ? text.mid(open + 1, close - open - 1) : text;
+}
+
+} // namespace
+
+VmStatMonitor::VmStatMonitor(UeventMonitor *uevent, QObject *parent)
+    : QObject(parent)
+{
+    const QByteArray path = QFile::encodeName(Backend::procPath(QStringLiteral("/vmstat")));
+    m_vmstatFd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+
+    const long pageSize = ::sysconf(_SC_PAGESIZE);
+    if (pageSize > 0) {
+        m_pageSizeBytes = pageSize;
+    }
+
+    // zram devices come and go with zramctl / hot_add.
+    connect(uevent, &UeventMonitor::eventReceived, this, [this](const UeventMonitor::Event &event) {
+        if (event.subsystem == QLatin1String("block") && event.devpath.contains(QLatin1String("/zram"))) {
+            m_zramDiscovered = false;
+        }
+    });
+}
+
+VmStatMonitor::~VmStatMonitor()
+{
+    if (m_vmstatFd >= 0) {
+        ::close(m_vmstatFd);
+    }
+    closeZram();
+}
+
+void VmStatMonitor::registerCollector(MetricScheduler *scheduler)
+{
+    scheduler->registerCollector(QStringLiteral("vmstat"), [this]() {
+        sample();
+        emit changed();
+    });
+}
+
+bool VmStatMonitor::available() const
+{
+    return m_vmstatFd >= 0;
+}
+
+QVariantMap VmStatMonitor::rates() const
+{
+    return m_rates;
+}
+
+QVariantList VmStatMonitor::zram() const
+{
+    return m_zram;
+}
+
+void VmStatMonitor::sample()
+{
+    readZram();
+
+    quint64 counters[CounterCount] = {};
+    if (!readCounters(counters)) {
+        return;
+    }
+
+    // Rates need two reads; a collector that sat idle or a pass across
+    // suspend restarts from here.
+    const double elapsedSec = m_clock.restart();
+    const bool hasRates = m_hasPrevious && elapsedSec > 0.0 && elapsedSec * 1000.0 <= kMaxRateIntervalMs;
+    double perSecond[CounterCount] = {};
+    for (int index = 0; index < CounterCount; ++index) {
+        if (hasRates) {
+            perSecond[index] = CounterRate::rateOver(counters[index], m_previous[index], elapsedSec);
+        }
+        m_previous[index] = counters[index];
+    }
+    m_hasPrevious = true;
+
+    const double scanned = perSecond[ScanKswapd] + perSecond[ScanDirect];
+    const double stolen = perSecond[StealKswapd] + perSecond[StealDirect];
+
+    QVariantMap rates;
+    rates[QStringLiteral("valid")] = hasRates;
+    rates[QStringLiteral("majorFaults")] = perSecond[MajorFaults];
+    rates[QStringLiteral("swapIn")] = perSecond[SwapIn];
+    rates[QStringLiteral("swapOut")] = perSecond[SwapOut];
+    rates[QStringLiteral("scanKswapd")] = perSecond[ScanKswapd];
+    rates[QStringLiteral("scanDirect")] = perSecond[ScanDirect];
+    rates[QStringLiteral("stealKswapd")] = perSecond[StealKswapd];
+    rates[QStringLiteral("stealDirect")] = perSecond[StealDirect];
+    rates[QStringLiteral("refaults")] = perSecond[Refaults];
+    // Pages reclaimed per page scanned; low values mean reclaim is working
+    // hard for little gain. -1 while nothing is scanned.
+    rates[QStringLiteral("reclaimEfficiency")] = scanned > 0.0 ? qMin(1.0, stolen / scanned) : -1.0;
+    rates[QStringLiteral("swappiness")] =
+        Backend::readTextFile(Backend::procPath(QStringLiteral("/sys/vm/swappiness"))).toInt();
+
+    rates[QStringLiteral("displayMajorFaults")] = Backend::formatRate(perSecond[MajorFaults]);
+    rates[QStringLiteral("displaySwapIn")] =
+        Backend::formatSpeed(static_cast<quint64>(perSecond[SwapIn] * m_pageSizeBytes));
+    rates[QStringLiteral("displaySwapOut")] =
+        Backend::formatSpeed(static_cast<quint64>(perSecond[SwapOut] * m_pageSizeBytes));
+    rates[QStringLiteral("displayScanKswapd")] = Backend::formatRate(perSecond[ScanKswapd]);
+    rates[QStringLiteral("displayScanDirect")] = Backend::formatRate(perSecond[ScanDirect]);
+    rates[QStringLiteral("displayRefaults")] = Backend::formatRate(perSecond[Refaults]);
+    rates[QStringLiteral("displayReclaimEfficiency")] =
+        scanned > 0.0 ? QStringLiteral("%1%").arg(qRound(qMin(1.0, stolen / scanned) * 100.0)) : QStringLiteral("--");
+    m_rates = rates;
+}
+
+bool VmStatMonitor::readCounters(quint64 (&counters)[CounterCount]) const
+{
+    if (m_vmstatFd < 0) {
+        return false;
+    }
+
+    char buffer[kVmstatBufferSize];
+    const ssize_t length = ::pread(m_vmstatFd, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0) {
+        return false;
+    }
+    buffer[length] = '\0';
+
+    for (char *line = buffer; *line;) {
+        char *space = std::strchr(line, ' ');
+        char *newline = std::strchr(line, '\n');
+        if (!newline) {
+            newline = buffer + length;
+        }
+
+        if (space && space < newline) {
+            const size_t keyLength = static_cast<size_t>(space - line);
+            for (const CounterKey &key : kCounterKeys) {
+                const size_t nameLength = std::strlen(key.name);
+                const bool matches = key.prefix ? keyLength >= nameLength : keyLength == nameLength;
+                if (matches && std::memcmp(line, key.name, nameLength) == 0) {
+                    if (key.counter >= 0) {
+                        counters[key.counter] += std::strtoull(space + 1, nullptr, 10);
+                    }
+                    break;
+                }
+            }
+        }
+
+        line = *newline ? newline + 1 : newline;
+    }
+
+    return true;
+}
+
+void VmStatMonitor::readZram()
+{
+    if (!m_zramDiscovered) {
+        discoverZram();
+    }
+
+    QVariantList devices;
+    for (const ZramDevice &device : std::as_const(m_zramDevices)) {
+        char buffer[256];
+        const ssize_t length = ::pread(device.fd, buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0) {
+            continue;
+        }
+        buffer[length] = '\0';
+
+        // orig_data_size compr_data_size mem_used_total mem_limit
+        // mem_used_max same_pages pages_compacted huge_pages ...
+        quint64 fields[6] = {};
+        char *cursor = buffer;
+        for (quint64 &field : fields) {
+            field = std::strtoull(cursor, &cursor, 10);
+        }
+
+        const quint64 original = fields[0];
+        const quint64 compressed = fields[1];
+        const quint64 used = fields[2];
+        const quint64 samePages = fields[5];
+
+        QVariantMap map;
+        map[QStringLiteral("name")] = device.name;
+        map[QStringLiteral("algorithm")] =
+            selectedAlgorithm(Backend::readTextFile(device.path + QStringLiteral("/comp_algorithm")));
+        map[QStringLiteral("diskSize")] = static_cast<qulonglong>(device.diskSize);
+        map[QStringLiteral("originalBytes")] = static_cast<qulonglong>(original);
+        map[QStringLiteral("compressedBytes")] = static_cast<qulonglong>(compressed);
+        map[QStringLiteral("usedBytes")] = static_cast<qulonglong>(used);
+        map[QStringLiteral("samePages")] = static_cast<qulonglong>(samePages);
+        // Against mem_used_total, which includes allocator overhead, so the
+        // ratio is what zram costs, not just what the compressor achieves.
+        const double ratio = used > 0 ? static_cast<double>(original) / used : 0.0;
+        const qint64 saved = static_cast<qint64>(original) - static_cast<qint64>(used);
+        map[QStringLiteral("ratio")] = ratio;
+        map[QStringLiteral("savedBytes")] = saved;
+        map[QStringLiteral("fill")] = device.diskSize > 0 ? static_cast<double>(original) / device.diskSize : 0.0;
+        map[QStringLiteral("displayRatio")] = used > 0 ? QStringLiteral("%1x").arg(ratio, 0, 'f', 2) : QStringLiteral("--");
+        map[QStringLiteral("displaySaved")] = Backend::formatSize(qMax<qint64>(0, saved));
+        map[QStringLiteral("displayStored")] = Backend::formatSize(static_cast<qint64>(original));
+        map[QStringLiteral("displayUsed")] = Backend::formatSize(static_cast<qint64>(used));
+        map[QStringLiteral("displayDiskSize")] = Backend::formatSize(static_cast<qint64>(device.diskSize));
+        devices.append(map);
+    }
+
+    m_zram = devices;
+}
+
+void VmStatMonitor::discoverZram()
+{
+    closeZram();
+    m_zramDiscovered = true;
+
+    const QDir blockDir(Backend::sysPath(QStringLiteral("/block")));
+    for (const QString &entryName : blockDir.entryList(QStringList() << QStringLiteral("zram*"),
+                                                       QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+        ZramDevice device;
+        device.name = entryName;
+        device.path = blockDir.filePath(entryName);
+        device.diskSize = Backend::readTextFile(device.path + QStringLiteral("/disksize")).toULongLong();
+        // An unconfigured device has disksize 0 and nothing to report.
+        if (device.diskSize == 0) {
+            continue;
+        }
+
+        const QByteArray statPath = QFile::encodeName(device.path + QStringLiteral("/mm_stat"));
+        device.fd = ::open(statPath.constData(), O_RDONLY | O_CLOEXEC);
+        if (device.fd >= 0) {
+            m_zramDevices.append(device);
+        }
+    }
+}
+
+void VmStatMonitor::closeZram()
+{
+    for (ZramDevice &device : m_zramDevices) {
+        if (device.fd >= 0) {
+            ::close(device.fd);
+        }
+    }
+
+    m_zramDevices.clear();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+#include "CounterRate.h"
+
+class MetricScheduler;
+class UeventMonitor;
+
+// Memory dynamics for tuning swappiness and zram on small devices. The
+// "vmstat" collector preads /proc/vmstat and turns the fault, swap, reclaim
+// and refault counters into per-second rates, and reads mm_stat of every
+// zram device for its compression ratio and the memory it actually saves.
+class VmStatMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool available READ available CONSTANT)
+    // { majorFaults, swapIn, swapOut, scanKswapd, scanDirect, stealKswapd,
+    //   stealDirect, refaults (per second), reclaimEfficiency, swappiness,
+    //   display* strings }
+    Q_PROPERTY(QVariantMap rates READ rates NOTIFY changed)
+    Q_PROPERTY(QVariantList zram READ zram NOTIFY changed)
+
+public:
+    explicit VmStatMonitor(UeventMonitor *uevent, QObject *parent = nullptr);
+    ~VmStatMonitor() override;
+
+    void registerCollector(MetricScheduler *scheduler);
+
+    bool available() const;
+    QVariantMap rates() const;
+    QVariantList zram() const;
+
+signals:
+    void changed();
+
+private:
+    enum Counter {
+        MajorFaults,
+        SwapIn,
+        SwapOut,
+        ScanKswapd,
+        ScanDirect,
+        StealKswapd,
+        StealDirect,
+        Refaults,
+        CounterCount
+    };
+
+    struct ZramDevice {
+        QString name;
+        QString path;
+        quint64 diskSize = 0;
+        int fd = -1;
+    };
+
+    void sample();
+    bool readCounters(quint64 (&counters)[CounterCount]) const;
+    void readZram();
+    void discoverZram();
+    void closeZram();
+
+    int m_vmstatFd = -1;
+    quint64 m_previous[CounterCount] = {};
+    bool m_hasPrevious = false;
+    RateClock m_clock;
+    QVector<ZramDevice> m_zramDevices;
+    bool m_zramDiscovered = false;
+    qint64 m_pageSizeBytes = 4096;
+    QVariantMap m_rates;
+    QVariantList m_zram;
+};
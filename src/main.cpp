@@ -1,18 +1,73 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QSocketNotifier>
+#include "backend/MetricSubscription.h"
 #include "backend/TerminalBackend.h"
 #include "SystemMonitor.h"
 
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+int signalPipe[2] = { -1, -1 };
+
+void forwardSignal(int signal)
+{
+    const int savedErrno = errno;
+    const char byte = static_cast<char>(signal);
+    [[maybe_unused]] const ssize_t written = ::write(signalPipe[1], &byte, 1);
+    errno = savedErrno;
+}
+
+// SIGTERM / SIGINT / SIGHUP 经 self-pipe 转为 QCoreApplication::quit()，
+// 这样 aboutToQuit 照常触发，CPU 配置与触摸升频的下限在 systemctl stop、
+// pkill 或 Ctrl-C 时也会被恢复。
+void installQuitSignals(QCoreApplication &app)
+{
+    if (::pipe2(signalPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        return;
+    }
+
+    auto *notifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read, &app);
+    QObject::connect(notifier, &QSocketNotifier::activated, &app, []() {
+        char buffer[16];
+        while (::read(signalPipe[0], buffer, sizeof(buffer)) > 0) {
+        }
+
+        // 退出卡住时，再按一次 Ctrl-C 即可直接终止
+        for (const int signal : { SIGTERM, SIGINT, SIGHUP }) {
+            std::signal(signal, SIG_DFL);
+        }
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action {};
+    action.sa_handler = forwardSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    for (const int signal : { SIGTERM, SIGINT, SIGHUP }) {
+        ::sigaction(signal, &action, nullptr);
+    }
+}
+
+} // namespace
+
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
     QCoreApplication::setOrganizationName(QStringLiteral("athbe"));
     QCoreApplication::setApplicationName(QStringLiteral("Orbital"));
+    installQuitSignals(app);
 
     // 注册 C++ 类型到 QML
     qmlRegisterType<SystemMonitor>("MyDesktop.Backend", 1, 0, "SystemMonitor");
     qmlRegisterType<TerminalBackend>("MyDesktop.Backend", 1, 0, "TerminalBackend");
+    qmlRegisterType<MetricSubscription>("MyDesktop.Backend", 1, 0, "MetricSubscription");
 
     QQmlApplicationEngine engine;
 
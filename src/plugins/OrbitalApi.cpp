@@ -1,6 +1,7 @@
 #include "OrbitalApi.h"
 
 #include "../SystemMonitor.h"
+#include "../backend/MetricScheduler.h"
 
 #include <QDebug>
 #include <QFile>
@@ -163,6 +164,26 @@ bool OrbitalApi::writeFile(const QString &path, const QString &content)
     return f.write(bytes) == bytes.size();
 }
 
+int OrbitalApi::subscribeMetrics(const QStringList &metrics, int intervalMs)
+{
+    const int token = m_systemMonitor->scheduler()->subscribe(metrics, intervalMs);
+    if (token != 0) {
+        m_metricSubscriptions.insert(token);
+    }
+
+    return token;
+}
+
+void OrbitalApi::unsubscribeMetrics(int token)
+{
+    // Only tokens handed out to this plugin can be released through it.
+    if (!m_metricSubscriptions.remove(token)) {
+        return;
+    }
+
+    m_systemMonitor->scheduler()->unsubscribe(token);
+}
+
 void OrbitalApi::toast(const QString &message)
 {
     emit toastRequested(message);
@@ -3,6 +3,7 @@
 #include <QHash>
 #include <QJSValue>
 #include <QObject>
+#include <QSet>
 #include <QString>
 #include <QUrl>
 #include <QVariantMap>
@@ -40,6 +41,14 @@ public:
     Q_INVOKABLE QString readFile(const QString &path);
     Q_INVOKABLE bool writeFile(const QString &path, const QString &content);
 
+    // Ask the system monitor to sample the given collectors ("cpu",
+    // "memory", "disk", "battery", "network", "load", "pressure", "cgroups",
+    // "details") at least every intervalMs. Returns a token for
+    // unsubscribeMetrics, or 0 if no collector name was recognised. Pages
+    // can use the MetricSubscription element instead.
+    Q_INVOKABLE int subscribeMetrics(const QStringList &metrics, int intervalMs = 1000);
+    Q_INVOKABLE void unsubscribeMetrics(int token);
+
     Q_INVOKABLE void toast(const QString &message);
     Q_INVOKABLE void pushPage(const QUrl &qmlUrl, const QVariantMap &props = {});
     Q_INVOKABLE void popPage();
@@ -66,4 +75,5 @@ private:
 
     int m_nextProcId = 1;
     QHash<int, QProcess *> m_processes;
+    QSet<int> m_metricSubscriptions;
 };